@@ -0,0 +1,367 @@
+#include "../core/hardwarecollector.h"
+#include "../core/networkprobe.h"
+#include "../core/dirscanner.h"
+#include "../core/cleanupworker.h"
+#include "../core/cleanupscheduler.h"
+#include "../core/deletionplan.h"
+#include "../core/trace.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char *Usage =
+    "Usage: raptor-cli [--trace file.json] <command> [arguments]\n"
+    "\n"
+    "  hw                       hardware summary\n"
+    "  net                      network adapters, connections and adapter states\n"
+    "  scan [path...]           sizes of the cleanup targets, or of the given paths\n"
+    "  clean [--low-impact] [--io-uring] [--plan file] operation...\n"
+    "                           scans and cleans the given operations\n"
+    "                           (temp, recycle, browser, wintemp, prefetch,\n"
+    "                           thumbnails, dns, logs); with --plan, deletes\n"
+    "                           only what a saved deletion plan lists;\n"
+    "                           --io-uring batches the unlinks on Linux\n"
+    "  plan show [file]         the files a deletion plan would delete; by\n"
+    "                           default the plan of the last scan\n"
+    "\n"
+    "Every command writes one JSON object to standard output. --trace also\n"
+    "records where the time went, as a Chrome trace for Perfetto.\n";
+
+void print(const QJsonObject &result)
+{
+    const QByteArray json = QJsonDocument(result).toJson(QJsonDocument::Compact);
+    std::fwrite(json.constData(), 1, static_cast<size_t>(json.size()), stdout);
+    std::fputc('\n', stdout);
+}
+
+QJsonObject hardware()
+{
+    HardwareCollector collector;
+    const HardwareReport report = collector.collect();
+
+    QJsonObject result;
+    result["cpu"] = report.cpu;
+    result["gpu"] = report.gpu;
+    result["motherboard"] = report.motherboard;
+    result["ram"] = report.ram;
+    result["storage"] = report.storage;
+    result["network"] = report.network;
+    result["usb"] = report.usb;
+    return result;
+}
+
+QJsonObject network()
+{
+    NetworkProbe probe;
+
+    QJsonArray adapters;
+    for (const NetworkAdapter &adapter : probe.adapters()) {
+        QJsonObject item;
+        item["name"] = adapter.name;
+        item["address"] = adapter.address;
+        adapters.append(item);
+    }
+
+    const ConnectionSummary summary = probe.connections();
+    QJsonObject connections;
+    connections["tcp"] = summary.tcp;
+    connections["udp"] = summary.udp;
+    connections["recentTcp"] = QJsonArray::fromStringList(summary.recentTcp);
+
+    QJsonObject status;
+    status["ethernet"] = probe.ethernetStatus();
+    status["wifiAdapter"] = probe.wifiAdapterStatus();
+    status["wifiRadio"] = probe.wifiRadioStatus();
+    status["bluetoothAdapter"] = probe.bluetoothAdapterStatus();
+    status["bluetoothRadio"] = probe.bluetoothRadioStatus();
+
+    QJsonObject result;
+    result["adapters"] = adapters;
+    result["ipDetails"] = QJsonArray::fromStringList(probe.ipDetails());
+    result["connections"] = connections;
+    result["status"] = status;
+    return result;
+}
+
+// Plain directory sizes, without any cleanup rules
+QJsonObject scanPaths(const QStringList &paths)
+{
+    std::vector<std::string> roots;
+    for (const QString &path : paths) {
+        roots.push_back(QDir::cleanPath(QDir::current().absoluteFilePath(path)).toStdString());
+    }
+
+    DirScanner scanner;
+    const std::vector<ScanTotals> totals = scanner.scan(roots);
+
+    QJsonArray items;
+    for (size_t i = 0; i < totals.size(); ++i) {
+        QJsonObject item;
+        item["path"] = QString::fromStdString(roots[i]);
+        item["bytes"] = static_cast<qint64>(totals[i].bytes);
+        item["allocated"] = static_cast<qint64>(totals[i].allocated);
+        item["files"] = static_cast<qint64>(totals[i].files);
+        item["directories"] = static_cast<qint64>(totals[i].directories);
+        item["errors"] = static_cast<qint64>(totals[i].errors);
+        items.append(item);
+    }
+
+    QJsonObject result;
+    result["roots"] = items;
+    result["threads"] = scanner.threadCount();
+    result["devices"] = scanner.deviceCount();
+    return result;
+}
+
+// The Cleaner's scan: what each operation would free. Also records the
+// deletion plan a following clean() works from.
+QJsonObject scanTargets(CleanupWorker &worker)
+{
+    const QList<CleanupWorker::ScanTarget> targets = worker.scanTargets();
+    QStringList paths;
+    for (const CleanupWorker::ScanTarget &target : targets) {
+        paths << target.path;
+    }
+
+    QJsonArray items;
+    QJsonObject operations;
+    bool canceled = false;
+    QMetaObject::Connection finished = QObject::connect(&worker, &CleanupWorker::scanFinished,
+        [&](const QList<qint64> &bytes, const QList<qint64> &allocated, const QList<qint64> &files, bool wasCanceled) {
+            canceled = wasCanceled;
+            for (int i = 0; i < targets.size(); ++i) {
+                QJsonObject item;
+                item["operation"] = targets[i].operation;
+                item["path"] = QDir::toNativeSeparators(targets[i].path);
+                item["filtered"] = targets[i].filtered;
+                item["bytes"] = bytes.value(i);
+                item["allocated"] = allocated.value(i);
+                item["files"] = files.value(i);
+                items.append(item);
+
+                QJsonObject operation = operations.value(targets[i].operation).toObject();
+                operation["bytes"] = operation.value("bytes").toDouble() + bytes.value(i);
+                operation["allocated"] = operation.value("allocated").toDouble() + allocated.value(i);
+                operation["files"] = operation.value("files").toDouble() + files.value(i);
+                operations[targets[i].operation] = operation;
+            }
+        });
+    worker.scan(paths, nullptr);
+    QObject::disconnect(finished);
+
+    QJsonObject result;
+    result["targets"] = items;
+    result["operations"] = operations;
+    result["canceled"] = canceled;
+    return result;
+}
+
+// Every file of a saved plan, for review before it is carried out
+QJsonObject showPlan(const QString &filePath)
+{
+    DeletionPlan plan;
+    QJsonObject result;
+    result["path"] = QDir::toNativeSeparators(filePath);
+    if (!plan.load(filePath.toStdString())) {
+        result["error"] = "not a deletion plan or unreadable";
+        return result;
+    }
+
+    QJsonArray roots;
+    for (const std::string &root : plan.roots()) {
+        roots.append(QString::fromStdString(root));
+    }
+    QJsonArray files;
+    for (size_t i = 0; i < plan.fileCount(); ++i) {
+        QJsonObject item;
+        item["path"] = QString::fromStdString(plan.filePath(static_cast<uint32_t>(i)));
+        item["bytes"] = static_cast<qint64>(plan.file(static_cast<uint32_t>(i)).size);
+        files.append(item);
+    }
+
+    result["created"] = QDateTime::fromSecsSinceEpoch(plan.createdAt()).toString(Qt::ISODate);
+    result["roots"] = roots;
+    result["directories"] = static_cast<qint64>(plan.directoryCount());
+    result["bytes"] = static_cast<qint64>(plan.totalBytes());
+    result["files"] = files;
+    return result;
+}
+
+// Checks that a saved plan was made for every folder the operations clean
+// and loads it into the worker; the totals are the plan's. The deleter
+// then only unlinks planned files that are unchanged since the scan, and
+// lists only the folders the plan has no listing for.
+bool loadPlan(CleanupWorker &worker, const QStringList &operations, const QString &filePath,
+              qint64 &totalBytes, qint64 &totalFiles, QString *error)
+{
+    DeletionPlan plan;
+    if (!plan.load(filePath.toStdString())) {
+        *error = "not a deletion plan or unreadable: " + filePath;
+        return false;
+    }
+    for (const CleanupWorker::ScanTarget &target : worker.scanTargets()) {
+        if (!operations.contains(target.operation)) continue;
+        if (plan.findDirectory(QDir::cleanPath(target.path).toStdString()) == DeletionPlan::NoDirectory) {
+            *error = "the plan does not cover " + QDir::toNativeSeparators(target.path) + ", scan again";
+            return false;
+        }
+    }
+
+    totalBytes = plan.totalBytes();
+    totalFiles = static_cast<qint64>(plan.fileCount());
+    if (!worker.loadPlan(filePath)) {
+        *error = "could not load " + filePath;
+        return false;
+    }
+    return true;
+}
+
+QJsonObject clean(CleanupWorker &worker, const QStringList &operations, bool lowImpact, bool ioUring,
+                  const QString &planPath)
+{
+    qint64 totalBytes = 0;
+    qint64 totalFiles = 0;
+    bool canceled = false;
+    if (planPath.isEmpty()) {
+        // A fresh scan gives the progress totals and the plan to delete from
+        const QJsonObject scanned = scanTargets(worker);
+        for (const QString &operation : operations) {
+            const QJsonObject sizes = scanned.value("operations").toObject().value(operation).toObject();
+            totalBytes += static_cast<qint64>(sizes.value("bytes").toDouble());
+            totalFiles += static_cast<qint64>(sizes.value("files").toDouble());
+        }
+        canceled = scanned.value("canceled").toBool();
+    } else {
+        QString error;
+        if (!loadPlan(worker, operations, planPath, totalBytes, totalFiles, &error)) {
+            QJsonObject result;
+            result["error"] = error;
+            return result;
+        }
+    }
+
+    if (!canceled) {
+        const CleanupScheduler::Settings defaults;
+        worker.setLowImpact(lowImpact, defaults.operationsPerSecond, defaults.pressureLimit);
+        worker.setUseIoUring(ioUring);
+        QMetaObject::Connection finished = QObject::connect(&worker, &CleanupWorker::cleanFinished,
+            [&](bool wasCanceled) { canceled = wasCanceled; });
+        worker.clean(operations, totalBytes, totalFiles);
+        QObject::disconnect(finished);
+    }
+
+    QJsonObject result;
+    result["operations"] = QJsonArray::fromStringList(operations);
+    result["bytesBefore"] = totalBytes;
+    result["filesBefore"] = totalFiles;
+    result["canceled"] = canceled;
+    return result;
+}
+
+int run(const QString &command, QStringList arguments)
+{
+    TraceSpan span("raptor-cli");
+    if (span.isActive()) span.setDetail(command.toStdString());
+
+    if (command == "hw") {
+        print(hardware());
+        return 0;
+    }
+    if (command == "net") {
+        print(network());
+        return 0;
+    }
+    if (command == "plan") {
+        if (arguments.value(0) != "show" || arguments.size() > 2) {
+            std::fprintf(stderr, "raptor-cli: plan takes 'show [file]'\n\n%s", Usage);
+            return 2;
+        }
+        const QString filePath = arguments.size() == 2 ? arguments.at(1) : CleanupWorker::planPath();
+        const QJsonObject result = showPlan(filePath);
+        print(result);
+        return result.contains("error") ? 1 : 0;
+    }
+    if (command != "scan" && command != "clean") {
+        std::fprintf(stderr, "raptor-cli: unknown command '%s'\n\n%s", qPrintable(command), Usage);
+        return 2;
+    }
+
+    if (command == "scan" && !arguments.isEmpty()) {
+        print(scanPaths(arguments));
+        return 0;
+    }
+
+    bool lowImpact = false;
+    bool ioUring = false;
+    QString planPath;
+    if (command == "clean") {
+        lowImpact = arguments.removeAll("--low-impact") > 0;
+        ioUring = arguments.removeAll("--io-uring") > 0;
+        const int planOption = arguments.indexOf("--plan");
+        if (planOption >= 0) {
+            if (planOption + 1 >= arguments.size()) {
+                std::fprintf(stderr, "raptor-cli: --plan needs a file\n\n%s", Usage);
+                return 2;
+            }
+            planPath = arguments.takeAt(planOption + 1);
+            arguments.removeAt(planOption);
+        }
+        if (arguments.isEmpty()) {
+            std::fprintf(stderr, "raptor-cli: clean needs at least one operation\n\n%s", Usage);
+            return 2;
+        }
+    }
+
+    // The worker's log goes into the result instead of a window
+    CleanupWorker worker;
+    QJsonArray log;
+    QObject::connect(&worker, &CleanupWorker::logLines, [&log](const QStringList &lines) {
+        for (const QString &line : lines) {
+            log.append(line);
+        }
+    });
+
+    QJsonObject result = command == "scan" ? scanTargets(worker)
+                                           : clean(worker, arguments, lowImpact, ioUring, planPath);
+    result["log"] = log;
+    print(result);
+    return result.value("canceled").toBool() || result.contains("error") ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    // Shares the rules, scan index and quarantine of the desktop app
+    QCoreApplication::setApplicationName("Raptor");
+
+    QStringList arguments = app.arguments().mid(1);
+    QString tracePath;
+    if (arguments.size() >= 2 && arguments.first() == "--trace") {
+        arguments.removeFirst();
+        tracePath = arguments.takeFirst();
+        Trace::start();
+        Trace::setThreadName("raptor-cli");
+    }
+    if (arguments.isEmpty() || arguments.first() == "-h" || arguments.first() == "--help") {
+        std::fputs(Usage, arguments.isEmpty() ? stderr : stdout);
+        return arguments.isEmpty() ? 2 : 0;
+    }
+    const QString command = arguments.takeFirst();
+    const int result = run(command, arguments);
+    if (!tracePath.isEmpty() && !Trace::writeChromeJson(tracePath.toStdString())) {
+        std::fprintf(stderr, "raptor-cli: could not write %s\n", qPrintable(tracePath));
+    }
+    return result;
+}
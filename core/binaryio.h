@@ -0,0 +1,132 @@
+#ifndef BINARYIO_H
+#define BINARYIO_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Little helpers for the on-disk formats in core/ (scan index, deletion
+// plans). Values are stored in host byte order; the files are caches and
+// plans for the same machine, not an interchange format.
+class Writer
+{
+public:
+    void u8(uint8_t value) { raw(&value, sizeof(value)); }
+    void u32(uint32_t value) { raw(&value, sizeof(value)); }
+    void u64(uint64_t value) { raw(&value, sizeof(value)); }
+    void i64(int64_t value) { raw(&value, sizeof(value)); }
+    void str(const std::string &value)
+    {
+        u32(static_cast<uint32_t>(value.size()));
+        raw(value.data(), value.size());
+    }
+    // LEB128, small numbers take a single byte
+    void varint(uint64_t value)
+    {
+        while (value >= 0x80) {
+            u8(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        u8(static_cast<uint8_t>(value));
+    }
+    void svarint(int64_t value)
+    {
+        varint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+    void raw(const void *data, size_t length)
+    {
+        const char *bytes = static_cast<const char *>(data);
+        buffer.insert(buffer.end(), bytes, bytes + length);
+    }
+
+    std::vector<char> buffer;
+};
+
+class Reader
+{
+public:
+    Reader(const std::vector<char> &data) : data(data), offset(0), failed(false) {}
+
+    uint8_t u8() { uint8_t value = 0; raw(&value, sizeof(value)); return value; }
+    uint32_t u32() { uint32_t value = 0; raw(&value, sizeof(value)); return value; }
+    uint64_t u64() { uint64_t value = 0; raw(&value, sizeof(value)); return value; }
+    int64_t i64() { int64_t value = 0; raw(&value, sizeof(value)); return value; }
+    std::string str()
+    {
+        const uint32_t length = u32();
+        if (failed || length > data.size() - offset) {
+            failed = true;
+            return std::string();
+        }
+        std::string value(data.data() + offset, length);
+        offset += length;
+        return value;
+    }
+    uint64_t varint()
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64 && !failed; shift += 7) {
+            const uint8_t byte = u8();
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        failed = true;
+        return 0;
+    }
+    int64_t svarint()
+    {
+        const uint64_t value = varint();
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+    void raw(void *out, size_t length)
+    {
+        if (failed || length > data.size() - offset) {
+            failed = true;
+            return;
+        }
+        std::memcpy(out, data.data() + offset, length);
+        offset += length;
+    }
+    bool ok() const { return !failed; }
+    bool atEnd() const { return offset == data.size(); }
+
+private:
+    const std::vector<char> &data;
+    size_t offset;
+    bool failed;
+};
+
+inline bool readWholeFile(const std::string &path, std::vector<char> &data)
+{
+    FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    data.clear();
+    char chunk[64 * 1024];
+    size_t length;
+    while ((length = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + length);
+    }
+    std::fclose(file);
+    return true;
+}
+
+// Writes to a temporary file and renames it over path, so a crash never
+// leaves a half-written file behind
+inline bool writeFileAtomically(const std::string &path, const std::vector<char> &data)
+{
+    const std::string tempPath = path + ".tmp";
+    FILE *file = std::fopen(tempPath.c_str(), "wb");
+    if (!file) return false;
+    const bool written = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    const bool closed = std::fclose(file) == 0;
+    if (!written || !closed) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return std::rename(tempPath.c_str(), path.c_str()) == 0;
+}
+
+#endif // BINARYIO_H
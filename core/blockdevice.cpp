@@ -0,0 +1,95 @@
+#include "blockdevice.h"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <sys/sysmacros.h>
+
+namespace fs = std::filesystem;
+#endif
+
+namespace {
+
+// A SATA or SAS link saturates well before an NVMe queue does
+const int SsdThreads = 8;
+// One thread reading while the other lists what it got keeps the head busy
+const int RotationalThreads = 2;
+
+#ifdef __linux__
+// Stacked volumes deeper than this are not followed
+const int MaxDepth = 4;
+
+std::string readFirstLine(const fs::path &path)
+{
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+// dir is the device's directory below /sys/devices
+BlockDevice describe(fs::path dir, int depth)
+{
+    std::error_code error;
+    if (fs::exists(dir / "partition", error)) dir = dir.parent_path();
+
+    // device-mapper and md volumes are as fast as the disks below them
+    BlockDevice device;
+    if (depth < MaxDepth) {
+        bool allNvme = true;
+        fs::directory_iterator slave(dir / "slaves", error);
+        for (; !error && slave != fs::directory_iterator(); slave.increment(error)) {
+            const fs::path below = fs::canonical(slave->path(), error);
+            if (error) {
+                error.clear();
+                continue;
+            }
+            const BlockDevice disk = describe(below, depth + 1);
+            if (!disk.isKnown()) continue;
+            // The first disk by name, so the same volume always groups alike
+            if (device.name.empty() || disk.name < device.name) device.name = disk.name;
+            device.rotational = device.rotational || disk.rotational;
+            allNvme = allNvme && disk.nvme;
+        }
+        if (device.isKnown()) {
+            device.nvme = allNvme;
+            return device;
+        }
+    }
+
+    device.name = dir.filename().string();
+    device.rotational = readFirstLine(dir / "queue" / "rotational") == "1";
+    device.nvme = device.name.compare(0, 4, "nvme") == 0;
+    return device;
+}
+#endif
+
+} // namespace
+
+int BlockDevice::concurrency(int threads) const
+{
+    if (!isKnown() || nvme) return threads;
+    return std::min(threads, rotational ? RotationalThreads : SsdThreads);
+}
+
+BlockDevice blockDeviceOf(uint64_t device)
+{
+#ifdef __linux__
+    // tmpfs, network file systems and btrfs subvolumes have no block device
+    if (major(device) == 0) return BlockDevice();
+
+    char link[64];
+    std::snprintf(link, sizeof(link), "/sys/dev/block/%u:%u", major(device), minor(device));
+    std::error_code error;
+    const fs::path dir = fs::canonical(link, error);
+    if (error) return BlockDevice();
+    return describe(dir, 0);
+#else
+    (void)device;
+    return BlockDevice();
+#endif
+}
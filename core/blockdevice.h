@@ -0,0 +1,29 @@
+#ifndef BLOCKDEVICE_H
+#define BLOCKDEVICE_H
+
+#include <cstdint>
+#include <string>
+
+// The disk behind a file system, as far as the kernel tells. Partitions
+// map to their disk and device-mapper volumes (LVM, LUKS) to the disks
+// below them, so two roots on the same spindle end up with the same name.
+struct BlockDevice
+{
+    std::string name;        // "sda", "nvme0n1"; empty when unknown
+    bool rotational = false;
+    bool nvme = false;
+
+    bool isKnown() const { return !name.empty(); }
+
+    // Directories a scan should read at once on this device: a spinning
+    // disk only gets slower when its head is pulled between more places,
+    // an NVMe drive wants deep queues, other SSDs sit in between. Unknown
+    // devices (network and virtual file systems) get all threads.
+    int concurrency(int threads) const;
+};
+
+// Looks up the device for a st_dev value through /sys/dev/block. Always
+// unknown outside Linux.
+BlockDevice blockDeviceOf(uint64_t device);
+
+#endif // BLOCKDEVICE_H
@@ -0,0 +1,139 @@
+#include "cachebudget.h"
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+#ifdef __linux__
+#include <sys/statvfs.h>
+#endif
+
+CacheBudget::CacheBudget(int64_t budgetBytes, bool useAccessTime)
+    : limit(std::max<int64_t>(0, budgetBytes))
+    , accessTime(useAccessTime)
+    , evicting(false)
+    , total(0)
+    , kept(0)
+    , keptFiles(0)
+    , files(0)
+{
+}
+
+bool CacheBudget::tracksAccessTime(const std::string &path)
+{
+#ifdef __linux__
+    struct statvfs info;
+    if (statvfs(path.c_str(), &info) != 0) return false;
+    return !(info.f_flag & ST_NOATIME);
+#else
+    (void)path;
+    return true;
+#endif
+}
+
+CacheBudget::Use CacheBudget::useOf(const ScanFileEntry &entry) const
+{
+    Use use;
+    // relatime only moves atime forward once it is older than mtime, so the
+    // later of the two is the last use either way
+    use.time = accessTime ? std::max(entry.atime, entry.mtime) : entry.mtime;
+    use.device = entry.device;
+    use.inode = entry.inode;
+    use.bytes = entry.allocated > 0 ? entry.allocated : entry.size;
+    return use;
+}
+
+// Called with the shard's lock held
+void CacheBudget::keep(Shard &shard, const Use &use)
+{
+    if (shard.dropped && !(shard.floor < use)) return;
+
+    // std heaps are max-heaps, so invert to keep the least recent on top
+    auto later = [](const Use &a, const Use &b) { return b < a; };
+    shard.heap.push_back(use);
+    std::push_heap(shard.heap.begin(), shard.heap.end(), later);
+    shard.heapBytes += use.bytes;
+
+    while (shard.heapBytes > limit) {
+        std::pop_heap(shard.heap.begin(), shard.heap.end(), later);
+        // Everything left is newer, so the dropped files only ever get newer
+        shard.floor = shard.heap.back();
+        shard.dropped = true;
+        shard.heapBytes -= shard.floor.bytes;
+        shard.heap.pop_back();
+    }
+}
+
+void CacheBudget::add(const ScanFileEntry &entry)
+{
+    if (!entry.firstLink) return;
+    const Use use = useOf(entry);
+    Shard &shard = shards[std::hash<std::thread::id>()(std::this_thread::get_id()) % ShardCount];
+    std::lock_guard<std::mutex> guard(shard.lock);
+    shard.totalBytes += use.bytes;
+    shard.files++;
+    keep(shard, use);
+}
+
+void CacheBudget::finish()
+{
+    evicting = false;
+    total = 0;
+    files = 0;
+    for (Shard &shard : shards) {
+        total += shard.totalBytes;
+        files += shard.files;
+        if (!shard.dropped) continue;
+        if (!evicting || cutoff < shard.floor) cutoff = shard.floor;
+        evicting = true;
+    }
+
+    // What the shards kept and no other shard has already ruled out, at
+    // most ShardCount budgets' worth, newest first
+    std::vector<Use> candidates;
+    for (Shard &shard : shards) {
+        for (const Use &use : shard.heap) {
+            if (!evicting || cutoff < use) candidates.push_back(use);
+        }
+        shard.heap = std::vector<Use>();
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Use &a, const Use &b) { return b < a; });
+
+    kept = 0;
+    keptFiles = 0;
+    for (const Use &use : candidates) {
+        if (kept + use.bytes > limit) {
+            // This file and everything used before it goes
+            cutoff = use;
+            evicting = true;
+            break;
+        }
+        kept += use.bytes;
+        keptFiles++;
+    }
+}
+
+bool CacheBudget::evicts(const ScanFileEntry &entry) const
+{
+    return evicting && !(cutoff < useOf(entry));
+}
+
+int64_t CacheBudget::budget() const
+{
+    return limit;
+}
+
+int64_t CacheBudget::totalBytes() const
+{
+    return total;
+}
+
+int64_t CacheBudget::keptBytes() const
+{
+    return kept;
+}
+
+int64_t CacheBudget::evictedFiles() const
+{
+    return files - keptFiles;
+}
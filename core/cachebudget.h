@@ -0,0 +1,89 @@
+#ifndef CACHEBUDGET_H
+#define CACHEBUDGET_H
+
+#include "dirscanner.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Decides which files of a cache to evict so it fits a size budget, least
+// recently used first. Files are ranked by their last use: the later of
+// atime and mtime, or mtime alone on file systems mounted noatime.
+//
+// The kept files are the most recently used ones whose disk space adds up
+// to at most the budget. add() streams every file through a min-heap of
+// the current keep candidates: whenever they exceed the budget the least
+// recently used one is dropped and everything used no later than it is
+// evicted for good. Memory grows with the files that are kept, not with
+// the size of the cache, and nothing is ever sorted as a whole.
+//
+// add() is called from the scanner's threads. Files are spread over
+// independent shards by thread; a file a shard drops is evicted globally
+// too, since the shard alone already has more than the budget of newer
+// files, so finish() only has to merge what the shards kept.
+class CacheBudget
+{
+public:
+    CacheBudget(int64_t budgetBytes, bool useAccessTime);
+
+    // False when the file system path is on ignores access times
+    static bool tracksAccessTime(const std::string &path);
+
+    void add(const ScanFileEntry &entry);
+    void finish();
+
+    // After finish(): whether the entry is one of the files to delete. Safe
+    // to call from several threads; files used after the selection are kept.
+    bool evicts(const ScanFileEntry &entry) const;
+
+    int64_t budget() const;
+    int64_t totalBytes() const;
+    int64_t keptBytes() const;
+    int64_t evictedFiles() const;
+
+private:
+    struct Use
+    {
+        int64_t time = 0;
+        uint64_t device = 0;
+        uint64_t inode = 0;
+        int64_t bytes = 0;
+        bool operator<(const Use &other) const
+        {
+            if (time != other.time) return time < other.time;
+            if (device != other.device) return device < other.device;
+            return inode < other.inode;
+        }
+    };
+
+    struct Shard
+    {
+        std::mutex lock;
+        std::vector<Use> heap;  // least recently used on top
+        int64_t heapBytes = 0;
+        int64_t totalBytes = 0;
+        int64_t files = 0;
+        Use floor;              // newest file dropped so far
+        bool dropped = false;
+    };
+
+    static const int ShardCount = 16;
+
+    Use useOf(const ScanFileEntry &entry) const;
+    void keep(Shard &shard, const Use &use);
+
+    int64_t limit;
+    bool accessTime;
+    Shard shards[ShardCount];
+
+    Use cutoff;            // files used no later than this are evicted
+    bool evicting;
+    int64_t total;
+    int64_t kept;
+    int64_t keptFiles;
+    int64_t files;
+};
+
+#endif // CACHEBUDGET_H
@@ -0,0 +1,148 @@
+#include "cleanuprules.h"
+
+#include <algorithm>
+#include <map>
+
+CleanupRuleSet::CleanupRuleSet()
+    : now(0)
+{
+}
+
+void CleanupRuleSet::add(const CleanupRule &rule)
+{
+    rules.push_back(rule);
+}
+
+void CleanupRuleSet::clear()
+{
+    rules.clear();
+    roots.clear();
+}
+
+void CleanupRuleSet::compile(int64_t currentTime)
+{
+    now = currentTime;
+    roots.clear();
+
+    std::map<std::string, size_t> rootIndex;
+    for (uint32_t i = 0; i < rules.size(); ++i) {
+        const CleanupRule &rule = rules[i];
+        auto it = rootIndex.find(rule.root);
+        if (it == rootIndex.end()) {
+            it = rootIndex.emplace(rule.root, roots.size()).first;
+            roots.emplace_back();
+            roots.back().path = rule.root;
+            roots.back().globs.reset(new GlobSet());
+        }
+
+        Root &root = roots[it->second];
+        root.rules.push_back(i);
+        if (rule.maxDepth < 0 || root.maxDepth < 0) {
+            root.maxDepth = -1;
+        } else {
+            root.maxDepth = std::max(root.maxDepth, rule.maxDepth);
+        }
+        if (!rule.removeDirectories) root.removeDirectories = false;
+        if (rule.include.empty() && rule.exclude.empty() && rule.minimumAge <= 0
+            && rule.minimumSize <= 0 && rule.maximumSize < 0 && rule.minDepth <= 0
+            && rule.maxDepth < 0 && !rule.regularOnly && rule.budget < 0) {
+            root.everything = true;
+        }
+
+        // A rule without include patterns takes every file
+        if (rule.include.empty()) root.globs->add("*", i);
+        for (const std::string &pattern : rule.include) {
+            root.globs->add(pattern, i, GlobSet::Include);
+        }
+        for (const std::string &pattern : rule.exclude) {
+            root.globs->add(pattern, i, GlobSet::Exclude);
+        }
+    }
+
+    for (Root &root : roots) {
+        root.globs->compile();
+        for (uint32_t i : root.rules) {
+            const int64_t budget = rules[i].budget;
+            if (budget < 0) {
+                root.budget = -1;
+                break;
+            }
+            root.budget = i == root.rules.front() ? budget : std::min(root.budget, budget);
+        }
+    }
+}
+
+bool CleanupRuleSet::accepts(const CleanupRule &rule, size_t rootLength, const ScanFileEntry &entry) const
+{
+    if (rule.regularOnly && !entry.regular) return false;
+    if (entry.size < rule.minimumSize) return false;
+    if (rule.maximumSize >= 0 && entry.size > rule.maximumSize) return false;
+    if (rule.minimumAge > 0 && now - entry.mtime < rule.minimumAge) return false;
+
+    if ((rule.minDepth > 0 || rule.maxDepth >= 0) && entry.dirPath) {
+        // Directories between the root and the file
+        const std::string &dir = *entry.dirPath;
+        int depth = 0;
+        if (dir.size() > rootLength) {
+            depth = static_cast<int>(std::count(dir.begin() + rootLength, dir.end(), '/'));
+            if (dir[rootLength] != '/') depth++;
+        }
+        if (depth < rule.minDepth) return false;
+        if (rule.maxDepth >= 0 && depth > rule.maxDepth) return false;
+    }
+    return true;
+}
+
+int CleanupRuleSet::match(size_t rootIndex, const ScanFileEntry &entry) const
+{
+    const Root &root = roots[rootIndex];
+    for (uint32_t rule : root.globs->select(entry.name)) {
+        if (accepts(rules[rule], root.path.size(), entry)) return static_cast<int>(rule);
+    }
+    return -1;
+}
+
+size_t CleanupRuleSet::ruleCount() const
+{
+    return rules.size();
+}
+
+const CleanupRule &CleanupRuleSet::rule(size_t index) const
+{
+    return rules[index];
+}
+
+size_t CleanupRuleSet::rootCount() const
+{
+    return roots.size();
+}
+
+const std::string &CleanupRuleSet::rootPath(size_t rootIndex) const
+{
+    return roots[rootIndex].path;
+}
+
+int CleanupRuleSet::maxDepth(size_t rootIndex) const
+{
+    return roots[rootIndex].maxDepth;
+}
+
+bool CleanupRuleSet::removesDirectories(size_t rootIndex) const
+{
+    return roots[rootIndex].removeDirectories;
+}
+
+const std::vector<uint32_t> &CleanupRuleSet::rootRules(size_t rootIndex) const
+{
+    return roots[rootIndex].rules;
+}
+
+bool CleanupRuleSet::takesEverything(size_t rootIndex) const
+{
+    return roots[rootIndex].everything;
+}
+
+int64_t CleanupRuleSet::budget(size_t rootIndex) const
+{
+    return roots[rootIndex].budget;
+}
@@ -0,0 +1,88 @@
+#ifndef CLEANUPRULES_H
+#define CLEANUPRULES_H
+
+#include "dirscanner.h"
+#include "globset.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// One cleanup target described as data rather than code
+struct CleanupRule
+{
+    std::string category;                // Cleaner operation it belongs to ("temp", "logs", ...)
+    std::string root;
+    std::vector<std::string> include;    // file name patterns, empty means every file
+    std::vector<std::string> exclude;
+    int64_t minimumAge = 0;              // seconds since the last modification
+    int64_t minimumSize = 0;
+    int64_t maximumSize = -1;            // -1 for no limit
+    int minDepth = 0;                    // files in fewer levels of subdirectories are kept
+    int maxDepth = -1;                   // 0 only looks at files directly in root, -1 for no limit
+    bool removeDirectories = true;       // remove subdirectories that end up empty
+    bool regularOnly = false;            // leave sockets, symlinks and device nodes alone
+    int64_t budget = -1;                 // keep the most recently used files up to this many bytes, -1 for none
+};
+
+// Compiles a list of rules for matching during a cleanup. Rules sharing a
+// root are served by one deletion root, and all of their include and
+// exclude patterns go into a single GlobSet tagged with the rule, so a
+// file name is read once no matter how many rules there are. Only the
+// rules its name selects have their age, size and depth limits checked.
+//
+// match() is safe to call from several threads once compile() returned.
+class CleanupRuleSet
+{
+public:
+    CleanupRuleSet();
+
+    void add(const CleanupRule &rule);
+    // now is the reference time for minimumAge, in seconds since the epoch
+    void compile(int64_t now);
+    void clear();
+
+    size_t ruleCount() const;
+    const CleanupRule &rule(size_t index) const;
+
+    size_t rootCount() const;
+    const std::string &rootPath(size_t rootIndex) const;
+    // Deepest level any rule of the root looks at, -1 for no limit
+    int maxDepth(size_t rootIndex) const;
+    // Only when every rule of the root allows it
+    bool removesDirectories(size_t rootIndex) const;
+    // Indexes of the rules that share the root
+    const std::vector<uint32_t> &rootRules(size_t rootIndex) const;
+    // True when some rule of the root deletes every file below it, so the
+    // root's scan totals are what a cleanup frees
+    bool takesEverything(size_t rootIndex) const;
+    // Bytes the root is trimmed to, least recently used files first, or -1
+    // to delete every match. Only set when every rule of the root has a
+    // budget; the smallest one applies.
+    int64_t budget(size_t rootIndex) const;
+
+    // Index of the first rule that wants entry deleted, or -1. entry.dirPath
+    // must lie below the root's path.
+    int match(size_t rootIndex, const ScanFileEntry &entry) const;
+
+private:
+    struct Root
+    {
+        std::string path;
+        std::vector<uint32_t> rules;
+        std::unique_ptr<GlobSet> globs;  // GlobSet is not movable
+        int maxDepth = 0;
+        bool removeDirectories = true;
+        bool everything = false;
+        int64_t budget = -1;
+    };
+
+    bool accepts(const CleanupRule &rule, size_t rootLength, const ScanFileEntry &entry) const;
+
+    std::vector<CleanupRule> rules;
+    std::vector<Root> roots;
+    int64_t now;
+};
+
+#endif // CLEANUPRULES_H
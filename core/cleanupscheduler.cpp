@@ -0,0 +1,188 @@
+#include "cleanupscheduler.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+#include <QStorageInfo>
+#include <QTimer>
+
+namespace {
+
+const int CheckIntervalMs = 60 * 1000;
+const int SecondsPerHour = 60 * 60;
+
+// Memory-backed and image file systems never fill up from use
+bool isSampledVolume(const QStorageInfo &volume)
+{
+    if (!volume.isValid() || !volume.isReady() || volume.isReadOnly() || volume.bytesTotal() <= 0) return false;
+    const QByteArray type = volume.fileSystemType();
+    return type != "tmpfs" && type != "devtmpfs" && type != "ramfs" && type != "squashfs" && type != "overlay";
+}
+
+} // namespace
+
+CleanupScheduler::CleanupScheduler(QObject *parent)
+    : QObject(parent)
+    , timer(nullptr)
+    , history((QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/space-history.bin").toStdString())
+{
+    timer = new QTimer(this);
+    timer->setTimerType(Qt::VeryCoarseTimer);
+    connect(timer, &QTimer::timeout, this, &CleanupScheduler::check);
+}
+
+QString CleanupScheduler::settingsPath() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation) + "/cleanup-schedule.json";
+}
+
+void CleanupScheduler::start()
+{
+    QDir().mkpath(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
+    history.load();
+    reloadSettings();
+    sampleSpace();
+    // Times that already passed today wait for tomorrow
+    lastCheck = QDateTime::currentDateTime();
+    timer->start(CheckIntervalMs);
+}
+
+void CleanupScheduler::stop()
+{
+    timer->stop();
+}
+
+bool CleanupScheduler::isEnabled() const
+{
+    return !current.operations.isEmpty()
+        && (!current.times.isEmpty() || current.minimumFreePercent > 0 || current.minimumHoursToFull > 0);
+}
+
+const CleanupScheduler::Settings &CleanupScheduler::settings() const
+{
+    return current;
+}
+
+QString CleanupScheduler::watchedVolume() const
+{
+    return current.volume.isEmpty() ? QDir::rootPath() : current.volume;
+}
+
+double CleanupScheduler::freePercent() const
+{
+    QStorageInfo volume(watchedVolume());
+    if (!volume.isValid() || volume.bytesTotal() <= 0) return -1;
+    return 100.0 * static_cast<double>(volume.bytesAvailable()) / static_cast<double>(volume.bytesTotal());
+}
+
+SpaceHistory::Forecast CleanupScheduler::forecast(const QString &path) const
+{
+    QStorageInfo volume(path);
+    if (!volume.isValid()) return SpaceHistory::Forecast();
+    return history.forecast(volume.rootPath().toStdString(), QDateTime::currentSecsSinceEpoch());
+}
+
+void CleanupScheduler::sampleSpace()
+{
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    bool added = false;
+    for (const QStorageInfo &volume : QStorageInfo::mountedVolumes()) {
+        if (!isSampledVolume(volume)) continue;
+        added |= history.add(volume.rootPath().toStdString(), now, volume.bytesAvailable(), volume.bytesTotal());
+    }
+    if (added) history.save();
+    emit spaceSampled();
+}
+
+void CleanupScheduler::reloadSettings()
+{
+    const QFileInfo info(settingsPath());
+    const QDateTime modified = info.exists() ? info.lastModified() : QDateTime();
+    if (modified == settingsModified) return;
+    settingsModified = modified;
+
+    QString error;
+    current = readSettings(settingsPath(), &error);
+    if (!error.isEmpty()) {
+        emit settingsError(QString("Ignoring %1: %2").arg(QDir::toNativeSeparators(settingsPath())).arg(error));
+    }
+}
+
+void CleanupScheduler::check()
+{
+    reloadSettings();
+    sampleSpace();
+    const QDateTime now = QDateTime::currentDateTime();
+    const QDateTime previous = lastCheck;
+    lastCheck = now;
+    if (!isEnabled()) return;
+
+    // A time counts once when it passed since the last look, also after
+    // the machine slept through it
+    for (QDate day = previous.date(); day <= now.date(); day = day.addDays(1)) {
+        for (const QTime &time : current.times) {
+            const QDateTime due(day, time);
+            if (due > previous && due <= now) {
+                emit cleanupDue(current.operations, QString("scheduled for %1").arg(time.toString("HH:mm")));
+                return;
+            }
+        }
+    }
+
+    if (lastThresholdRun.isValid() && lastThresholdRun.secsTo(now) < current.cooldownMinutes * 60) return;
+    const QString volume = QDir::toNativeSeparators(watchedVolume());
+
+    const double free = freePercent();
+    if (current.minimumFreePercent > 0 && free >= 0 && free < current.minimumFreePercent) {
+        lastThresholdRun = now;
+        emit cleanupDue(current.operations, QString("only %1% free on %2").arg(free, 0, 'f', 1).arg(volume));
+        return;
+    }
+
+    // Cleaning while there is still room to do it beats cleaning a full disk
+    if (current.minimumHoursToFull > 0) {
+        const SpaceHistory::Forecast trend = forecast(watchedVolume());
+        if (trend.secondsToFull < 0 || trend.secondsToFull >= current.minimumHoursToFull * SecondsPerHour) return;
+        lastThresholdRun = now;
+        emit cleanupDue(current.operations, QString("%1 is on course to fill up within %2 hours")
+                        .arg(volume).arg(trend.secondsToFull / SecondsPerHour));
+    }
+}
+
+CleanupScheduler::Settings CleanupScheduler::readSettings(const QString &filePath, QString *error)
+{
+    Settings settings;
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) return settings;
+
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (parseError.error != QJsonParseError::NoError) {
+        if (error) *error = parseError.errorString();
+        return settings;
+    }
+
+    const QJsonObject object = document.object();
+    for (const QJsonValue &value : object.value("operations").toArray()) {
+        settings.operations << value.toString();
+    }
+    for (const QJsonValue &value : object.value("times").toArray()) {
+        const QTime time = QTime::fromString(value.toString(), "HH:mm");
+        if (time.isValid()) {
+            settings.times << time;
+        } else if (error) {
+            *error = QString("invalid time \"%1\"").arg(value.toString());
+        }
+    }
+    settings.volume = QDir::fromNativeSeparators(object.value("volume").toString());
+    settings.minimumFreePercent = object.value("minFreePercent").toDouble(0);
+    settings.minimumHoursToFull = object.value("minHoursToFull").toDouble(0);
+    settings.cooldownMinutes = object.value("cooldownMinutes").toInt(settings.cooldownMinutes);
+    settings.operationsPerSecond = object.value("maxOpsPerSecond").toInt(settings.operationsPerSecond);
+    settings.pressureLimit = object.value("pressureLimit").toDouble(settings.pressureLimit);
+    return settings;
+}
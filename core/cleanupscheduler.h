@@ -0,0 +1,84 @@
+#ifndef CLEANUPSCHEDULER_H
+#define CLEANUPSCHEDULER_H
+
+#include "spacehistory.h"
+
+#include <QObject>
+#include <QDateTime>
+#include <QList>
+#include <QStringList>
+#include <QTime>
+
+class QTimer;
+
+// Decides when a cleanup should run without anyone asking for it: at set
+// times of day and whenever free space on a volume drops below a share of
+// its size. Lives on the GUI thread and only looks once a minute, on a
+// coarse timer so the wakeup can be merged with others; the cleanup itself
+// is left to whoever receives cleanupDue().
+//
+// Every look also samples the free space of all mounted volumes into a
+// SpaceHistory, so a cleanup can start when the trend says the watched
+// volume fills up within minHoursToFull, before the threshold is reached.
+//
+// The settings are a JSON file, read again whenever it changes:
+// {operations, times ["HH:mm"], volume, minFreePercent, minHoursToFull,
+//  cooldownMinutes, maxOpsPerSecond, pressureLimit}. Without times and
+// thresholds no cleanup is started, but the free space is still sampled.
+class CleanupScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Settings
+    {
+        QStringList operations;
+        QList<QTime> times;
+        QString volume;                 // any path on the watched volume
+        double minimumFreePercent = 0;  // 0 to not watch free space
+        double minimumHoursToFull = 0;  // 0 to ignore the forecast
+        int cooldownMinutes = 60;       // between runs the thresholds start
+        // How gently the cleanup deletes, see IoThrottle
+        int operationsPerSecond = 200;
+        double pressureLimit = 10;
+    };
+
+    explicit CleanupScheduler(QObject *parent = nullptr);
+
+    void start();
+    void stop();
+
+    bool isEnabled() const;
+    const Settings &settings() const;
+    QString settingsPath() const;
+
+    // Free space of the watched volume in percent, -1 when unknown
+    double freePercent() const;
+    // Trend of the volume path is on
+    SpaceHistory::Forecast forecast(const QString &path) const;
+
+    static Settings readSettings(const QString &filePath, QString *error);
+
+signals:
+    void cleanupDue(const QStringList &operations, const QString &reason);
+    void settingsError(const QString &error);
+    // After every look at the free space
+    void spaceSampled();
+
+private slots:
+    void check();
+
+private:
+    void reloadSettings();
+    void sampleSpace();
+    QString watchedVolume() const;
+
+    QTimer *timer;
+    SpaceHistory history;
+    Settings current;
+    QDateTime settingsModified;
+    QDateTime lastCheck;
+    QDateTime lastThresholdRun;
+};
+
+#endif // CLEANUPSCHEDULER_H
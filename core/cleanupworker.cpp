@@ -0,0 +1,1362 @@
+#include "cleanupworker.h"
+#include "dirscanner.h"
+#include "scanindex.h"
+#include "treedeleter.h"
+#include "deletionplan.h"
+#include "duplicatefinder.h"
+#include "pathutils.h"
+#include "cleanuprules.h"
+#include "retryqueue.h"
+#include "quarantine.h"
+#include "logcompressor.h"
+#include "iothrottle.h"
+#include "openfiles.h"
+#include "cachebudget.h"
+#include "trace.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QStandardPaths>
+#include <QStorageInfo>
+#include <QVector>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <system_error>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Minimum spacing between batches sent to the GUI thread
+const int LogFlushIntervalMs = 100;
+const int ProgressIntervalMs = 50;
+
+// Duplicate groups listed in the log, largest savings first
+const int DuplicateGroupsShown = 20;
+const int DuplicatePathsShown = 4;
+
+// Items that could not be deleted listed by name in the final summary
+const int FailedPathsShown = 10;
+
+const int64_t SecondsPerDay = 24 * 60 * 60;
+
+// How long quarantined files can be restored, and how often the purger looks
+const int DefaultQuarantineDays = 7;
+const int QuarantinePurgeIntervalSeconds = 60 * 60;
+
+// Logs untouched for this long are compressed, younger ones may still be
+// read or finished by the program or logrotate
+const int LogCompressionAgeDays = 2;
+
+// What a cleanup does with the files of one root
+enum RootAction { DeleteRoot, QuarantineRoot, CompressRoot };
+
+// Sizes the roots whose rules only take some of their files by counting
+// the files a cleanup would delete. ruleRoots maps every scan root to its
+// CleanupRuleSet root, or -1 for roots that are sized by the scan totals.
+class RuleSizer : public ScanVisitor
+{
+public:
+    RuleSizer(const CleanupRuleSet &ruleSet, const std::vector<int> &roots)
+        : rules(ruleSet)
+        , ruleRoots(roots)
+        , totals(new Counter[roots.size()])
+    {
+    }
+
+    void visitFile(const ScanFileEntry &entry) override
+    {
+        const int ruleRoot = ruleRoots[entry.rootIndex];
+        if (ruleRoot < 0) return;
+        if (entry.dirPath && Quarantine::isStorePath(*entry.dirPath)) return;
+        if (rules.match(ruleRoot, entry) < 0) return;
+        Counter &counter = totals[entry.rootIndex];
+        if (entry.firstLink) {
+            counter.bytes.fetch_add(entry.size, std::memory_order_relaxed);
+            counter.allocated.fetch_add(entry.allocated, std::memory_order_relaxed);
+        }
+        counter.files.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool sizes(size_t root) const { return ruleRoots[root] >= 0; }
+    int64_t bytes(size_t root) const { return totals[root].bytes.load(std::memory_order_relaxed); }
+    int64_t allocated(size_t root) const { return totals[root].allocated.load(std::memory_order_relaxed); }
+    int64_t files(size_t root) const { return totals[root].files.load(std::memory_order_relaxed); }
+
+private:
+    struct Counter
+    {
+        std::atomic<int64_t> bytes{0};
+        std::atomic<int64_t> allocated{0};
+        std::atomic<int64_t> files{0};
+    };
+
+    const CleanupRuleSet &rules;
+    std::vector<int> ruleRoots;
+    std::unique_ptr<Counter[]> totals;
+};
+
+// Collects the files below log roots that are worth compressing: rotated
+// logs the rules select that are not archives already
+class LogCollector : public ScanVisitor
+{
+public:
+    LogCollector(const CleanupRuleSet &ruleSet, const std::vector<size_t> &roots, int64_t modifiedBefore,
+                 const OpenFileSet &openFiles)
+        : rules(ruleSet)
+        , ruleRoots(roots)
+        , cutoff(modifiedBefore)
+        , openFiles(openFiles)
+    {
+    }
+
+    void visitFile(const ScanFileEntry &entry) override
+    {
+        // Hard-linked files would only gain a copy
+        if (!entry.regular || entry.nlink > 1 || entry.mtime > cutoff || !entry.dirPath) return;
+        if (Quarantine::isStorePath(*entry.dirPath) || LogCompressor::isCompressedName(entry.name)) return;
+        if (rules.match(ruleRoots[entry.rootIndex], entry) < 0) return;
+        // A writer still holding it would go on writing into the removed original
+        if (openFiles.contains(entry.device, entry.inode)) return;
+
+        std::lock_guard<std::mutex> guard(lock);
+        paths.push_back(joinPath(*entry.dirPath, entry.name));
+    }
+
+    std::vector<std::string> paths;
+
+private:
+    const CleanupRuleSet &rules;
+    const std::vector<size_t> &ruleRoots;
+    int64_t cutoff;
+    const OpenFileSet &openFiles;
+    std::mutex lock;
+};
+
+// Feeds the files the rules of trimmed roots select to their budgets
+class BudgetCollector : public ScanVisitor
+{
+public:
+    BudgetCollector(const CleanupRuleSet &ruleSet, const std::vector<size_t> &roots,
+                    std::vector<std::unique_ptr<CacheBudget>> &budgets)
+        : rules(ruleSet)
+        , ruleRoots(roots)
+        , budgets(budgets)
+    {
+    }
+
+    void visitFile(const ScanFileEntry &entry) override
+    {
+        const size_t root = ruleRoots[entry.rootIndex];
+        if (entry.dirPath && Quarantine::isStorePath(*entry.dirPath)) return;
+        if (rules.match(root, entry) < 0) return;
+        budgets[root]->add(entry);
+    }
+
+private:
+    const CleanupRuleSet &rules;
+    const std::vector<size_t> &ruleRoots;
+    std::vector<std::unique_ptr<CacheBudget>> &budgets;
+};
+
+// Lets the scan index serve every directory except those below the roots
+// RuleSizer sizes: it has to see each of their files
+class SizingCache : public ScanCache
+{
+public:
+    SizingCache(ScanCache &index, const std::vector<std::string> &roots)
+        : index(index)
+        , uncachedRoots(roots)
+    {
+    }
+
+    bool lookup(const std::string &path, const DirStamp &stamp,
+                ScanTotals &own, std::vector<std::string> &subdirs) override
+    {
+        for (const std::string &root : uncachedRoots) {
+            if (path.compare(0, root.size(), root) == 0
+                && (path.size() == root.size() || path[root.size()] == '/')) {
+                return false;
+            }
+        }
+        return index.lookup(path, stamp, own, subdirs);
+    }
+
+    void store(const std::string &path, const DirStamp &stamp,
+               const ScanTotals &own, const std::vector<std::string> &subdirs) override
+    {
+        index.store(path, stamp, own, subdirs);
+    }
+
+private:
+    ScanCache &index;
+    std::vector<std::string> uncachedRoots;
+};
+
+QString formatSize(qint64 bytes)
+{
+    const qint64 KB = 1024;
+    const qint64 MB = KB * 1024;
+    const qint64 GB = MB * 1024;
+
+    if (bytes >= GB) {
+        return QString("%1 GB").arg(QString::number(bytes / (double)GB, 'f', 2));
+    } else if (bytes >= MB) {
+        return QString("%1 MB").arg(QString::number(bytes / (double)MB, 'f', 2));
+    } else if (bytes >= KB) {
+        return QString("%1 KB").arg(QString::number(bytes / (double)KB, 'f', 2));
+    } else if (bytes > 0) {
+        return QString("%1 bytes").arg(bytes);
+    } else {
+        return QString("0 bytes");
+    }
+}
+
+} // namespace
+
+CleanupWorker::CleanupWorker(QObject *parent)
+    : QObject(parent)
+    , canceled(false)
+    , activeScanner(nullptr)
+    , activeDeleter(nullptr)
+    , activeFinder(nullptr)
+    , activeRetries(nullptr)
+    , activeCompressor(nullptr)
+    , plan(new DeletionPlan())
+    , openFiles(new OpenFileSet())
+    , quarantine(nullptr)
+    , quarantineEnabled(false)
+    , quarantineDays(DefaultQuarantineDays)
+    , compressLogs(false)
+    , cacheBudget(-1)
+    , lowImpact(false)
+    , lowImpactRate(0)
+    , lowImpactPressure(0)
+    , useIoUring(false)
+    , bytesDone(0)
+    , bytesTotal(0)
+    , filesDone(0)
+    , filesTotal(0)
+{
+    logClock.start();
+    progressClock.start();
+
+    // Runs left from earlier sessions are purged once their grace period is over
+    quarantine = new Quarantine(quarantinePath().toStdString());
+    quarantine->startPurger(quarantineDays * SecondsPerDay, QuarantinePurgeIntervalSeconds);
+}
+
+CleanupWorker::~CleanupWorker()
+{
+    delete quarantine;
+    delete openFiles;
+    delete plan;
+}
+
+void CleanupWorker::cancel()
+{
+    canceled = true;
+
+    QMutexLocker locker(&scannerLock);
+    if (activeScanner) activeScanner->cancel();
+    if (activeDeleter) activeDeleter->cancel();
+    if (activeFinder) activeFinder->cancel();
+    if (activeRetries) activeRetries->cancel();
+    if (activeCompressor) activeCompressor->cancel();
+    quarantine->cancel();
+}
+
+void CleanupWorker::resetCancel()
+{
+    canceled = false;
+}
+
+bool CleanupWorker::isCanceled() const
+{
+    return canceled;
+}
+
+QString CleanupWorker::planPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/cleanup.plan";
+}
+
+QString CleanupWorker::quarantinePath() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/quarantine";
+}
+
+void CleanupWorker::setQuarantine(bool enabled, int graceDays)
+{
+    quarantineEnabled = enabled;
+    if (graceDays == quarantineDays) return;
+    quarantineDays = graceDays;
+    quarantine->startPurger(quarantineDays * SecondsPerDay, QuarantinePurgeIntervalSeconds);
+}
+
+void CleanupWorker::setCompressLogs(bool enabled)
+{
+    compressLogs = enabled;
+}
+
+void CleanupWorker::setCacheBudget(qint64 bytes)
+{
+    cacheBudget = bytes;
+}
+
+void CleanupWorker::setLowImpact(bool enabled, int operationsPerSecond, double pressureLimit)
+{
+    lowImpact = enabled;
+    lowImpactRate = operationsPerSecond;
+    lowImpactPressure = pressureLimit;
+}
+
+void CleanupWorker::setUseIoUring(bool enabled)
+{
+    useIoUring = enabled;
+}
+
+int CleanupWorker::quarantinedRuns() const
+{
+    return static_cast<int>(quarantine->runs().size());
+}
+
+void CleanupWorker::restoreLastRun()
+{
+    const std::vector<Quarantine::Run> runs = quarantine->runs();
+    if (runs.empty()) {
+        log("↩️ Nothing to restore, the quarantine is empty");
+    } else {
+        const Quarantine::Run &run = runs.back();
+        const QString created = QDateTime::fromSecsSinceEpoch(run.created).toString("yyyy-MM-dd hh:mm");
+        log(QString("↩️ Restoring the cleanup of %1...").arg(created));
+
+        const Quarantine::Totals totals = quarantine->restore(run.id);
+        log(QString("   ✓ Restored %1 items to %2 folders").arg(totals.entries).arg(run.roots.size()));
+        if (totals.conflicts > 0) {
+            log(QString("   ⚠️ %1 items were kept in quarantine, their names are taken again").arg(totals.conflicts));
+        }
+        if (totals.failures > 0) {
+            log(QString("   ⚠️ %1 folders could not be recreated").arg(totals.failures));
+        }
+    }
+
+    flushLog(true);
+    emit restoreFinished(quarantinedRuns());
+}
+
+bool CleanupWorker::loadPlan(const QString &filePath)
+{
+    return plan->load(filePath.toStdString());
+}
+
+qint64 CleanupWorker::filesScanned() const
+{
+    QMutexLocker locker(&scannerLock);
+    if (activeFinder) return activeFinder->filesScanned();
+    return activeScanner ? activeScanner->filesScanned() : 0;
+}
+
+qint64 CleanupWorker::bytesHashed() const
+{
+    QMutexLocker locker(&scannerLock);
+    return activeFinder ? activeFinder->bytesRead() : 0;
+}
+
+void CleanupWorker::log(const QString &line)
+{
+    pendingLines << line;
+    flushLog(false);
+}
+
+void CleanupWorker::flushLog(bool force)
+{
+    if (pendingLines.isEmpty()) return;
+    if (!force && logClock.elapsed() < LogFlushIntervalMs) return;
+
+    emit logLines(pendingLines);
+    pendingLines.clear();
+    logClock.restart();
+}
+
+void CleanupWorker::addProgress(qint64 bytes, qint64 files)
+{
+    bytesDone += bytes;
+    filesDone += files;
+    reportProgress(false);
+}
+
+void CleanupWorker::reportProgress(bool force)
+{
+    if (!force && progressClock.elapsed() < ProgressIntervalMs) return;
+
+    emit progress(bytesDone, bytesTotal, filesDone, filesTotal);
+    progressClock.restart();
+    flushLog(false);
+}
+
+void CleanupWorker::scan(const QStringList &targets, ScanVisitor *visitor)
+{
+    TraceSpan span("CleanupWorker::scan");
+
+    std::vector<std::string> roots;
+    roots.reserve(targets.size());
+    for (const QString &path : targets) {
+        roots.push_back(QDir::cleanPath(path).toStdString());
+    }
+
+    // Directories unchanged since the previous scan are taken from the
+    // index, unless their listing is more than a day old
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    QDir().mkpath(cacheDir);
+    ScanIndex index((cacheDir + "/scanindex.bin").toStdString());
+    index.load();
+    index.resetStatistics();
+
+    // Roots whose rules only take some of their files are sized by what
+    // the rules select rather than by everything below them
+    std::vector<CleanupRule> rules = builtInRules();
+    std::vector<CleanupRule> siteRules = loadRules(rulesPath());
+    rules.insert(rules.end(), siteRules.begin(), siteRules.end());
+
+    CleanupRuleSet ruleSet;
+    for (const CleanupRule &rule : rules) {
+        if (std::find(roots.begin(), roots.end(), rule.root) != roots.end()) ruleSet.add(rule);
+    }
+    ruleSet.compile(QDateTime::currentSecsSinceEpoch());
+
+    std::vector<int> ruleRoots(roots.size(), -1);
+    std::vector<std::string> sizedRoots;
+    for (size_t i = 0; i < ruleSet.rootCount(); ++i) {
+        if (ruleSet.takesEverything(i)) continue;
+        const size_t root = std::find(roots.begin(), roots.end(), ruleSet.rootPath(i)) - roots.begin();
+        ruleRoots[root] = static_cast<int>(i);
+        sizedRoots.push_back(ruleSet.rootPath(i));
+    }
+    RuleSizer sizer(ruleSet, ruleRoots);
+    SizingCache cache(index, sizedRoots);
+
+    ScanVisitorList visitors;
+    visitors.add(plan);
+    visitors.add(visitor);
+    if (!sizedRoots.empty()) visitors.add(&sizer);
+    plan->begin(roots);
+
+    DirScanner scanner;
+    scanner.setCache(&cache);
+    scanner.setVisitor(&visitors);
+    {
+        QMutexLocker locker(&scannerLock);
+        activeScanner = &scanner;
+    }
+    if (canceled) scanner.cancel();
+
+    // All targets go through one parallel scan so small folders do not
+    // leave cores idle while a large cache tree is still being walked
+    std::vector<ScanTotals> totals = scanner.scan(roots);
+
+    {
+        QMutexLocker locker(&scannerLock);
+        activeScanner = nullptr;
+    }
+
+    // A canceled scan is incomplete, keep the previous index instead
+    if (!canceled) {
+        index.prune(roots);
+        index.save();
+        plan->finish();
+        plan->save(planPath().toStdString());
+    } else {
+        plan->clear();
+    }
+
+    QList<qint64> bytes;
+    QList<qint64> allocated;
+    QList<qint64> files;
+    qint64 fileCount = 0;
+    qint64 errors = 0;
+    for (size_t i = 0; i < totals.size(); ++i) {
+        bytes << (sizer.sizes(i) ? sizer.bytes(i) : totals[i].bytes);
+        allocated << (sizer.sizes(i) ? sizer.allocated(i) : totals[i].allocated);
+        files << (sizer.sizes(i) ? sizer.files(i) : totals[i].files);
+        fileCount += totals[i].files;
+        errors += totals[i].errors;
+    }
+
+    log(QString("   Scanned %1 files using %2 threads").arg(fileCount).arg(scanner.threadCount()));
+    if (scanner.deviceCount() > 1) {
+        log(QString("   Scanned %1 disks in parallel").arg(scanner.deviceCount()));
+    }
+    if (index.hits() > 0) {
+        log(QString("   Reused %1 of %2 directory listings from the previous scan")
+            .arg(index.hits()).arg(index.hits() + index.misses()));
+    }
+    if (errors > 0) {
+        log(QString("   ⚠️ %1 entries could not be read").arg(errors));
+    }
+    if (!plan->isEmpty()) {
+        log(QString("   📝 Deletion plan: %1 files in %2 folders, saved to %3")
+            .arg(plan->fileCount()).arg(plan->directoryCount()).arg(QDir::toNativeSeparators(planPath())));
+    }
+
+    flushLog(true);
+    emit scanFinished(bytes, allocated, files, canceled);
+}
+
+void CleanupWorker::clean(const QStringList &operations, qint64 totalBytes, qint64 totalFiles)
+{
+    TraceSpan span("CleanupWorker::clean");
+    if (span.isActive()) span.setDetail(operations.join(" ").toStdString());
+    bytesDone = 0;
+    filesDone = 0;
+    bytesTotal = totalBytes;
+    filesTotal = totalFiles;
+    reportProgress(true);
+
+    // Free space of the file systems the selected targets live on, read
+    // again at the end to report what the cleanup really gave back
+    QList<QStorageInfo> volumes;
+    for (const ScanTarget &target : scanTargets()) {
+        if (!operations.contains(target.operation)) continue;
+        QStorageInfo volume(target.path);
+        if (volume.isValid() && !volumes.contains(volume)) volumes << volume;
+    }
+    QList<qint64> freeBefore;
+    for (const QStorageInfo &volume : volumes) {
+        freeBefore << volume.bytesFree();
+    }
+
+    // Commands run as child processes while the files are being deleted
+    QProcess *recycleProcess = nullptr;
+    QProcess *dnsProcess = nullptr;
+    QProcess *journalProcess = nullptr;
+#ifdef __linux__
+    // The trash is a file target here and goes with the other folders
+    if (operations.contains("dns")) {
+        log("🔗 Flushing DNS cache...");
+        dnsProcess = startCommand("resolvectl", QStringList() << "flush-caches");
+    }
+    if (operations.contains("logs")) {
+        log("📋 Vacuuming the systemd journal...");
+        journalProcess = startCommand("journalctl", QStringList() << "--vacuum-time=2weeks");
+    }
+#else
+    if (operations.contains("recycle")) {
+        log("🗂️ Emptying recycle bin...");
+        recycleProcess = startCommand("powershell", QStringList() << "-Command" <<
+            "Clear-RecycleBin -Force -ErrorAction SilentlyContinue");
+    }
+    if (operations.contains("dns")) {
+        log("🔗 Flushing DNS cache...");
+        dnsProcess = startCommand("ipconfig", QStringList() << "/flushdns");
+    }
+#endif
+
+    // Files that were locked are retried in the background while the
+    // rest of the cleanup goes on
+    RetryQueue retries;
+    {
+        QMutexLocker locker(&scannerLock);
+        activeRetries = &retries;
+    }
+    if (canceled) retries.cancel();
+
+    cleanFileTargets(operations, retries);
+
+    if (recycleProcess) {
+        QString output = finishCommand(recycleProcess);
+        if (!output.contains("error", Qt::CaseInsensitive)) {
+            log("   ✓ Recycle bin emptied");
+        } else {
+            log("   ⚠️ Recycle bin may require administrator rights");
+        }
+    }
+    if (dnsProcess) {
+        int exitCode = 0;
+        QString output = finishCommand(dnsProcess, &exitCode);
+#ifdef __linux__
+        const bool flushed = exitCode == 0;
+#else
+        const bool flushed = output.contains("successfully", Qt::CaseInsensitive);
+#endif
+        if (flushed) {
+            log("   ✓ DNS cache flushed successfully");
+        } else {
+            log("   ⚠️ DNS flush may require administrator rights");
+        }
+    }
+    if (journalProcess) {
+        int exitCode = 0;
+        QString output = finishCommand(journalProcess, &exitCode);
+        if (exitCode == 0) {
+            // One line per journal directory, e.g. "Vacuuming done, freed 1.2G of
+            // archived journals from /var/log/journal/<machine-id>."
+            QRegularExpression freed("freed (\\S+) of archived journals from (\\S+?)\\.?$",
+                                     QRegularExpression::MultilineOption);
+            QRegularExpressionMatchIterator it = freed.globalMatch(output);
+            while (it.hasNext()) {
+                QRegularExpressionMatch match = it.next();
+                log(QString("   ✓ Freed %1 of archived journals in %2").arg(match.captured(1)).arg(match.captured(2)));
+            }
+        } else {
+            log("   ⚠️ Vacuuming the journal requires administrator rights");
+        }
+    }
+
+    retries.finish();
+    {
+        QMutexLocker locker(&scannerLock);
+        activeRetries = nullptr;
+    }
+    addProgress(retries.bytesRemoved(), retries.filesRemoved());
+    reportFailures(retries);
+
+    for (int i = 0; i < volumes.size(); ++i) {
+        QStorageInfo &volume = volumes[i];
+        volume.refresh();
+        const qint64 gained = volume.bytesFree() - freeBefore[i];
+        if (gained > 0) {
+            log(QString("💾 Free space on %1 grew by %2")
+                .arg(QDir::toNativeSeparators(volume.rootPath())).arg(formatSize(gained)));
+        } else if (quarantineEnabled) {
+            log(QString("💾 Free space on %1 grows once the quarantine is purged")
+                .arg(QDir::toNativeSeparators(volume.rootPath())));
+        } else {
+            log(QString("💾 Free space on %1 did not grow, other programs may be writing to it")
+                .arg(QDir::toNativeSeparators(volume.rootPath())));
+        }
+    }
+
+    flushLog(true);
+    reportProgress(true);
+    emit cleanFinished(canceled);
+}
+
+QProcess *CleanupWorker::startCommand(const QString &command, const QStringList &arguments)
+{
+    QProcess *process = new QProcess(this);
+#ifdef __linux__
+    // systemd tools report on stderr
+    process->setProcessChannelMode(QProcess::MergedChannels);
+#endif
+    process->start(command, arguments);
+    return process;
+}
+
+QString CleanupWorker::finishCommand(QProcess *process, int *exitCode)
+{
+    TraceSpan span("CleanupWorker::finishCommand");
+    if (span.isActive()) span.setDetail(process->program().toStdString());
+    bool finished = process->waitForFinished(5000); // 5 second timeout
+    QString output = QString::fromLocal8Bit(process->readAllStandardOutput());
+    if (exitCode) {
+        *exitCode = finished && process->exitStatus() == QProcess::NormalExit ? process->exitCode() : -1;
+    }
+    delete process;
+    return output;
+}
+
+QList<CleanupWorker::FileTarget> CleanupWorker::fileTargets(const QStringList &operations) const
+{
+    QList<FileTarget> targets;
+    for (const QString &operation : operations) {
+        FileTarget target;
+        target.operation = operation;
+        target.alwaysReport = false;
+
+        if (operation == "temp") {
+            target.title = "🗑️ Cleaning temporary files...";
+            target.description = "temporary files";
+#ifdef __linux__
+        } else if (operation == "recycle") {
+            target.title = "🗂️ Emptying trash...";
+            target.description = "items from the trash";
+            target.alwaysReport = true;
+        } else if (operation == "browser") {
+            target.title = "🌐 Clearing application caches...";
+            target.description = "cache files";
+            target.alwaysReport = true;
+        } else if (operation == "wintemp") {
+            target.title = "💻 Cleaning system temp files...";
+            target.description = "system temp files";
+        } else if (operation == "prefetch") {
+            target.title = "📦 Cleaning package caches...";
+            target.description = "cached packages";
+#else
+        } else if (operation == "browser") {
+            target.title = "🌐 Clearing browser cache...";
+            target.description = "browser cache files";
+            target.alwaysReport = true;
+        } else if (operation == "wintemp") {
+            target.title = "💻 Cleaning Windows temp files...";
+            target.description = "Windows temp files";
+        } else if (operation == "prefetch") {
+            target.title = "⚡ Cleaning prefetch files...";
+            target.description = "prefetch files";
+#endif
+        } else if (operation == "thumbnails") {
+            target.title = "🖼️ Clearing thumbnail cache...";
+            target.description = "thumbnail cache files";
+        } else if (operation == "logs") {
+            target.title = "📋 Cleaning log files...";
+#ifdef __linux__
+            target.description = "rotated log files";
+            target.alwaysReport = QFileInfo("/var/log").isDir();
+#else
+            target.description = "log files";
+            target.alwaysReport = QFileInfo("C:/Windows/Logs").isDir();
+#endif
+        } else {
+            continue;
+        }
+        targets << target;
+    }
+    return targets;
+}
+
+std::vector<CleanupRule> CleanupWorker::builtInRules() const
+{
+    QString cacheLocation = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+
+    auto rule = [](const char *category, const QString &root) {
+        CleanupRule rule;
+        rule.category = category;
+        rule.root = QDir::cleanPath(root).toStdString();
+        return rule;
+    };
+
+    std::vector<CleanupRule> rules;
+
+#ifdef __linux__
+    QString dataLocation = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation);
+
+    // Temp folders are shared with running programs: like systemd-tmpfiles
+    // only files untouched for 10 (/tmp) and 30 days (/var/tmp) go, and
+    // sockets and symlinks of running sessions are left alone. Directories
+    // stay even when empty; programs create them ahead of use (.ICE-unix,
+    // per-session folders) and an emptied one says nothing about its age.
+    CleanupRule temp = rule("temp", QDir::tempPath());
+    temp.minimumAge = 10 * SecondsPerDay;
+    temp.regularOnly = true;
+    temp.removeDirectories = false;
+    rules.push_back(temp);
+
+    CleanupRule varTemp = rule("wintemp", "/var/tmp");
+    varTemp.minimumAge = 30 * SecondsPerDay;
+    varTemp.regularOnly = true;
+    varTemp.removeDirectories = false;
+    rules.push_back(varTemp);
+
+    // Every folder of the XDG cache is a root of its own, except those
+    // that belong to another category and Raptor's own, which holds the
+    // scan index and the deletion plan. Roots must not nest, so the few
+    // loose files next to them stay.
+    const QStringList ownCategory = QStringList() << "thumbnails" << "pip";
+    const QString raptorCache = QDir::cleanPath(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    const QFileInfoList caches = QDir(cacheLocation).entryInfoList(QDir::Dirs | QDir::Hidden | QDir::NoDotAndDotDot);
+    for (const QFileInfo &cache : caches) {
+        if (cache.isSymLink() || ownCategory.contains(cache.fileName())) continue;
+        if (QDir::cleanPath(cache.absoluteFilePath()) == raptorCache) continue;
+        rules.push_back(rule("browser", cache.absoluteFilePath()));
+    }
+
+    rules.push_back(rule("thumbnails", cacheLocation + "/thumbnails"));
+
+    // The trash keeps each item in files/ and its .trashinfo in info/, both
+    // are emptied. Removable drives have a trash folder of their own.
+    QStringList trashes = QStringList() << dataLocation + "/Trash";
+    const QString uid = QString::number(getuid());
+    for (const QStorageInfo &volume : QStorageInfo::mountedVolumes()) {
+        if (!volume.isValid() || volume.isReadOnly() || volume.rootPath() == "/") continue;
+        trashes << volume.rootPath() + "/.Trash-" + uid << volume.rootPath() + "/.Trash/" + uid;
+    }
+    for (const QString &trash : trashes) {
+        rules.push_back(rule("recycle", trash + "/files"));
+        rules.push_back(rule("recycle", trash + "/info"));
+        rules.push_back(rule("recycle", trash + "/expunged"));
+    }
+
+    // Downloaded packages, which the package managers fetch again if needed
+    CleanupRule apt = rule("prefetch", "/var/cache/apt/archives");
+    apt.include.push_back("*.deb");
+    apt.maxDepth = 1;
+    apt.removeDirectories = false;  // older apt refuses to run without archives/partial
+    rules.push_back(apt);
+
+    CleanupRule dnf = rule("prefetch", "/var/cache/dnf");
+    dnf.include.push_back("*.rpm");
+    rules.push_back(dnf);
+
+    rules.push_back(rule("prefetch", cacheLocation + "/pip"));
+    rules.push_back(rule("prefetch", QDir::homePath() + "/.npm/_cacache"));
+
+    // Logs that logrotate already moved aside; the journal is vacuumed by clean()
+    CleanupRule logs = rule("logs", "/var/log");
+    for (const char *pattern : { "*.gz", "*.xz", "*.bz2", "*.zst", "*.old", "*-20??????" }) {
+        logs.include.push_back(pattern);
+    }
+    for (char digit = '0'; digit <= '9'; ++digit) {
+        logs.include.push_back(std::string("*.") + digit);
+    }
+    logs.regularOnly = true;
+    logs.removeDirectories = false;
+    rules.push_back(logs);
+#else
+    QString localAppData = QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation);
+
+    rules.push_back(rule("temp", QDir::tempPath()));
+    rules.push_back(rule("browser", localAppData + "/Google/Chrome/User Data/Default/Cache"));
+    rules.push_back(rule("browser", localAppData + "/Microsoft/Edge/User Data/Default/Cache"));
+    rules.push_back(rule("browser", cacheLocation + "/Mozilla/Firefox"));
+    rules.push_back(rule("wintemp", "C:/Windows/Temp"));
+
+    // Each drive keeps deleted files in a folder per user below
+    // $Recycle.Bin. Only the scan uses these, the bin itself is emptied
+    // through the shell by clean().
+    for (const QStorageInfo &volume : QStorageInfo::mountedVolumes()) {
+        if (!volume.isValid() || volume.isReadOnly()) continue;
+        const QFileInfoList bins = QDir(volume.rootPath() + "/$Recycle.Bin")
+            .entryInfoList(QDir::Dirs | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+        for (const QFileInfo &bin : bins) {
+            if (bin.isReadable()) rules.push_back(rule("recycle", bin.absoluteFilePath()));
+        }
+    }
+
+    CleanupRule prefetch = rule("prefetch", "C:/Windows/Prefetch");
+    prefetch.include.push_back("*.pf");
+    prefetch.maxDepth = 0;
+    rules.push_back(prefetch);
+
+    CleanupRule thumbnails = rule("thumbnails", cacheLocation + "/Microsoft/Windows/Explorer");
+    thumbnails.include.push_back("thumbcache_*.db");
+    thumbnails.maxDepth = 0;
+    rules.push_back(thumbnails);
+
+    // Only log files in subdirectories, and the directories themselves stay
+    CleanupRule logs = rule("logs", "C:/Windows/Logs");
+    logs.minDepth = 1;
+    logs.removeDirectories = false;
+    rules.push_back(logs);
+#endif
+
+    return rules;
+}
+
+QList<CleanupWorker::ScanTarget> CleanupWorker::scanTargets() const
+{
+    std::vector<CleanupRule> rules = builtInRules();
+    std::vector<CleanupRule> siteRules = readRules(rulesPath(), nullptr);
+    rules.insert(rules.end(), siteRules.begin(), siteRules.end());
+
+    CleanupRuleSet ruleSet;
+    for (const CleanupRule &rule : rules) {
+        if (QFileInfo(QString::fromStdString(rule.root)).isDir()) ruleSet.add(rule);
+    }
+    ruleSet.compile(0);
+
+    // A folder shared by several categories is counted for the first one
+    QList<ScanTarget> targets;
+    for (size_t i = 0; i < ruleSet.rootCount(); ++i) {
+        ScanTarget target;
+        target.operation = QString::fromStdString(ruleSet.rule(ruleSet.rootRules(i).front()).category);
+        target.path = QString::fromStdString(ruleSet.rootPath(i));
+        target.filtered = !ruleSet.takesEverything(i);
+        targets << target;
+    }
+    return targets;
+}
+
+QString CleanupWorker::rulesPath() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation) + "/cleanup-rules.json";
+}
+
+std::vector<CleanupRule> CleanupWorker::loadRules(const QString &filePath)
+{
+    QString error;
+    std::vector<CleanupRule> rules = readRules(filePath, &error);
+    if (!error.isEmpty()) {
+        log(QString("   ⚠️ Ignoring %1: %2").arg(QDir::toNativeSeparators(filePath)).arg(error));
+    }
+    return rules;
+}
+
+std::vector<CleanupRule> CleanupWorker::readRules(const QString &filePath, QString *error)
+{
+    std::vector<CleanupRule> rules;
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) return rules;
+
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (parseError.error != QJsonParseError::NoError) {
+        if (error) *error = parseError.errorString();
+        return rules;
+    }
+
+    auto strings = [](const QJsonValue &value) {
+        std::vector<std::string> list;
+        for (const QJsonValue &item : value.toArray()) {
+            list.push_back(item.toString().toStdString());
+        }
+        return list;
+    };
+
+    const QJsonArray entries = document.object().value("rules").toArray();
+    for (const QJsonValue &value : entries) {
+        const QJsonObject object = value.toObject();
+        const QString root = object.value("root").toString();
+        if (root.isEmpty()) continue;
+
+        CleanupRule rule;
+        rule.category = object.value("category").toString().toStdString();
+        rule.root = QDir::cleanPath(QDir::fromNativeSeparators(root)).toStdString();
+        rule.include = strings(object.value("include"));
+        rule.exclude = strings(object.value("exclude"));
+        rule.minimumAge = static_cast<int64_t>(object.value("minAgeDays").toDouble(0) * SecondsPerDay);
+        rule.minimumSize = static_cast<int64_t>(object.value("minSize").toDouble(0));
+        rule.maximumSize = static_cast<int64_t>(object.value("maxSize").toDouble(-1));
+        rule.minDepth = object.value("minDepth").toInt(0);
+        rule.maxDepth = object.value("maxDepth").toInt(-1);
+        rule.removeDirectories = object.value("removeDirectories").toBool(true);
+        rule.regularOnly = object.value("regularOnly").toBool(false);
+        rule.budget = static_cast<int64_t>(object.value("budget").toDouble(-1));
+        rules.push_back(rule);
+    }
+    return rules;
+}
+
+void CleanupWorker::cleanFileTargets(const QStringList &operations, RetryQueue &retries)
+{
+    QList<FileTarget> targets = fileTargets(operations);
+    if (targets.isEmpty()) return;
+
+    std::vector<CleanupRule> rules = builtInRules();
+    std::vector<CleanupRule> siteRules = loadRules(rulesPath());
+    if (!siteRules.empty()) {
+        log(QString("📐 Applying %1 site rules from %2").arg(siteRules.size()).arg(QDir::toNativeSeparators(rulesPath())));
+        rules.insert(rules.end(), siteRules.begin(), siteRules.end());
+    }
+
+    // Caches are only trimmed, so what was used recently stays warm
+    if (cacheBudget >= 0) {
+        for (CleanupRule &rule : rules) {
+            if ((rule.category == "browser" || rule.category == "thumbnails") && rule.budget < 0) {
+                rule.budget = cacheBudget;
+            }
+        }
+    }
+
+    // Rules of the selected categories whose folders exist. Rules on the
+    // same folder share one root and one compiled pattern automaton.
+    CleanupRuleSet ruleSet;
+    QVector<int> ruleTarget;
+    QList<bool> found;
+    for (int i = 0; i < targets.size(); ++i) {
+        const FileTarget &target = targets[i];
+        log(target.title);
+
+        bool exists = false;
+        for (const CleanupRule &rule : rules) {
+            if (QString::fromStdString(rule.category) != target.operation) continue;
+            if (!QFileInfo(QString::fromStdString(rule.root)).isDir()) continue;
+            exists = true;
+            ruleSet.add(rule);
+            ruleTarget << i;
+        }
+        found << (exists || target.alwaysReport);
+    }
+    flushLog(true);
+
+    ruleSet.compile(QDateTime::currentSecsSinceEpoch());
+
+    // Files each rule claimed, to split a shared root's totals between categories
+    std::unique_ptr<std::atomic<int64_t>[]> claimed(new std::atomic<int64_t>[ruleSet.ruleCount()]);
+    for (size_t i = 0; i < ruleSet.ruleCount(); ++i) {
+        claimed[i].store(0, std::memory_order_relaxed);
+    }
+
+    // Files still open somewhere are skipped up front instead of failing
+    // or being pulled from under the program using them
+    std::atomic<int64_t> keptOpen(0);
+    if (OpenFileSet::isSupported()) openFiles->refresh();
+
+    // Roots with a size budget only lose their least recently used files
+    std::vector<std::unique_ptr<CacheBudget>> budgets(ruleSet.rootCount());
+    selectEvictions(ruleSet, budgets);
+
+    // Every category goes into one deleter run: while one target is still
+    // being listed the others are already being deleted, and targets on
+    // different drives proceed at the same time
+    std::vector<TreeDeleter::Root> roots;
+    for (size_t i = 0; i < ruleSet.rootCount(); ++i) {
+        TreeDeleter::Root root;
+        root.path = ruleSet.rootPath(i);
+        root.maxDepth = ruleSet.maxDepth(i);
+        root.recursive = root.maxDepth != 0;
+        root.removeDirectories = ruleSet.removesDirectories(i);
+        // A quarantine store below a root is neither emptied nor removed
+        root.directoryFilter = [](const std::string &path) {
+            return !Quarantine::isStorePath(path);
+        };
+        root.filter = [this, &ruleSet, &claimed, &keptOpen, &budgets, i](const ScanFileEntry &entry) {
+            if (entry.dirPath && Quarantine::isStorePath(*entry.dirPath)) return false;
+            const int rule = ruleSet.match(i, entry);
+            if (rule < 0) return false;
+            if (budgets[i] && !budgets[i]->evicts(entry)) return false;
+            if (openFiles->contains(entry.device, entry.inode)) {
+                keptOpen.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            claimed[rule].fetch_add(1, std::memory_order_relaxed);
+            return true;
+        };
+        roots.push_back(root);
+    }
+
+    // Roots that only hold logs can have them compressed instead
+    std::vector<RootAction> actions(roots.size(), DeleteRoot);
+    if (compressLogs && LogCompressor::isSupported()) {
+        std::vector<size_t> logRoots;
+        for (size_t i = 0; i < roots.size(); ++i) {
+            const std::vector<uint32_t> &rootRules = ruleSet.rootRules(i);
+            const bool onlyLogs = std::all_of(rootRules.begin(), rootRules.end(), [&ruleSet](uint32_t rule) {
+                return ruleSet.rule(rule).category == "logs";
+            });
+            if (!onlyLogs) continue;
+            actions[i] = CompressRoot;
+            logRoots.push_back(i);
+        }
+        if (!logRoots.empty()) compressLogRoots(ruleSet, logRoots);
+    }
+
+    // In quarantine mode roots are moved aside instead. A root whose rules
+    // take everything goes as whole entries, a rename per entry directly
+    // inside it; the others move the files their rules select. Roots the
+    // quarantine has no store for are deleted as usual.
+    if (quarantineEnabled) {
+        const qint64 now = QDateTime::currentSecsSinceEpoch();
+        quarantine->begin(now);
+        if (canceled) quarantine->cancel();
+        Quarantine::Totals moved;
+        for (size_t i = 0; i < roots.size() && !canceled; ++i) {
+            if (actions[i] != DeleteRoot) continue;
+            const bool whole = ruleSet.takesEverything(i) && !budgets[i] && roots[i].maxDepth < 0 && roots[i].removeDirectories;
+            if (quarantine->move(roots[i].path, whole ? TreeDeleter::Filter() : roots[i].filter, moved)) {
+                actions[i] = QuarantineRoot;
+            }
+        }
+        const QString run = QString::fromStdString(quarantine->commit());
+        if (!run.isEmpty()) {
+            log(QString("🛡️ Moved %1 items to quarantine, restorable until %2")
+                .arg(moved.entries)
+                .arg(QDateTime::fromSecsSinceEpoch(now + quarantineDays * SecondsPerDay).toString("yyyy-MM-dd hh:mm")));
+        }
+        if (moved.failures > 0) {
+            log(QString("   ⚠️ %1 items could not be moved and were left in place").arg(moved.failures));
+        }
+        if (run.isEmpty()) std::replace(actions.begin(), actions.end(), QuarantineRoot, DeleteRoot);
+    }
+
+    // Compressing and quarantining take a while and programs open and close
+    // files meanwhile, so the set is taken again before deleting
+    if (OpenFileSet::isSupported()
+        && (quarantineEnabled || std::find(actions.begin(), actions.end(), CompressRoot) != actions.end())) {
+        openFiles->refresh();
+    }
+
+    std::vector<TreeDeleter::Root> deleterRoots;
+    for (size_t i = 0; i < roots.size(); ++i) {
+        if (actions[i] == DeleteRoot) deleterRoots.push_back(roots[i]);
+    }
+
+    TreeDeleter deleter;
+    if (!plan->isEmpty()) deleter.setPlan(plan);
+    IoThrottle throttle(lowImpactRate, lowImpactPressure);
+    if (lowImpact) {
+        deleter.setThrottle(&throttle);
+        deleter.setIdlePriority(true);
+    }
+    // The deleter falls back to unlinkat where the kernel has no support,
+    // and while throttled
+    deleter.setUseIoUring(useIoUring);
+
+    // Called from the deleter threads while this thread is blocked in remove()
+    deleter.setProgressCallback([this](int64_t bytes, int64_t files) {
+        emit progress(bytesDone + bytes, bytesTotal, filesDone + files, filesTotal);
+    }, ProgressIntervalMs);
+    deleter.setFailureCallback([&retries](const std::string &path, int error) {
+        retries.push(path, error);
+    });
+    // Nothing was tried on what could not be read, so there is nothing to
+    // retry either; those are only reported
+    std::mutex unreadableLock;
+    std::vector<std::pair<std::string, int>> unreadable;
+    deleter.setReadFailureCallback([&unreadableLock, &unreadable](const std::string &path, int error) {
+        std::lock_guard<std::mutex> guard(unreadableLock);
+        unreadable.emplace_back(path, error);
+    });
+
+    {
+        QMutexLocker locker(&scannerLock);
+        activeDeleter = &deleter;
+    }
+    if (canceled) deleter.cancel();
+
+    const std::vector<DeleteTotals> deleted = deleter.remove(deleterRoots);
+    if (lowImpact && throttle.waitedMs() >= 1000) {
+        log("   🐢 Deleted at a reduced pace to leave the disk to other programs");
+    }
+    if (!unreadable.empty()) {
+        log(QString("   ⚠️ %1 items could not be read and were left alone:").arg(unreadable.size()));
+        for (size_t i = 0; i < unreadable.size() && i < static_cast<size_t>(FailedPathsShown); ++i) {
+            log(QString("      %1 (%2)")
+                .arg(QDir::toNativeSeparators(QString::fromStdString(unreadable[i].first)))
+                .arg(QString::fromStdString(std::system_category().message(unreadable[i].second))));
+        }
+        if (unreadable.size() > static_cast<size_t>(FailedPathsShown)) {
+            log(QString("      ... and %1 more").arg(unreadable.size() - FailedPathsShown));
+        }
+    }
+    std::vector<DeleteTotals> totals(roots.size());
+    for (size_t i = 0, next = 0; i < roots.size(); ++i) {
+        if (actions[i] == DeleteRoot) totals[i] = deleted[next++];
+    }
+
+    {
+        QMutexLocker locker(&scannerLock);
+        activeDeleter = nullptr;
+    }
+
+    // The plan describes files that are gone now, the next clean needs a new scan
+    plan->clear();
+
+    QVector<qint64> deletedFiles(targets.size(), 0);
+    QVector<qint64> freed(targets.size(), 0);
+    QVector<bool> quarantinedTarget(targets.size(), false);
+    QVector<bool> compressedTarget(targets.size(), false);
+    qint64 changed = 0;
+    for (size_t i = 0; i < totals.size(); ++i) {
+        const std::vector<uint32_t> &rootRules = ruleSet.rootRules(i);
+        if (actions[i] != DeleteRoot) {
+            for (uint32_t rule : rootRules) {
+                const int target = ruleTarget[static_cast<int>(rule)];
+                (actions[i] == QuarantineRoot ? quarantinedTarget : compressedTarget)[target] = true;
+            }
+            continue;
+        }
+        int64_t rootClaimed = 0;
+        for (uint32_t rule : rootRules) {
+            rootClaimed += claimed[rule].load(std::memory_order_relaxed);
+        }
+        for (uint32_t rule : rootRules) {
+            if (rootClaimed == 0) break;
+            const int64_t ruleClaimed = claimed[rule].load(std::memory_order_relaxed);
+            const int target = ruleTarget[static_cast<int>(rule)];
+            deletedFiles[target] += ruleClaimed * totals[i].files / rootClaimed;
+            freed[target] += static_cast<int64_t>(static_cast<double>(totals[i].freed) * ruleClaimed / rootClaimed);
+        }
+        changed += totals[i].changed;
+        addProgress(totals[i].bytes, totals[i].files);
+    }
+
+    for (int i = 0; i < targets.size(); ++i) {
+        if (!found[i]) continue;
+        if (quarantinedTarget[i]) {
+            log(QString("   ✓ Quarantined %1").arg(targets[i].description));
+        }
+        if (deletedFiles[i] > 0 || (!quarantinedTarget[i] && !compressedTarget[i])) {
+            log(QString("   ✓ Deleted %1 %2, freeing %3")
+                .arg(deletedFiles[i]).arg(targets[i].description).arg(formatSize(freed[i])));
+        }
+    }
+    if (changed > 0) {
+        log(QString("   ℹ️ %1 files changed since the scan and were kept").arg(changed));
+    }
+    if (keptOpen > 0) {
+        log(QString("   🔒 %1 files open in running programs were left in place").arg(keptOpen.load()));
+    }
+}
+
+void CleanupWorker::selectEvictions(const CleanupRuleSet &ruleSet, std::vector<std::unique_ptr<CacheBudget>> &budgets)
+{
+    std::vector<size_t> rootIndexes;
+    std::vector<std::string> scanRoots;
+    for (size_t i = 0; i < ruleSet.rootCount(); ++i) {
+        if (ruleSet.budget(i) < 0) continue;
+        budgets[i].reset(new CacheBudget(ruleSet.budget(i), CacheBudget::tracksAccessTime(ruleSet.rootPath(i))));
+        rootIndexes.push_back(i);
+        scanRoots.push_back(ruleSet.rootPath(i));
+    }
+    if (rootIndexes.empty()) return;
+
+    BudgetCollector collector(ruleSet, rootIndexes, budgets);
+    DirScanner scanner;
+    scanner.setVisitor(&collector);
+    {
+        QMutexLocker locker(&scannerLock);
+        activeScanner = &scanner;
+    }
+    if (canceled) scanner.cancel();
+    scanner.scan(scanRoots);
+    {
+        QMutexLocker locker(&scannerLock);
+        activeScanner = nullptr;
+    }
+
+    for (size_t root : rootIndexes) {
+        CacheBudget &budget = *budgets[root];
+        budget.finish();
+        if (budget.evictedFiles() == 0) continue;
+        log(QString("   ✂️ Trimming %1 from %2 to %3, %4 least recently used files go")
+            .arg(QDir::toNativeSeparators(QString::fromStdString(ruleSet.rootPath(root))))
+            .arg(formatSize(budget.totalBytes())).arg(formatSize(budget.keptBytes()))
+            .arg(budget.evictedFiles()));
+    }
+}
+
+void CleanupWorker::compressLogRoots(const CleanupRuleSet &ruleSet, const std::vector<size_t> &rootIndexes)
+{
+    std::vector<std::string> scanRoots;
+    for (size_t root : rootIndexes) {
+        scanRoots.push_back(ruleSet.rootPath(root));
+    }
+
+    const int64_t cutoff = QDateTime::currentSecsSinceEpoch() - LogCompressionAgeDays * SecondsPerDay;
+    LogCollector collector(ruleSet, rootIndexes, cutoff, *openFiles);
+    DirScanner scanner;
+    scanner.setVisitor(&collector);
+    {
+        QMutexLocker locker(&scannerLock);
+        activeScanner = &scanner;
+    }
+    if (canceled) scanner.cancel();
+    scanner.scan(scanRoots);
+    {
+        QMutexLocker locker(&scannerLock);
+        activeScanner = nullptr;
+    }
+    if (canceled || collector.paths.empty()) return;
+
+    LogCompressor compressor;
+    log(QString("📦 Compressing %1 rotated logs on %2 threads...").arg(collector.paths.size()).arg(compressor.threadCount()));
+    flushLog(true);
+    {
+        QMutexLocker locker(&scannerLock);
+        activeCompressor = &compressor;
+    }
+    if (canceled) compressor.cancel();
+
+    const CompressTotals totals = compressor.compress(collector.paths);
+
+    {
+        QMutexLocker locker(&scannerLock);
+        activeCompressor = nullptr;
+    }
+
+    log(QString("   ✓ Compressed %1 log files from %2 to %3")
+        .arg(totals.files).arg(formatSize(totals.bytesIn)).arg(formatSize(totals.bytesOut)));
+    if (totals.changed > 0) {
+        log(QString("   ℹ️ %1 logs were written to meanwhile and were kept as they are").arg(totals.changed));
+    }
+    if (totals.failures > 0) {
+        log(QString("   ⚠️ %1 logs could not be compressed").arg(totals.failures));
+    }
+}
+
+void CleanupWorker::reportFailures(const RetryQueue &retries)
+{
+    if (retries.filesRemoved() > 0) {
+        log(QString("🔁 Deleted %1 locked files (%2) on retry")
+            .arg(retries.filesRemoved()).arg(formatSize(retries.bytesRemoved())));
+    }
+
+    const std::vector<RetryQueue::Failure> failures = retries.failures();
+    if (failures.empty()) return;
+
+    int byReason[RetryQueue::Other + 1] = {};
+    for (const RetryQueue::Failure &failure : failures) {
+        byReason[failure.reason]++;
+    }
+
+    log(QString("⚠️ %1 items could not be deleted:").arg(failures.size()));
+    for (int reason = RetryQueue::Busy; reason <= RetryQueue::Other; ++reason) {
+        if (byReason[reason] == 0) continue;
+        log(QString("   %1 %2").arg(byReason[reason])
+            .arg(RetryQueue::describe(static_cast<RetryQueue::Reason>(reason))));
+    }
+    for (size_t i = 0; i < failures.size() && i < static_cast<size_t>(FailedPathsShown); ++i) {
+        const RetryQueue::Failure &failure = failures[i];
+        log(QString("      %1 (%2 after %3 attempts)")
+            .arg(QDir::toNativeSeparators(QString::fromStdString(failure.path)))
+            .arg(QString::fromStdString(std::system_category().message(failure.error)))
+            .arg(failure.attempts));
+    }
+    if (failures.size() > static_cast<size_t>(FailedPathsShown)) {
+        log(QString("      ... and %1 more").arg(failures.size() - FailedPathsShown));
+    }
+}
+
+void CleanupWorker::findDuplicates(const QStringList &roots)
+{
+    TraceSpan span("CleanupWorker::findDuplicates");
+
+    std::vector<std::string> paths;
+    for (const QString &root : roots) {
+        paths.push_back(QDir::cleanPath(root).toStdString());
+    }
+
+    DuplicateFinder finder;
+    {
+        QMutexLocker locker(&scannerLock);
+        activeFinder = &finder;
+    }
+    if (canceled) finder.cancel();
+    std::vector<DuplicateGroup> groups = finder.find(paths);
+    {
+        QMutexLocker locker(&scannerLock);
+        activeFinder = nullptr;
+    }
+
+    if (!canceled) {
+        qint64 reclaimable = 0;
+        for (const DuplicateGroup &group : groups) {
+            reclaimable += group.reclaimable();
+        }
+
+        log(QString("   Compared %1 of %2 files, read %3")
+            .arg(finder.candidates()).arg(finder.filesScanned()).arg(formatSize(finder.bytesRead())));
+        log("\n🔁 Duplicate Files:");
+        log("────────────────────────");
+        for (size_t i = 0; i < groups.size() && i < static_cast<size_t>(DuplicateGroupsShown); ++i) {
+            const DuplicateGroup &group = groups[i];
+            log(QString("📄 %1 copies of %2 - %3 reclaimable")
+                .arg(group.paths.size()).arg(formatSize(group.size)).arg(formatSize(group.reclaimable())));
+            for (size_t j = 0; j < group.paths.size() && j < static_cast<size_t>(DuplicatePathsShown); ++j) {
+                log("      " + QDir::toNativeSeparators(QString::fromStdString(group.paths[j])));
+            }
+            if (group.paths.size() > static_cast<size_t>(DuplicatePathsShown)) {
+                log(QString("      ... and %1 more").arg(group.paths.size() - DuplicatePathsShown));
+            }
+        }
+        if (groups.size() > static_cast<size_t>(DuplicateGroupsShown)) {
+            log(QString("... and %1 smaller groups").arg(groups.size() - DuplicateGroupsShown));
+        }
+        log("────────────────────────");
+        log(QString("💾 %1 duplicate groups, %2 can be reclaimed").arg(groups.size()).arg(formatSize(reclaimable)));
+    }
+
+    flushLog(true);
+    emit duplicatesFinished(canceled);
+}
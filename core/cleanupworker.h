@@ -0,0 +1,173 @@
+#ifndef CLEANUPWORKER_H
+#define CLEANUPWORKER_H
+
+#include <QObject>
+#include <QStringList>
+#include <QList>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class QProcess;
+class DirScanner;
+class ScanVisitor;
+class TreeDeleter;
+class DeletionPlan;
+class DuplicateFinder;
+class RetryQueue;
+class Quarantine;
+class LogCompressor;
+class OpenFileSet;
+class CacheBudget;
+class CleanupRuleSet;
+struct CleanupRule;
+
+// Runs scanning and cleanup on a worker thread so the Cleaner page stays
+// responsive. Move it to a QThread and call scan() or clean() through a
+// queued invocation; cancel() and filesScanned() may be called from any
+// thread. A cancel stays in effect until resetCancel(), so one issued
+// while an operation is still queued stops that operation too. Log lines
+// and progress are batched so a cleanup touching hundreds of thousands of
+// files does not flood the GUI event loop.
+class CleanupWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    // A folder the scan sizes and the Cleaner operation it is counted for.
+    // When the rules only take some of its files (filtered), the scan
+    // counts just those.
+    struct ScanTarget
+    {
+        QString operation;
+        QString path;
+        bool filtered;
+    };
+
+    explicit CleanupWorker(QObject *parent = nullptr);
+    ~CleanupWorker();
+
+    // Existing folders of the built-in and site rules, in the order scan()
+    // should be given them. Safe to call from any thread.
+    QList<ScanTarget> scanTargets() const;
+
+    // scan() also records a deletion plan, which the next clean() follows
+    // instead of walking the targets again
+    void scan(const QStringList &targets, ScanVisitor *visitor);
+    void clean(const QStringList &operations, qint64 bytesTotal, qint64 filesTotal);
+
+    // Replaces the plan of the last scan, e.g. with one saved earlier and
+    // reviewed with raptor-cli plan show
+    bool loadPlan(const QString &filePath);
+    static QString planPath();
+
+    // Site-specific rules, read at every clean() and applied with the
+    // built-in ones of the same category. A JSON object with a "rules"
+    // array of {category, root, include, exclude, minAgeDays, minSize,
+    // maxSize, minDepth, maxDepth, removeDirectories, regularOnly, budget}.
+    QString rulesPath() const;
+
+    // Looks for files with identical contents below roots and logs the groups
+    void findDuplicates(const QStringList &roots);
+
+    // With quarantine on, clean() moves files into a quarantine instead of
+    // deleting them; they can be restored until they are purged graceDays
+    // later. Purging goes on in the background either way.
+    void setQuarantine(bool enabled, int graceDays);
+    // Rotated logs are gzip-compressed in place instead of deleted
+    void setCompressLogs(bool enabled);
+    // Unattended cleanups delete in the idle I/O class, at most
+    // operationsPerSecond files a second and slower while the disk is
+    // under pressure, see IoThrottle
+    void setLowImpact(bool enabled, int operationsPerSecond = 0, double pressureLimit = 0);
+    // Submits the unlinks as io_uring batches where the kernel supports it.
+    // Off by default: on local disks it measured no faster than unlinkat.
+    void setUseIoUring(bool enabled);
+    // Browser caches and thumbnails are trimmed to this many bytes each,
+    // least recently used files first, instead of emptied. -1 empties them.
+    void setCacheBudget(qint64 bytes);
+    void restoreLastRun();
+    // Cleanups that can still be restored. Safe to call from any thread.
+    int quarantinedRuns() const;
+    QString quarantinePath() const;
+
+    void cancel();
+    // Call before queuing the next operation, from the thread that queues it
+    void resetCancel();
+    bool isCanceled() const;
+    qint64 filesScanned() const;
+    qint64 bytesHashed() const;
+
+signals:
+    void logLines(const QStringList &lines);
+    void progress(qint64 bytesDone, qint64 bytesTotal, qint64 filesDone, qint64 filesTotal);
+    // Per scan target: apparent size, space taken on disk and file count
+    void scanFinished(const QList<qint64> &bytes, const QList<qint64> &allocated,
+                      const QList<qint64> &files, bool canceled);
+    void cleanFinished(bool canceled);
+    void restoreFinished(int runsLeft);
+    void duplicatesFinished(bool canceled);
+
+private:
+    // A file category of the Cleaner; what it deletes is described by rules
+    struct FileTarget
+    {
+        QString operation;
+        QString title;
+        QString description;
+        bool alwaysReport;
+    };
+
+    QList<FileTarget> fileTargets(const QStringList &operations) const;
+    std::vector<CleanupRule> builtInRules() const;
+    std::vector<CleanupRule> loadRules(const QString &filePath);
+    static std::vector<CleanupRule> readRules(const QString &filePath, QString *error);
+    void cleanFileTargets(const QStringList &operations, RetryQueue &retries);
+    void compressLogRoots(const CleanupRuleSet &ruleSet, const std::vector<size_t> &rootIndexes);
+    void selectEvictions(const CleanupRuleSet &ruleSet, std::vector<std::unique_ptr<CacheBudget>> &budgets);
+    void reportFailures(const RetryQueue &retries);
+
+    QProcess *startCommand(const QString &command, const QStringList &arguments = QStringList());
+    QString finishCommand(QProcess *process, int *exitCode = nullptr);
+
+    void log(const QString &line);
+    void flushLog(bool force);
+    void addProgress(qint64 bytes, qint64 files);
+    void reportProgress(bool force);
+
+    std::atomic<bool> canceled;
+
+    mutable QMutex scannerLock;
+    DirScanner *activeScanner;
+    TreeDeleter *activeDeleter;
+    DuplicateFinder *activeFinder;
+    RetryQueue *activeRetries;
+    LogCompressor *activeCompressor;
+
+    DeletionPlan *plan;
+    // Files other processes hold open, refreshed before each step of a clean
+    OpenFileSet *openFiles;
+
+    Quarantine *quarantine;
+    bool quarantineEnabled;
+    int quarantineDays;
+    bool compressLogs;
+    qint64 cacheBudget;
+    bool lowImpact;
+    int lowImpactRate;
+    double lowImpactPressure;
+    bool useIoUring;
+
+    QStringList pendingLines;
+    QElapsedTimer logClock;
+    QElapsedTimer progressClock;
+
+    qint64 bytesDone;
+    qint64 bytesTotal;
+    qint64 filesDone;
+    qint64 filesTotal;
+};
+
+#endif // CLEANUPWORKER_H
@@ -0,0 +1,388 @@
+#include "deletionplan.h"
+#include "binaryio.h"
+#include "pathutils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+const char PlanMagic[4] = {'R', 'P', 'D', 'P'};
+const uint32_t PlanVersion = 1;
+
+void writeName(Writer &writer, const char *name)
+{
+    const size_t length = std::strlen(name);
+    writer.varint(length);
+    writer.raw(name, length);
+}
+
+} // namespace
+
+DeletionPlan::DeletionPlan()
+    : created(0)
+    , bytes(0)
+{
+}
+
+void DeletionPlan::begin(const std::vector<std::string> &roots)
+{
+    clear();
+    created = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    rootPaths = roots;
+    pathIndex.resize(roots.size());
+
+    // Root i is always directory i
+    for (size_t i = 0; i < roots.size(); ++i) {
+        Directory dir;
+        dir.name = addName(roots[i].c_str(), roots[i].size());
+        dir.rootIndex = static_cast<uint32_t>(i);
+        directories.push_back(dir);
+        pathIndex[i].emplace(roots[i], static_cast<uint32_t>(i));
+    }
+}
+
+uint32_t DeletionPlan::addName(const char *name, size_t length)
+{
+    const uint32_t offset = static_cast<uint32_t>(names.size());
+    names.insert(names.end(), name, name + length);
+    names.push_back('\0');
+    return offset;
+}
+
+// Returns the directory for path, creating it and any missing parents.
+// Called with the lock held.
+uint32_t DeletionPlan::internDirectory(int rootIndex, const std::string &path)
+{
+    std::unordered_map<std::string, uint32_t> &index = pathIndex[rootIndex];
+    auto it = index.find(path);
+    if (it != index.end()) return it->second;
+    if (path.size() <= rootPaths[rootIndex].size()) return static_cast<uint32_t>(rootIndex);
+
+    const uint32_t parent = internDirectory(rootIndex, parentPath(path));
+    const size_t slash = path.find_last_of('/');
+
+    Directory dir;
+    dir.parent = parent;
+    dir.name = addName(path.c_str() + slash + 1, path.size() - slash - 1);
+    dir.rootIndex = static_cast<uint32_t>(rootIndex);
+    directories.push_back(dir);
+
+    const uint32_t added = static_cast<uint32_t>(directories.size() - 1);
+    index.emplace(path, added);
+    return added;
+}
+
+void DeletionPlan::visitFile(const ScanFileEntry &entry)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    File file;
+    file.directory = internDirectory(entry.rootIndex, *entry.dirPath);
+    file.name = addName(entry.name, std::strlen(entry.name));
+    file.size = entry.size;
+    file.inode = entry.inode;
+    file.mtime = entry.mtime;
+    files.push_back(file);
+    bytes += entry.size;
+}
+
+void DeletionPlan::leaveDirectory(const ScanDirSummary &summary)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    Directory &dir = directories[internDirectory(summary.rootIndex, *summary.path)];
+    dir.listed = !summary.cached;
+    dir.device = summary.device;
+    dir.inode = summary.inode;
+    dir.mtime = summary.mtime;
+    if (summary.cached) bytes += summary.own.bytes;
+}
+
+void DeletionPlan::finish()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    pathIndex.clear();
+    pathIndex.shrink_to_fit();
+    buildIndexes();
+}
+
+// Groups files by directory and builds the child lists, so a directory's
+// files and subdirectories are contiguous ranges
+void DeletionPlan::buildIndexes()
+{
+    std::stable_sort(files.begin(), files.end(), [](const File &a, const File &b) {
+        return a.directory < b.directory;
+    });
+
+    for (Directory &dir : directories) {
+        dir.childCount = 0;
+        dir.fileCount = 0;
+    }
+    for (const Directory &dir : directories) {
+        if (dir.parent != NoDirectory) directories[dir.parent].childCount++;
+    }
+    for (const File &file : files) {
+        directories[file.directory].fileCount++;
+    }
+
+    uint32_t nextChild = 0;
+    uint32_t nextFile = 0;
+    for (Directory &dir : directories) {
+        dir.firstChild = nextChild;
+        dir.firstFile = nextFile;
+        nextChild += dir.childCount;
+        nextFile += dir.fileCount;
+        dir.childCount = 0;
+    }
+
+    children.assign(nextChild, 0);
+    for (uint32_t i = 0; i < directories.size(); ++i) {
+        const uint32_t parent = directories[i].parent;
+        if (parent == NoDirectory) continue;
+        Directory &owner = directories[parent];
+        children[owner.firstChild + owner.childCount++] = i;
+    }
+}
+
+bool DeletionPlan::save(const std::string &filePath) const
+{
+    Writer writer;
+    writer.raw(PlanMagic, sizeof(PlanMagic));
+    writer.u32(PlanVersion);
+    writer.i64(created);
+
+    writer.varint(rootPaths.size());
+    for (const std::string &root : rootPaths) {
+        writer.str(root);
+    }
+
+    writer.varint(directories.size() - rootPaths.size());
+    for (size_t i = 0; i < directories.size(); ++i) {
+        const Directory &dir = directories[i];
+        if (i >= rootPaths.size()) {
+            // Parents are always created before their children
+            writer.varint(i - dir.parent);
+            writeName(writer, name(dir.name));
+        }
+        writer.u8(dir.listed ? 1 : 0);
+        writer.varint(dir.device);
+        writer.varint(dir.inode);
+        writer.svarint(dir.mtime);
+    }
+
+    // Files are sorted by directory, store the step to the next one
+    writer.varint(files.size());
+    uint32_t previousDir = 0;
+    int64_t previousMtime = 0;
+    for (const File &file : files) {
+        writer.varint(file.directory - previousDir);
+        writeName(writer, name(file.name));
+        writer.varint(static_cast<uint64_t>(file.size));
+        writer.varint(file.inode);
+        writer.svarint(file.mtime - previousMtime);
+        previousDir = file.directory;
+        previousMtime = file.mtime;
+    }
+
+    return writeFileAtomically(filePath, writer.buffer);
+}
+
+bool DeletionPlan::load(const std::string &filePath)
+{
+    clear();
+
+    std::vector<char> data;
+    if (!readWholeFile(filePath, data)) return false;
+
+    Reader reader(data);
+    char magic[4];
+    reader.raw(magic, sizeof(magic));
+    if (!reader.ok() || std::memcmp(magic, PlanMagic, sizeof(magic)) != 0) return false;
+    if (reader.u32() != PlanVersion) return false;
+    created = reader.i64();
+
+    // Names are used relative to their parent's descriptor, one that is not
+    // a single component could lead out of the root
+    std::string scratch;
+    bool badName = false;
+    auto readName = [&]() -> uint32_t {
+        uint64_t length = reader.varint();
+        // A bogus length makes raw() fail instead of allocating
+        if (length > data.size()) length = data.size() + 1;
+        scratch.resize(length);
+        reader.raw(&scratch[0], length);
+        if (reader.ok() && !isPlainName(scratch.data(), scratch.size())) badName = true;
+        return addName(scratch.data(), scratch.size());
+    };
+
+    const uint64_t rootCount = reader.varint();
+    for (uint64_t i = 0; i < rootCount && reader.ok(); ++i) {
+        rootPaths.push_back(reader.str());
+    }
+
+    const uint64_t dirCount = reader.varint();
+    for (uint64_t i = 0; i < rootCount + dirCount && reader.ok() && !badName; ++i) {
+        Directory dir;
+        if (i < rootCount) {
+            dir.name = addName(rootPaths[i].c_str(), rootPaths[i].size());
+            dir.rootIndex = static_cast<uint32_t>(i);
+        } else {
+            const uint64_t step = reader.varint();
+            if (step == 0 || step > i) break;
+            dir.parent = static_cast<uint32_t>(i - step);
+            dir.rootIndex = directories[dir.parent].rootIndex;
+            dir.name = readName();
+        }
+        dir.listed = reader.u8() != 0;
+        dir.device = reader.varint();
+        dir.inode = reader.varint();
+        dir.mtime = reader.svarint();
+        directories.push_back(dir);
+    }
+
+    const uint64_t fileCount = reader.varint();
+    uint32_t previousDir = 0;
+    int64_t previousMtime = 0;
+    for (uint64_t i = 0; i < fileCount && reader.ok() && !badName; ++i) {
+        File file;
+        const uint64_t dirIndex = previousDir + reader.varint();
+        if (dirIndex >= directories.size()) break;
+        file.directory = static_cast<uint32_t>(dirIndex);
+        file.name = readName();
+        file.size = static_cast<int64_t>(reader.varint());
+        file.inode = reader.varint();
+        file.mtime = previousMtime + reader.svarint();
+        files.push_back(file);
+        bytes += file.size;
+        previousDir = file.directory;
+        previousMtime = file.mtime;
+    }
+
+    if (!reader.ok() || badName || directories.size() != rootCount + dirCount
+        || files.size() != fileCount) {
+        // A damaged plan must not delete anything
+        clear();
+        return false;
+    }
+
+    buildIndexes();
+    return true;
+}
+
+bool DeletionPlan::isPlainName(const char *name, size_t length)
+{
+    if (length == 0 || std::memchr(name, '\0', length) || std::memchr(name, '/', length)) return false;
+    return !(length == 1 && name[0] == '.') && !(length == 2 && name[0] == '.' && name[1] == '.');
+}
+
+void DeletionPlan::clear()
+{
+    rootPaths.clear();
+    directories.clear();
+    files.clear();
+    children.clear();
+    names.clear();
+    pathIndex.clear();
+    created = 0;
+    bytes = 0;
+}
+
+bool DeletionPlan::isEmpty() const
+{
+    return directories.empty();
+}
+
+int64_t DeletionPlan::createdAt() const
+{
+    return created;
+}
+
+const std::vector<std::string> &DeletionPlan::roots() const
+{
+    return rootPaths;
+}
+
+size_t DeletionPlan::directoryCount() const
+{
+    return directories.size();
+}
+
+size_t DeletionPlan::fileCount() const
+{
+    return files.size();
+}
+
+int64_t DeletionPlan::totalBytes() const
+{
+    return bytes;
+}
+
+const DeletionPlan::Directory &DeletionPlan::directory(uint32_t index) const
+{
+    return directories[index];
+}
+
+const DeletionPlan::File &DeletionPlan::file(uint32_t index) const
+{
+    return files[index];
+}
+
+uint32_t DeletionPlan::child(const Directory &dir, uint32_t i) const
+{
+    return children[dir.firstChild + i];
+}
+
+const char *DeletionPlan::name(uint32_t offset) const
+{
+    return names.data() + offset;
+}
+
+uint32_t DeletionPlan::findDirectory(const std::string &path) const
+{
+    for (size_t i = 0; i < rootPaths.size(); ++i) {
+        if (!isPathUnder(path, rootPaths[i])) continue;
+
+        uint32_t current = static_cast<uint32_t>(i);
+        size_t start = rootPaths[i].size();
+        while (current != NoDirectory && start < path.size()) {
+            if (path[start] == '/') {
+                ++start;
+                continue;
+            }
+            size_t end = path.find('/', start);
+            if (end == std::string::npos) end = path.size();
+
+            const Directory &dir = directories[current];
+            uint32_t match = NoDirectory;
+            for (uint32_t c = 0; c < dir.childCount; ++c) {
+                const uint32_t candidate = child(dir, c);
+                const char *candidateName = name(directories[candidate].name);
+                if (std::strlen(candidateName) == end - start
+                    && path.compare(start, end - start, candidateName) == 0) {
+                    match = candidate;
+                    break;
+                }
+            }
+            current = match;
+            start = end;
+        }
+        if (current != NoDirectory) return current;
+    }
+    return NoDirectory;
+}
+
+std::string DeletionPlan::directoryPath(uint32_t index) const
+{
+    const Directory &dir = directories[index];
+    if (dir.parent == NoDirectory) return name(dir.name);
+    return joinPath(directoryPath(dir.parent), name(dir.name));
+}
+
+std::string DeletionPlan::filePath(uint32_t index) const
+{
+    const File &entry = files[index];
+    return joinPath(directoryPath(entry.directory), name(entry.name));
+}
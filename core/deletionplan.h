@@ -0,0 +1,104 @@
+#ifndef DELETIONPLAN_H
+#define DELETIONPLAN_H
+
+#include "dirscanner.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Everything a scan found below its roots, recorded so a cleanup can be
+// reviewed, saved and carried out later without walking the trees again.
+// Pass the plan as the visitor of a scan between begin() and finish().
+//
+// Directories form a prefix tree: each one stores only its own name and
+// its parent, files store their directory. Every file keeps the inode,
+// size and mtime seen during the scan; TreeDeleter re-checks them before
+// unlinking and leaves the file alone if any of them changed.
+//
+// Directories served from the ScanCache were not listed, so the plan
+// records only their identity. TreeDeleter lists those when it gets there,
+// but still takes their subdirectories from the plan.
+class DeletionPlan : public ScanVisitor
+{
+public:
+    static const uint32_t NoDirectory = UINT32_MAX;
+
+    struct Directory
+    {
+        uint32_t parent = NoDirectory;
+        uint32_t name = 0;       // offset into the name pool, the full path for roots
+        uint32_t rootIndex = 0;
+        bool listed = false;     // files below were recorded
+        uint64_t device = 0;
+        uint64_t inode = 0;
+        int64_t mtime = 0;
+
+        // Filled in by finish() and load()
+        uint32_t firstChild = 0;
+        uint32_t childCount = 0;
+        uint32_t firstFile = 0;
+        uint32_t fileCount = 0;
+    };
+
+    struct File
+    {
+        uint32_t directory = 0;
+        uint32_t name = 0;
+        int64_t size = 0;
+        uint64_t inode = 0;
+        int64_t mtime = 0;
+    };
+
+    DeletionPlan();
+
+    void begin(const std::vector<std::string> &roots);
+    void visitFile(const ScanFileEntry &entry) override;
+    void leaveDirectory(const ScanDirSummary &dir) override;
+    void finish();
+
+    bool save(const std::string &filePath) const;
+    bool load(const std::string &filePath);
+    void clear();
+
+    bool isEmpty() const;
+    int64_t createdAt() const;
+    const std::vector<std::string> &roots() const;
+    size_t directoryCount() const;
+    size_t fileCount() const;
+    int64_t totalBytes() const;
+
+    const Directory &directory(uint32_t index) const;
+    const File &file(uint32_t index) const;
+    uint32_t child(const Directory &dir, uint32_t i) const;
+    const char *name(uint32_t offset) const;
+    // True for a single path component: not empty, not . or .., and without
+    // a slash. Every name of a loaded plan is one.
+    static bool isPlainName(const char *name, size_t length);
+
+    // Index of the directory at path, or NoDirectory if the plan has none
+    uint32_t findDirectory(const std::string &path) const;
+    std::string directoryPath(uint32_t index) const;
+    std::string filePath(uint32_t index) const;
+
+private:
+    uint32_t addName(const char *name, size_t length);
+    uint32_t internDirectory(int rootIndex, const std::string &path);
+    void buildIndexes();
+
+    std::vector<std::string> rootPaths;
+    std::vector<Directory> directories;
+    std::vector<File> files;
+    std::vector<uint32_t> children;
+    std::vector<char> names;
+    int64_t created;
+    int64_t bytes;
+
+    // Only used while a scan is recording into the plan
+    std::mutex lock;
+    std::vector<std::unordered_map<std::string, uint32_t>> pathIndex;
+};
+
+#endif // DELETIONPLAN_H
@@ -0,0 +1,557 @@
+#include "dirscanner.h"
+#include "blockdevice.h"
+#include "pathutils.h"
+#include "workqueue.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#ifdef __linux__
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <filesystem>
+#include <system_error>
+#endif
+
+namespace {
+
+#ifdef __linux__
+// Layout of the records returned by getdents64
+struct LinuxDirent64
+{
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+const size_t DirentBufferSize = 64 * 1024;
+#endif
+
+struct DirNode
+{
+    std::string path;
+    std::string name;  // within the parent; empty for roots
+    DirNode *parent = nullptr;
+    int rootIndex = 0;
+    int depth = 0;
+    bool skipped = false;
+    bool cached = false;
+    uint64_t device = 0;
+    uint64_t inode = 0;
+    int64_t mtime = 0;
+    ScanTotals own;
+
+    // Subtree totals, filled in by children as they complete
+    std::atomic<int64_t> bytes{0};
+    std::atomic<int64_t> allocated{0};
+    std::atomic<int64_t> files{0};
+    std::atomic<int64_t> directories{0};
+    std::atomic<int64_t> errors{0};
+
+    // One for the directory's own listing plus one per child directory
+    std::atomic<int> pending{1};
+    // Open from processing until the whole subtree is done, so children
+    // are opened relative to it
+    int fd = -1;
+};
+
+bool isDotOrDotDot(const char *name)
+{
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+// (device, inode) of the files with more than one link seen so far, so
+// their bytes are counted for the first name only. Such files are rare,
+// a few locked shards are enough.
+class LinkSet
+{
+public:
+    bool insert(uint64_t device, uint64_t inode)
+    {
+        const Key key{device, inode};
+        Shard &shard = shards[(KeyHash()(key) >> 20) % ShardCount];
+        std::lock_guard<std::mutex> guard(shard.lock);
+        return shard.keys.insert(key).second;
+    }
+
+private:
+    struct Key
+    {
+        uint64_t device;
+        uint64_t inode;
+        bool operator==(const Key &other) const { return device == other.device && inode == other.inode; }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key &key) const
+        {
+            return static_cast<size_t>(key.inode * 0x9E3779B97F4A7C15ULL ^ key.device);
+        }
+    };
+
+    struct Shard
+    {
+        std::mutex lock;
+        std::unordered_set<Key, KeyHash> keys;
+    };
+
+    static const int ShardCount = 16;
+    Shard shards[ShardCount];
+};
+
+class ScanRun
+{
+public:
+    ScanRun(int threadCount, ScanVisitor *visitor, ScanCache *cache, bool crossDevices,
+            const std::atomic<bool> &canceled,
+            std::atomic<int64_t> &fileCounter, std::atomic<int64_t> &byteCounter, LinkSet &links)
+        : visitor(visitor)
+        , cache(cache)
+        , crossDevices(crossDevices)
+        , canceled(canceled)
+        , fileCounter(fileCounter)
+        , byteCounter(byteCounter)
+        , queue(threadCount)
+        , buffers(threadCount)
+        , links(links)
+    {
+#ifdef __linux__
+        for (std::vector<char> &buffer : buffers) {
+            buffer.resize(DirentBufferSize);
+        }
+#endif
+    }
+
+    // Scans the selected roots; totals of the others are left empty
+    std::vector<ScanTotals> run(const std::vector<std::string> &roots, const std::vector<size_t> &selected)
+    {
+        results.assign(roots.size(), ScanTotals());
+        rootDevices.assign(roots.size(), 0);
+
+        for (size_t i = 0; i < selected.size(); ++i) {
+            DirNode *node = new DirNode();
+            node->path = roots[selected[i]];
+            node->rootIndex = static_cast<int>(selected[i]);
+            queue.push(static_cast<int>(i % queue.workerCount()), node);
+        }
+
+        queue.run([this](int self) { workerLoop(self); });
+        return results;
+    }
+
+private:
+    void workerLoop(int self)
+    {
+        DirNode *node = nullptr;
+        while (queue.next(self, node)) {
+            if (!canceled.load(std::memory_order_relaxed)) {
+                processDirectory(self, node);
+            }
+            node->bytes.fetch_add(node->own.bytes, std::memory_order_relaxed);
+            node->allocated.fetch_add(node->own.allocated, std::memory_order_relaxed);
+            node->files.fetch_add(node->own.files, std::memory_order_relaxed);
+            node->directories.fetch_add(node->own.directories, std::memory_order_relaxed);
+            node->errors.fetch_add(node->own.errors, std::memory_order_relaxed);
+            fileCounter.fetch_add(node->own.files, std::memory_order_relaxed);
+            byteCounter.fetch_add(node->own.bytes, std::memory_order_relaxed);
+
+            finishNode(node);
+            queue.done();
+        }
+    }
+
+    DirNode *makeChild(DirNode *parent, const char *name)
+    {
+        DirNode *child = new DirNode();
+        child->path = joinPath(parent->path, name);
+        child->name = name;
+        child->parent = parent;
+        child->rootIndex = parent->rootIndex;
+        child->depth = parent->depth + 1;
+        parent->pending.fetch_add(1, std::memory_order_relaxed);
+        return child;
+    }
+
+    // Completes a node once its listing and all of its children are done,
+    // rolling its subtree totals into the parent.
+    void finishNode(DirNode *node)
+    {
+        while (node && node->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            ScanTotals subtree;
+            subtree.bytes = node->bytes.load(std::memory_order_relaxed);
+            subtree.allocated = node->allocated.load(std::memory_order_relaxed);
+            subtree.files = node->files.load(std::memory_order_relaxed);
+            subtree.directories = node->directories.load(std::memory_order_relaxed);
+            subtree.errors = node->errors.load(std::memory_order_relaxed);
+
+            if (visitor && !node->skipped && node->own.directories > 0) {
+                ScanDirSummary summary;
+                summary.rootIndex = node->rootIndex;
+                summary.depth = node->depth;
+                summary.path = &node->path;
+                summary.device = node->device;
+                summary.inode = node->inode;
+                summary.mtime = node->mtime;
+                summary.cached = node->cached;
+                summary.own = node->own;
+                summary.subtree = subtree;
+                visitor->leaveDirectory(summary);
+            }
+
+            DirNode *parent = node->parent;
+            if (parent) {
+                parent->bytes.fetch_add(subtree.bytes, std::memory_order_relaxed);
+                parent->allocated.fetch_add(subtree.allocated, std::memory_order_relaxed);
+                parent->files.fetch_add(subtree.files, std::memory_order_relaxed);
+                parent->directories.fetch_add(subtree.directories, std::memory_order_relaxed);
+                parent->errors.fetch_add(subtree.errors, std::memory_order_relaxed);
+            } else {
+                results[node->rootIndex] = subtree;
+            }
+#ifdef __linux__
+            if (node->fd >= 0) close(node->fd);
+#endif
+            delete node;
+            node = parent;
+        }
+    }
+
+#ifdef __linux__
+    void processDirectory(int self, DirNode *node)
+    {
+        // Below the root by name relative to the parent, which is still
+        // open: no path lookup from the top for every directory, and a
+        // directory renamed or swapped for a symlink meanwhile is not
+        // followed somewhere else
+        const int flags = O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC;
+        const int fd = node->parent ? openat(node->parent->fd, node->name.c_str(), flags)
+                                    : open(node->path.c_str(), flags);
+        if (fd < 0) {
+            // A missing cleanup target is simply empty, and a directory
+            // removed after its parent was listed is not an error either
+            if (errno != ENOENT) node->own.errors++;
+            return;
+        }
+        node->fd = fd;
+
+        struct stat dirStat;
+        if (fstat(fd, &dirStat) != 0) {
+            node->own.errors++;
+            return;
+        }
+        node->device = dirStat.st_dev;
+        node->inode = dirStat.st_ino;
+        node->mtime = dirStat.st_mtime;
+
+        if (!node->parent) {
+            rootDevices[node->rootIndex] = dirStat.st_dev;
+        } else if (!crossDevices && dirStat.st_dev != rootDevices[node->rootIndex]) {
+            node->skipped = true;
+            return;
+        }
+        node->own.directories = 1;
+
+        DirStamp stamp;
+        std::vector<std::string> subdirs;
+        if (cache) {
+            stamp.device = dirStat.st_dev;
+            stamp.inode = dirStat.st_ino;
+            stamp.mtimeNs = static_cast<int64_t>(dirStat.st_mtim.tv_sec) * 1000000000 + dirStat.st_mtim.tv_nsec;
+            if (cache->lookup(node->path, stamp, node->own, subdirs)) {
+                node->own.directories = 1;
+                node->cached = true;
+                for (const std::string &name : subdirs) {
+                    queue.push(self, makeChild(node, name.c_str()));
+                }
+                return;
+            }
+        }
+
+        std::vector<char> &buffer = buffers[self];
+        ScanFileEntry entry;
+        entry.rootIndex = node->rootIndex;
+        entry.dirFd = fd;
+        entry.dirPath = &node->path;
+
+        for (;;) {
+            long length = syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+            if (length < 0) {
+                node->own.errors++;
+                break;
+            }
+            if (length == 0) break;
+
+            for (long offset = 0; offset < length;) {
+                const LinuxDirent64 *dirent = reinterpret_cast<const LinuxDirent64 *>(buffer.data() + offset);
+                offset += dirent->d_reclen;
+
+                const char *name = dirent->d_name;
+                if (isDotOrDotDot(name)) continue;
+
+                if (dirent->d_type == DT_DIR) {
+                    if (cache) subdirs.emplace_back(name);
+                    queue.push(self, makeChild(node, name));
+                    continue;
+                }
+
+                struct stat st;
+                if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                    // Entries removed while we were listing are not errors
+                    if (errno != ENOENT) node->own.errors++;
+                    continue;
+                }
+                if (S_ISDIR(st.st_mode)) {
+                    if (cache) subdirs.emplace_back(name);
+                    queue.push(self, makeChild(node, name));
+                    continue;
+                }
+
+                const bool firstLink = st.st_nlink <= 1 || links.insert(st.st_dev, st.st_ino);
+                const int64_t allocated = static_cast<int64_t>(st.st_blocks) * 512;
+                node->own.files++;
+                if (firstLink) {
+                    node->own.bytes += st.st_size;
+                    node->own.allocated += allocated;
+                }
+
+                if (visitor) {
+                    entry.name = name;
+                    entry.device = st.st_dev;
+                    entry.inode = st.st_ino;
+                    entry.size = st.st_size;
+                    entry.allocated = allocated;
+                    entry.firstLink = firstLink;
+                    entry.mtime = st.st_mtime;
+                    entry.atime = st.st_atime;
+                    entry.nlink = static_cast<uint32_t>(st.st_nlink);
+                    entry.owner = st.st_uid;
+                    entry.regular = S_ISREG(st.st_mode);
+                    visitor->visitFile(entry);
+                }
+            }
+        }
+
+        if (cache && node->own.errors == 0) {
+            cache->store(node->path, stamp, node->own, subdirs);
+        }
+    }
+#else
+    void processDirectory(int self, DirNode *node)
+    {
+        (void)self;
+        namespace fs = std::filesystem;
+        std::error_code ec;
+        const fs::path dirPath = fs::u8path(node->path);
+
+        fs::directory_iterator it(dirPath, fs::directory_options::skip_permission_denied, ec);
+        if (ec) {
+            if (ec != std::errc::no_such_file_or_directory) node->own.errors++;
+            return;
+        }
+        node->own.directories = 1;
+        node->mtime = unixSeconds(fs::last_write_time(dirPath, ec));
+
+        ScanFileEntry entry;
+        entry.rootIndex = node->rootIndex;
+        entry.dirPath = &node->path;
+
+        for (const fs::directory_entry &child : it) {
+            const std::string name = child.path().filename().u8string();
+            if (child.is_directory(ec) && !child.is_symlink(ec)) {
+                queue.push(self, makeChild(node, name.c_str()));
+                continue;
+            }
+
+            const uintmax_t size = child.is_regular_file(ec) ? child.file_size(ec) : 0;
+            if (ec) {
+                node->own.errors++;
+                ec.clear();
+                continue;
+            }
+
+            // Without st_blocks the apparent size is the best estimate
+            node->own.files++;
+            node->own.bytes += static_cast<int64_t>(size);
+            node->own.allocated += static_cast<int64_t>(size);
+
+            if (visitor) {
+                entry.name = name.c_str();
+                entry.size = static_cast<int64_t>(size);
+                entry.allocated = static_cast<int64_t>(size);
+                entry.regular = child.is_regular_file(ec);
+                entry.mtime = unixSeconds(child.last_write_time(ec));
+                visitor->visitFile(entry);
+            }
+        }
+    }
+#endif
+
+    ScanVisitor *visitor;
+    ScanCache *cache;
+    bool crossDevices;
+    const std::atomic<bool> &canceled;
+    std::atomic<int64_t> &fileCounter;
+    std::atomic<int64_t> &byteCounter;
+
+    WorkQueue<DirNode *> queue;
+    std::vector<std::vector<char>> buffers;
+    std::vector<ScanTotals> results;
+    std::vector<uint64_t> rootDevices;
+    LinkSet &links;
+};
+
+// Roots on the same disk and how many of its directories to read at once
+struct DeviceGroup
+{
+    int threads;
+    std::vector<size_t> roots;
+};
+
+std::vector<DeviceGroup> groupByDevice(const std::vector<std::string> &roots, int threads)
+{
+    std::vector<DeviceGroup> groups;
+#ifdef __linux__
+    std::unordered_map<uint64_t, size_t> groupOfDevice;
+    std::unordered_map<std::string, size_t> groupOfDisk;
+    for (size_t i = 0; i < roots.size(); ++i) {
+        // A root that cannot be read fails in whichever group it lands
+        struct stat rootStat;
+        const uint64_t device = stat(roots[i].c_str(), &rootStat) == 0 ? rootStat.st_dev : 0;
+
+        auto known = groupOfDevice.find(device);
+        if (known == groupOfDevice.end()) {
+            // Partitions of one disk share its group
+            const BlockDevice disk = blockDeviceOf(device);
+            const std::string key = disk.isKnown() ? disk.name : "#" + std::to_string(device);
+            auto group = groupOfDisk.find(key);
+            if (group == groupOfDisk.end()) {
+                group = groupOfDisk.emplace(key, groups.size()).first;
+                groups.push_back(DeviceGroup{disk.concurrency(threads), std::vector<size_t>()});
+            }
+            known = groupOfDevice.emplace(device, group->second).first;
+        }
+        groups[known->second].roots.push_back(i);
+    }
+#else
+    groups.push_back(DeviceGroup{threads, std::vector<size_t>()});
+    for (size_t i = 0; i < roots.size(); ++i) {
+        groups[0].roots.push_back(i);
+    }
+#endif
+    return groups;
+}
+
+} // namespace
+
+DirScanner::DirScanner(int threadCount)
+    : threads(threadCount)
+    , visitor(nullptr)
+    , cache(nullptr)
+    , crossDevices(false)
+    , devices(0)
+    , canceled(false)
+    , fileCounter(0)
+    , byteCounter(0)
+{
+    if (threads <= 0) {
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    threads = std::max(1, threads);
+}
+
+void DirScanner::setVisitor(ScanVisitor *scanVisitor)
+{
+    visitor = scanVisitor;
+}
+
+void DirScanner::setCache(ScanCache *scanCache)
+{
+    cache = scanCache;
+}
+
+void DirScanner::setCrossDevices(bool cross)
+{
+    crossDevices = cross;
+}
+
+std::vector<ScanTotals> DirScanner::scan(const std::vector<std::string> &roots)
+{
+    fileCounter = 0;
+    byteCounter = 0;
+    devices = 0;
+    if (roots.empty()) return std::vector<ScanTotals>();
+
+    // Shared so a file reached through roots on different disks (crossing
+    // mount points) is still counted once
+    LinkSet links;
+    const std::vector<DeviceGroup> groups = groupByDevice(roots, threads);
+    devices = static_cast<int>(groups.size());
+
+    if (groups.size() == 1) {
+        ScanRun run(groups[0].threads, visitor, cache, crossDevices, canceled, fileCounter, byteCounter, links);
+        return run.run(roots, groups[0].roots);
+    }
+
+    // Every disk is scanned at once, each at its own depth, so a slow
+    // spinning disk neither holds back nor is thrashed by the fast ones
+    std::vector<ScanTotals> results(roots.size());
+    auto scanGroup = [&](const DeviceGroup &group) {
+        ScanRun run(group.threads, visitor, cache, crossDevices, canceled, fileCounter, byteCounter, links);
+        const std::vector<ScanTotals> totals = run.run(roots, group.roots);
+        for (size_t index : group.roots) {
+            results[index] = totals[index];
+        }
+    };
+
+    std::vector<std::thread> others;
+    for (size_t i = 1; i < groups.size(); ++i) {
+        others.emplace_back(scanGroup, std::cref(groups[i]));
+    }
+    scanGroup(groups[0]);
+    for (std::thread &other : others) {
+        other.join();
+    }
+    return results;
+}
+
+void DirScanner::cancel()
+{
+    canceled = true;
+}
+
+bool DirScanner::isCanceled() const
+{
+    return canceled;
+}
+
+int DirScanner::threadCount() const
+{
+    return threads;
+}
+
+int DirScanner::deviceCount() const
+{
+    return devices;
+}
+
+int64_t DirScanner::filesScanned() const
+{
+    return fileCounter;
+}
+
+int64_t DirScanner::bytesScanned() const
+{
+    return byteCounter;
+}
@@ -0,0 +1,156 @@
+#ifndef DIRSCANNER_H
+#define DIRSCANNER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Totals gathered for one scan root (or one directory subtree). A file
+// with several hard links is counted in files once per name, but its
+// bytes only once per scan.
+struct ScanTotals
+{
+    int64_t bytes = 0;      // apparent size
+    int64_t allocated = 0;  // space taken on disk (st_blocks), what deleting frees
+    int64_t files = 0;
+    int64_t directories = 0;
+    int64_t errors = 0;
+};
+
+// A non-directory entry found during a scan. dirFd is the open descriptor
+// of the containing directory (-1 on platforms without openat) and is only
+// valid for the duration of the callback.
+struct ScanFileEntry
+{
+    int rootIndex = 0;
+    int dirFd = -1;
+    const std::string *dirPath = nullptr;
+    const char *name = nullptr;
+    uint64_t device = 0;
+    uint64_t inode = 0;
+    int64_t size = 0;
+    int64_t allocated = 0;
+    int64_t mtime = 0;
+    int64_t atime = 0;
+    uint32_t nlink = 1;
+    uint32_t owner = 0;   // uid, always 0 where the platform has none
+    bool regular = true;  // false for symlinks, sockets, devices and the like
+    bool firstLink = true; // false for another name of a file already reported in this scan
+};
+
+// A directory whose whole subtree has been scanned
+struct ScanDirSummary
+{
+    int rootIndex = 0;
+    int depth = 0;
+    const std::string *path = nullptr;
+    uint64_t device = 0;
+    uint64_t inode = 0;
+    int64_t mtime = 0;
+    bool cached = false; // listing came from the ScanCache, no visitFile() calls were made
+    ScanTotals own;      // files directly inside this directory
+    ScanTotals subtree;  // this directory and everything below it
+};
+
+// Identity of a directory at the moment it was opened
+struct DirStamp
+{
+    uint64_t device = 0;
+    uint64_t inode = 0;
+    int64_t mtimeNs = 0;
+};
+
+// Remembers directory listings between scans. When lookup() succeeds the
+// scanner reuses the recorded totals and subdirectory names instead of
+// reading the directory, so visitFile() is not called for its files.
+// Like ScanVisitor, implementations are called from several threads.
+// Only the Linux backend consults the cache.
+class ScanCache
+{
+public:
+    virtual ~ScanCache() = default;
+    virtual bool lookup(const std::string &path, const DirStamp &stamp,
+                        ScanTotals &own, std::vector<std::string> &subdirs) = 0;
+    virtual void store(const std::string &path, const DirStamp &stamp,
+                       const ScanTotals &own, const std::vector<std::string> &subdirs) = 0;
+};
+
+// Receives entries while a scan runs. Callbacks are invoked concurrently
+// from the scanner's worker threads, so implementations must be thread-safe.
+class ScanVisitor
+{
+public:
+    virtual ~ScanVisitor() = default;
+    virtual void visitFile(const ScanFileEntry &entry) { (void)entry; }
+    virtual void leaveDirectory(const ScanDirSummary &dir) { (void)dir; }
+};
+
+// Forwards every callback to several visitors, in order
+class ScanVisitorList : public ScanVisitor
+{
+public:
+    void add(ScanVisitor *visitor)
+    {
+        if (visitor) visitors.push_back(visitor);
+    }
+
+    void visitFile(const ScanFileEntry &entry) override
+    {
+        for (ScanVisitor *visitor : visitors) visitor->visitFile(entry);
+    }
+
+    void leaveDirectory(const ScanDirSummary &dir) override
+    {
+        for (ScanVisitor *visitor : visitors) visitor->leaveDirectory(dir);
+    }
+
+private:
+    std::vector<ScanVisitor *> visitors;
+};
+
+// Parallel recursive directory scanner. Every directory is a task on a
+// per-worker deque: owners work depth-first from the back, idle workers
+// steal from the front, which hands them the largest unexplored subtrees.
+// On Linux directories are read with getdents64 and entries are sized with
+// fstatat relative to the open directory, so no per-file path lookups happen.
+// Subdirectories are opened relative to their parent's descriptor, which
+// stays open until their subtree is done.
+//
+// Roots are grouped by the disk they live on and the disks are scanned in
+// parallel. How many directories of one disk are read at once follows the
+// disk, see BlockDevice::concurrency(); threadCount is the most any disk gets.
+class DirScanner
+{
+public:
+    explicit DirScanner(int threadCount = 0);
+
+    void setVisitor(ScanVisitor *visitor);
+    void setCache(ScanCache *cache);
+    void setCrossDevices(bool cross);
+
+    // Scans every root and returns one totals entry per root, in order.
+    // Blocks until the scan finishes or is canceled.
+    std::vector<ScanTotals> scan(const std::vector<std::string> &roots);
+
+    void cancel();
+    bool isCanceled() const;
+
+    int threadCount() const;
+    // Disks the last scan's roots were spread over
+    int deviceCount() const;
+    int64_t filesScanned() const;
+    int64_t bytesScanned() const;
+
+private:
+    int threads;
+    ScanVisitor *visitor;
+    ScanCache *cache;
+    bool crossDevices;
+    int devices;
+    std::atomic<bool> canceled;
+    std::atomic<int64_t> fileCounter;
+    std::atomic<int64_t> byteCounter;
+};
+
+#endif // DIRSCANNER_H
@@ -0,0 +1,253 @@
+#include "diskusage.h"
+#include "pathutils.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+#ifdef __linux__
+#include <pwd.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Longer "extensions" are usually parts of a versioned or dotted name; the
+// limit also keeps every key inside std::string's small buffer
+const size_t MaxExtensionLength = 15;
+
+std::string extensionOf(const char *name)
+{
+    const char *dot = std::strrchr(name, '.');
+    if (!dot || dot == name || dot[1] == '\0') return "(none)";
+
+    const size_t length = std::strlen(dot + 1);
+    if (length > MaxExtensionLength) return "(other)";
+
+    std::string extension(dot + 1, length);
+    for (char &c : extension) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return extension;
+}
+
+std::string ownerName(uint32_t uid)
+{
+#ifdef __linux__
+    struct passwd entry;
+    struct passwd *result = nullptr;
+    char buffer[1024];
+    if (getpwuid_r(uid, &entry, buffer, sizeof(buffer), &result) == 0 && result) {
+        return result->pw_name;
+    }
+#endif
+    return "uid " + std::to_string(uid);
+}
+
+bool heavierItem(const DiskUsageItem &a, const DiskUsageItem &b)
+{
+    return a.bytes > b.bytes;
+}
+
+} // namespace
+
+void DirectoryLevelCollector::begin(size_t rootCount)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    levels.assign(rootCount, DirectoryLevel());
+}
+
+void DirectoryLevelCollector::leaveDirectory(const ScanDirSummary &dir)
+{
+    if (dir.depth > 1) return;
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (static_cast<size_t>(dir.rootIndex) >= levels.size()) return;
+
+    DirectoryLevel &level = levels[dir.rootIndex];
+    if (dir.depth == 0) {
+        level.files = dir.own;
+        level.files.directories = 0;
+        return;
+    }
+
+    DiskUsageItem item;
+    const size_t slash = dir.path->find_last_of("/\\");
+    item.name = slash == std::string::npos ? *dir.path : dir.path->substr(slash + 1);
+    item.bytes = dir.subtree.bytes;
+    item.files = dir.subtree.files;
+    item.directories = dir.subtree.directories;
+    level.subdirectories.push_back(item);
+}
+
+DirectoryLevel DirectoryLevelCollector::level(size_t rootIndex) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (rootIndex >= levels.size()) return DirectoryLevel();
+
+    DirectoryLevel level = levels[rootIndex];
+    std::sort(level.subdirectories.begin(), level.subdirectories.end(), heavierItem);
+    return level;
+}
+
+DiskUsageAnalyzer::DiskUsageAnalyzer(size_t topCount, size_t groupCount)
+    : topCount(topCount)
+    , groupCount(groupCount)
+    , fileFloor(-1)
+    , directoryFloor(-1)
+{
+}
+
+void DiskUsageAnalyzer::begin(const std::vector<std::string> &roots)
+{
+    // Keys are spread over the shards, so each one gets a slice of the counters
+    const size_t groupsPerShard = std::max<size_t>(1, groupCount / ShardCount);
+    for (Shard &shard : shards) {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        shard.files.setCapacity(topCount);
+        shard.directories.setCapacity(topCount);
+        shard.extensions.setCapacity(groupsPerShard);
+        shard.owners.setCapacity(groupsPerShard);
+    }
+    fileFloor = -1;
+    directoryFloor = -1;
+    levels.begin(roots.size());
+}
+
+void DiskUsageAnalyzer::raiseFloor(std::atomic<int64_t> &floor, int64_t value)
+{
+    int64_t current = floor.load(std::memory_order_relaxed);
+    while (value > current && !floor.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+void DiskUsageAnalyzer::visitFile(const ScanFileEntry &entry)
+{
+    // Every shard keeps its own top entries, so a file lighter than the
+    // lightest entry of any full shard cannot be in the merged top either
+    if (entry.size > fileFloor.load(std::memory_order_relaxed)) {
+        static thread_local const size_t threadShard =
+            std::hash<std::thread::id>()(std::this_thread::get_id()) % ShardCount;
+        Shard &shard = shards[threadShard];
+
+        std::lock_guard<std::mutex> guard(shard.lock);
+        if (shard.files.accepts(entry.size)) {
+            Entry file;
+            file.weight = entry.size;
+            file.files = 1;
+            file.path = joinPath(*entry.dirPath, entry.name);
+            shard.files.push(std::move(file));
+            raiseFloor(fileFloor, shard.files.floor());
+        }
+    }
+
+    const std::string extension = extensionOf(entry.name);
+    {
+        Shard &shard = shards[std::hash<std::string>()(extension) % ShardCount];
+        std::lock_guard<std::mutex> guard(shard.lock);
+        shard.extensions.add(extension, entry.size);
+    }
+
+#ifdef __linux__
+    {
+        Shard &shard = shards[entry.owner % ShardCount];
+        std::lock_guard<std::mutex> guard(shard.lock);
+        shard.owners.add(entry.owner, entry.size);
+    }
+#endif
+}
+
+void DiskUsageAnalyzer::leaveDirectory(const ScanDirSummary &dir)
+{
+    levels.leaveDirectory(dir);
+
+    if (dir.own.bytes <= directoryFloor.load(std::memory_order_relaxed)) return;
+
+    Shard &shard = shards[std::hash<std::string>()(*dir.path) % ShardCount];
+    std::lock_guard<std::mutex> guard(shard.lock);
+    if (shard.directories.accepts(dir.own.bytes)) {
+        Entry directory;
+        directory.weight = dir.own.bytes;
+        directory.files = dir.own.files;
+        directory.path = *dir.path;
+        shard.directories.push(std::move(directory));
+        raiseFloor(directoryFloor, shard.directories.floor());
+    }
+}
+
+std::vector<DiskUsageItem> DiskUsageAnalyzer::mergeEntries(TopK<Entry> Shard::*heap) const
+{
+    std::vector<DiskUsageItem> items;
+    for (Shard &shard : shards) {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        for (const Entry &entry : (shard.*heap).sorted()) {
+            DiskUsageItem item;
+            item.name = entry.path;
+            item.bytes = entry.weight;
+            item.files = entry.files;
+            items.push_back(item);
+        }
+    }
+
+    std::sort(items.begin(), items.end(), heavierItem);
+    if (items.size() > topCount) items.resize(topCount);
+    return items;
+}
+
+std::vector<DiskUsageItem> DiskUsageAnalyzer::largestFiles() const
+{
+    return mergeEntries(&Shard::files);
+}
+
+std::vector<DiskUsageItem> DiskUsageAnalyzer::largestDirectories() const
+{
+    return mergeEntries(&Shard::directories);
+}
+
+std::vector<DiskUsageItem> DiskUsageAnalyzer::byExtension() const
+{
+    std::vector<DiskUsageItem> items;
+    for (Shard &shard : shards) {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        for (const HeavyHitters<std::string>::Counter &counter : shard.extensions.sorted()) {
+            DiskUsageItem item;
+            item.name = counter.key;
+            item.bytes = counter.weight;
+            item.files = counter.count;
+            item.error = counter.error;
+            items.push_back(item);
+        }
+    }
+    std::sort(items.begin(), items.end(), heavierItem);
+    return items;
+}
+
+std::vector<DiskUsageItem> DiskUsageAnalyzer::byOwner() const
+{
+    std::vector<HeavyHitters<uint32_t>::Counter> counters;
+    for (Shard &shard : shards) {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        const std::vector<HeavyHitters<uint32_t>::Counter> owners = shard.owners.sorted();
+        counters.insert(counters.end(), owners.begin(), owners.end());
+    }
+
+    // Name lookups can go out to the network, so they happen without the locks
+    std::vector<DiskUsageItem> items;
+    for (const HeavyHitters<uint32_t>::Counter &counter : counters) {
+        DiskUsageItem item;
+        item.name = ownerName(counter.key);
+        item.bytes = counter.weight;
+        item.files = counter.count;
+        item.error = counter.error;
+        items.push_back(item);
+    }
+    std::sort(items.begin(), items.end(), heavierItem);
+    return items;
+}
+
+DirectoryLevel DiskUsageAnalyzer::rootLevel(size_t rootIndex) const
+{
+    return levels.level(rootIndex);
+}
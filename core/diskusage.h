@@ -0,0 +1,104 @@
+#ifndef DISKUSAGE_H
+#define DISKUSAGE_H
+
+#include "dirscanner.h"
+#include "topk.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// One row of a disk usage report
+struct DiskUsageItem
+{
+    std::string name;   // path, extension or owner
+    int64_t bytes = 0;
+    int64_t files = 0;
+    int64_t directories = 0;  // subtree directories, itself included (tree levels only)
+    int64_t error = 0;  // bytes may be overstated by up to this much (grouped reports only)
+};
+
+// Sizes of everything directly below one directory: one item per
+// subdirectory with its whole subtree, plus the files sitting in it
+struct DirectoryLevel
+{
+    ScanTotals files;
+    std::vector<DiskUsageItem> subdirectories;  // largest first
+};
+
+// Records one DirectoryLevel per scan root. This is how the disk usage
+// tree is expanded: opening a folder scans just that folder and keeps a
+// single level, so memory follows what is on screen, not the file count.
+class DirectoryLevelCollector : public ScanVisitor
+{
+public:
+    void begin(size_t rootCount);
+    void leaveDirectory(const ScanDirSummary &dir) override;
+
+    DirectoryLevel level(size_t rootIndex) const;
+
+private:
+    mutable std::mutex lock;
+    std::vector<DirectoryLevel> levels;
+};
+
+// Streams a scan into bounded reports: the largest files, the folders
+// holding the most bytes directly, and totals by extension and by owner.
+// Every report is a fixed-size heap (see topk.h), so a volume with ten
+// million files costs the same memory as one with a thousand. Paths are
+// only built for entries that make it into a heap; once the heaps are
+// full, a smaller file is turned away by one atomic load.
+//
+// Callbacks come from all scanner threads. Files go to a per-thread shard
+// and extensions and owners to a shard picked by key, so threads rarely
+// wait on each other; shards are merged when a report is read.
+class DiskUsageAnalyzer : public ScanVisitor
+{
+public:
+    explicit DiskUsageAnalyzer(size_t topCount = 100, size_t groupCount = 512);
+
+    void begin(const std::vector<std::string> &roots);
+    void visitFile(const ScanFileEntry &entry) override;
+    void leaveDirectory(const ScanDirSummary &dir) override;
+
+    std::vector<DiskUsageItem> largestFiles() const;
+    std::vector<DiskUsageItem> largestDirectories() const;
+    std::vector<DiskUsageItem> byExtension() const;
+    std::vector<DiskUsageItem> byOwner() const;
+
+    // The first level of the tree below each root
+    DirectoryLevel rootLevel(size_t rootIndex) const;
+
+private:
+    struct Entry
+    {
+        int64_t weight = 0;
+        int64_t files = 0;
+        std::string path;
+    };
+
+    struct Shard
+    {
+        std::mutex lock;
+        TopK<Entry> files;
+        TopK<Entry> directories;
+        HeavyHitters<std::string> extensions;
+        HeavyHitters<uint32_t> owners;
+    };
+
+    static const size_t ShardCount = 16;
+
+    static void raiseFloor(std::atomic<int64_t> &floor, int64_t value);
+    std::vector<DiskUsageItem> mergeEntries(TopK<Entry> Shard::*heap) const;
+
+    size_t topCount;
+    size_t groupCount;
+    mutable Shard shards[ShardCount];
+    std::atomic<int64_t> fileFloor;
+    std::atomic<int64_t> directoryFloor;
+    DirectoryLevelCollector levels;
+};
+
+#endif // DISKUSAGE_H
@@ -0,0 +1,400 @@
+#include "duplicatefinder.h"
+#include "fasthash.h"
+#include "pathutils.h"
+#include "workqueue.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+namespace {
+
+const int64_t SampleBytes = 4 * 1024;
+// Files up to this size are read whole during sampling
+const int64_t WholeFileSampleLimit = 64 * 1024;
+const int64_t FirstRoundBytes = 1024 * 1024;
+const int64_t MaxRoundBytes = 256LL * 1024 * 1024;
+const size_t ReadBufferSize = 1024 * 1024;
+
+// Sequential reader for one file
+class FileSource
+{
+public:
+    FileSource() = default;
+    ~FileSource() { close(); }
+
+    bool open(const std::string &path, int64_t offset)
+    {
+#ifdef __linux__
+        // O_NOATIME keeps a duplicate search from rewriting every inode,
+        // but is only allowed on files we own
+        fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NOATIME);
+        if (fd < 0 && errno == EPERM) fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        posix_fadvise(fd, offset, 0, POSIX_FADV_SEQUENTIAL);
+        return true;
+#else
+        (void)offset;
+        stream.open(path, std::ios::binary);
+        return stream.is_open();
+#endif
+    }
+
+    // Reads length bytes at offset, returns false on a short read
+    bool read(int64_t offset, char *buffer, size_t length)
+    {
+#ifdef __linux__
+        size_t done = 0;
+        while (done < length) {
+            ssize_t count = pread(fd, buffer + done, length - done, offset + static_cast<int64_t>(done));
+            if (count < 0 && errno == EINTR) continue;
+            if (count <= 0) return false;
+            done += static_cast<size_t>(count);
+        }
+        return true;
+#else
+        stream.seekg(offset);
+        stream.read(buffer, static_cast<std::streamsize>(length));
+        return stream.gcount() == static_cast<std::streamsize>(length);
+#endif
+    }
+
+    void close()
+    {
+#ifdef __linux__
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+#else
+        stream.close();
+#endif
+    }
+
+private:
+#ifdef __linux__
+    int fd = -1;
+#else
+    std::ifstream stream;
+#endif
+};
+
+} // namespace
+
+// Records every regular file worth comparing while the scan runs
+class DuplicateFinder::Collector : public ScanVisitor
+{
+public:
+    Collector(DuplicateFinder &finder) : finder(finder) {}
+
+    void visitFile(const ScanFileEntry &entry) override
+    {
+        if (!entry.regular || entry.size < finder.minimumSize) return;
+
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = directoryIndex.find(*entry.dirPath);
+        if (it == directoryIndex.end()) {
+            it = directoryIndex.emplace(*entry.dirPath, static_cast<uint32_t>(finder.directories.size())).first;
+            finder.directories.push_back(*entry.dirPath);
+        }
+
+        Candidate candidate;
+        candidate.directory = it->second;
+        candidate.name = static_cast<uint32_t>(finder.names.size());
+        candidate.size = entry.size;
+        candidate.device = entry.device;
+        candidate.inode = entry.inode;
+        finder.names.insert(finder.names.end(), entry.name, entry.name + std::strlen(entry.name) + 1);
+        finder.files.push_back(candidate);
+    }
+
+private:
+    DuplicateFinder &finder;
+    std::mutex lock;
+    std::unordered_map<std::string, uint32_t> directoryIndex;
+};
+
+DuplicateFinder::DuplicateFinder(int threadCount)
+    : threads(threadCount)
+    , minimumSize(1)
+    , canceled(false)
+    , currentStage(Scanning)
+    , fileCounter(0)
+    , candidateCount(0)
+    , readCounter(0)
+    , activeScanner(nullptr)
+{
+    // Reading is mostly waiting on the disk, so use a few more threads than cores
+    if (threads <= 0) {
+        threads = std::max(4, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+}
+
+void DuplicateFinder::setMinimumSize(int64_t bytes)
+{
+    minimumSize = std::max<int64_t>(1, bytes);
+}
+
+std::string DuplicateFinder::candidatePath(const Candidate &candidate) const
+{
+    return joinPath(directories[candidate.directory], names.data() + candidate.name);
+}
+
+std::vector<DuplicateGroup> DuplicateFinder::find(const std::vector<std::string> &roots)
+{
+    files.clear();
+    directories.clear();
+    names.clear();
+    fileCounter = 0;
+    candidateCount = 0;
+    readCounter = 0;
+    currentStage = Scanning;
+
+    Collector collector(*this);
+    DirScanner scanner;
+    scanner.setVisitor(&collector);
+    {
+        std::lock_guard<std::mutex> guard(scannerLock);
+        activeScanner = &scanner;
+    }
+    if (canceled) scanner.cancel();
+    std::vector<ScanTotals> totals = scanner.scan(roots);
+    {
+        std::lock_guard<std::mutex> guard(scannerLock);
+        activeScanner = nullptr;
+    }
+    for (const ScanTotals &total : totals) {
+        fileCounter += total.files;
+    }
+
+    // Group by size; hard links to one inode are the same data, keep one
+    std::vector<uint32_t> active(files.size());
+    for (uint32_t i = 0; i < active.size(); ++i) {
+        active[i] = i;
+    }
+    std::sort(active.begin(), active.end(), [this](uint32_t a, uint32_t b) {
+        const Candidate &x = files[a];
+        const Candidate &y = files[b];
+        if (x.size != y.size) return x.size < y.size;
+        if (x.device != y.device) return x.device < y.device;
+        return x.inode < y.inode;
+    });
+    active.erase(std::unique(active.begin(), active.end(), [this](uint32_t a, uint32_t b) {
+        return files[a].size == files[b].size && files[a].device == files[b].device
+            && files[a].inode == files[b].inode;
+    }), active.end());
+    regroup(active, nullptr);
+    candidateCount = static_cast<int64_t>(active.size());
+
+    std::vector<uint32_t> completed;
+    if (!canceled) {
+        currentStage = Sampling;
+        sample(active);
+        regroup(active, &completed);
+    }
+    if (!canceled) {
+        currentStage = Hashing;
+        hashInRounds(active);
+        completed.insert(completed.end(), active.begin(), active.end());
+    }
+    currentStage = Done;
+
+    std::vector<DuplicateGroup> groups;
+    if (canceled) return groups;
+
+    // completed holds runs of identical (size, hash)
+    for (size_t start = 0; start < completed.size();) {
+        size_t end = start + 1;
+        while (end < completed.size() && files[completed[end]].size == files[completed[start]].size
+               && files[completed[end]].hash == files[completed[start]].hash) {
+            ++end;
+        }
+        DuplicateGroup group;
+        group.size = files[completed[start]].size;
+        for (size_t i = start; i < end; ++i) {
+            group.paths.push_back(candidatePath(files[completed[i]]));
+        }
+        std::sort(group.paths.begin(), group.paths.end());
+        groups.push_back(std::move(group));
+        start = end;
+    }
+
+    std::sort(groups.begin(), groups.end(), [](const DuplicateGroup &a, const DuplicateGroup &b) {
+        return a.reclaimable() > b.reclaimable();
+    });
+    return groups;
+}
+
+// Sorts by (size, hash), drops failed files and files without a twin, and
+// moves groups that were read completely into completed
+void DuplicateFinder::regroup(std::vector<uint32_t> &active, std::vector<uint32_t> *completed)
+{
+    std::stable_sort(active.begin(), active.end(), [this](uint32_t a, uint32_t b) {
+        if (files[a].size != files[b].size) return files[a].size < files[b].size;
+        return files[a].hash < files[b].hash;
+    });
+
+    std::vector<uint32_t> kept;
+    std::vector<uint32_t> run;
+    for (size_t start = 0; start < active.size();) {
+        size_t end = start;
+        run.clear();
+        while (end < active.size() && files[active[end]].size == files[active[start]].size
+               && files[active[end]].hash == files[active[start]].hash) {
+            if (!files[active[end]].failed) run.push_back(active[end]);
+            ++end;
+        }
+        if (run.size() >= 2) {
+            const bool done = completed && files[run.front()].complete;
+            std::vector<uint32_t> &target = done ? *completed : kept;
+            target.insert(target.end(), run.begin(), run.end());
+        }
+        start = end;
+    }
+    active.swap(kept);
+}
+
+template <typename Body>
+void DuplicateFinder::runParallel(const std::vector<uint32_t> &items, Body body)
+{
+    if (items.empty()) return;
+
+    const int workers = std::max(1, std::min(threads, static_cast<int>(items.size())));
+    WorkQueue<uint32_t> queue(workers);
+    for (size_t i = 0; i < items.size(); ++i) {
+        queue.push(static_cast<int>(i % workers), items[i]);
+    }
+
+    std::vector<std::vector<char>> buffers(workers);
+    queue.run([&](int self) {
+        uint32_t item = 0;
+        while (queue.next(self, item)) {
+            if (!canceled.load(std::memory_order_relaxed)) {
+                std::vector<char> &buffer = buffers[self];
+                if (buffer.empty()) buffer.resize(ReadBufferSize);
+                body(item, buffer);
+            }
+            queue.done();
+        }
+    });
+}
+
+void DuplicateFinder::sample(std::vector<uint32_t> &active)
+{
+    runParallel(active, [this](uint32_t index, std::vector<char> &buffer) {
+        Candidate &candidate = files[index];
+        FileSource source;
+        if (!source.open(candidatePath(candidate), 0)) {
+            candidate.failed = true;
+            return;
+        }
+
+        FastHash hash;
+        if (candidate.size <= WholeFileSampleLimit) {
+            const size_t length = static_cast<size_t>(candidate.size);
+            if (!source.read(0, buffer.data(), length)) {
+                candidate.failed = true;
+                return;
+            }
+            hash.update(buffer.data(), length);
+            candidate.complete = true;
+            readCounter.fetch_add(candidate.size, std::memory_order_relaxed);
+        } else {
+            if (!source.read(0, buffer.data(), SampleBytes)
+                || !source.read(candidate.size - SampleBytes, buffer.data() + SampleBytes, SampleBytes)) {
+                candidate.failed = true;
+                return;
+            }
+            hash.update(buffer.data(), 2 * SampleBytes);
+            readCounter.fetch_add(2 * SampleBytes, std::memory_order_relaxed);
+        }
+        candidate.hash = hash.digest();
+    });
+}
+
+void DuplicateFinder::hashInRounds(std::vector<uint32_t> &active)
+{
+    // Streaming state per active file, keyed by candidate index
+    std::unordered_map<uint32_t, FastHash> states;
+    for (uint32_t index : active) {
+        states.emplace(index, FastHash());
+    }
+
+    std::vector<uint32_t> finished;
+    int64_t offset = 0;
+    int64_t roundBytes = FirstRoundBytes;
+    while (!active.empty() && !canceled) {
+        const int64_t roundEnd = offset + roundBytes;
+        runParallel(active, [&](uint32_t index, std::vector<char> &buffer) {
+            Candidate &candidate = files[index];
+            const int64_t end = std::min(roundEnd, candidate.size);
+            FileSource source;
+            if (!source.open(candidatePath(candidate), offset)) {
+                candidate.failed = true;
+                return;
+            }
+
+            FastHash &state = states.at(index);
+            for (int64_t position = offset; position < end;) {
+                const size_t length = static_cast<size_t>(std::min<int64_t>(end - position, buffer.size()));
+                if (!source.read(position, buffer.data(), length)) {
+                    candidate.failed = true;
+                    return;
+                }
+                state.update(buffer.data(), length);
+                readCounter.fetch_add(static_cast<int64_t>(length), std::memory_order_relaxed);
+                position += static_cast<int64_t>(length);
+                if (canceled.load(std::memory_order_relaxed)) return;
+            }
+            candidate.hash = state.digest();
+            candidate.complete = end >= candidate.size;
+        });
+
+        // Groups read to the end are set aside, the rest go another round
+        regroup(active, &finished);
+        offset = roundEnd;
+        roundBytes = std::min(roundBytes * 4, MaxRoundBytes);
+    }
+    active.swap(finished);
+}
+
+void DuplicateFinder::cancel()
+{
+    canceled = true;
+
+    std::lock_guard<std::mutex> guard(scannerLock);
+    if (activeScanner) activeScanner->cancel();
+}
+
+bool DuplicateFinder::isCanceled() const
+{
+    return canceled;
+}
+
+DuplicateFinder::Stage DuplicateFinder::stage() const
+{
+    return static_cast<Stage>(currentStage.load());
+}
+
+int64_t DuplicateFinder::filesScanned() const
+{
+    std::lock_guard<std::mutex> guard(scannerLock);
+    return activeScanner ? activeScanner->filesScanned() : fileCounter.load();
+}
+
+int64_t DuplicateFinder::candidates() const
+{
+    return candidateCount;
+}
+
+int64_t DuplicateFinder::bytesRead() const
+{
+    return readCounter;
+}
@@ -0,0 +1,96 @@
+#ifndef DUPLICATEFINDER_H
+#define DUPLICATEFINDER_H
+
+#include "dirscanner.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// A set of files with identical contents
+struct DuplicateGroup
+{
+    int64_t size = 0;  // size of each copy
+    std::vector<std::string> paths;
+
+    // Space freed by keeping a single copy
+    int64_t reclaimable() const { return size * static_cast<int64_t>(paths.size() - 1); }
+};
+
+// Finds files with identical contents below a set of roots, reading as
+// little as possible:
+//
+//   1. the parallel scan groups regular files by size; hard links to the
+//      same inode count once, a size nobody else has is never opened
+//   2. files sharing a size are sampled, 4 KB from the head and 4 KB
+//      from the tail, and regrouped by that hash (small files are hashed
+//      whole here and are done)
+//   3. survivors are hashed in rounds of growing chunks (1 MB, 4 MB, ...),
+//      regrouping after every round, so two large files that differ early
+//      stop being read as soon as they do
+//
+// Every stage runs on the shared work-stealing pool, so one file's read
+// overlaps another's hashing. Reads are large sequential preads with the
+// kernel told to read ahead.
+class DuplicateFinder
+{
+public:
+    enum Stage { Scanning, Sampling, Hashing, Done };
+
+    explicit DuplicateFinder(int threadCount = 0);
+
+    // Files smaller than this are ignored (default 1 byte, empty files are never duplicates)
+    void setMinimumSize(int64_t bytes);
+
+    // Blocks until done or canceled. Groups are sorted by reclaimable space.
+    std::vector<DuplicateGroup> find(const std::vector<std::string> &roots);
+
+    void cancel();
+    bool isCanceled() const;
+
+    Stage stage() const;
+    int64_t filesScanned() const;
+    int64_t candidates() const;
+    int64_t bytesRead() const;
+
+private:
+    struct Candidate
+    {
+        uint32_t directory = 0;
+        uint32_t name = 0;
+        int64_t size = 0;
+        uint64_t device = 0;
+        uint64_t inode = 0;
+        uint64_t hash = 0;
+        bool complete = false;
+        bool failed = false;
+    };
+
+    class Collector;
+
+    std::string candidatePath(const Candidate &candidate) const;
+    void sample(std::vector<uint32_t> &active);
+    void hashInRounds(std::vector<uint32_t> &active);
+    template <typename Body>
+    void runParallel(const std::vector<uint32_t> &items, Body body);
+    void regroup(std::vector<uint32_t> &active, std::vector<uint32_t> *completed);
+
+    int threads;
+    int64_t minimumSize;
+    std::atomic<bool> canceled;
+    std::atomic<int> currentStage;
+    std::atomic<int64_t> fileCounter;
+    std::atomic<int64_t> candidateCount;
+    std::atomic<int64_t> readCounter;
+
+    DirScanner *activeScanner;
+    mutable std::mutex scannerLock;
+
+    std::vector<Candidate> files;
+    std::vector<std::string> directories;
+    std::vector<char> names;
+};
+
+#endif // DUPLICATEFINDER_H
@@ -0,0 +1,159 @@
+#ifndef FASTHASH_H
+#define FASTHASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Streaming 64-bit XXH64. Not cryptographic, but with four independent
+// lanes of 8 bytes each it keeps the multipliers busy and runs at memory
+// bandwidth, which is what matters when comparing file contents.
+class FastHash
+{
+public:
+    explicit FastHash(uint64_t seed = 0)
+    {
+        reset(seed);
+    }
+
+    void reset(uint64_t seed = 0)
+    {
+        lanes[0] = seed + Prime1 + Prime2;
+        lanes[1] = seed + Prime2;
+        lanes[2] = seed;
+        lanes[3] = seed - Prime1;
+        seedValue = seed;
+        total = 0;
+        pending = 0;
+    }
+
+    void update(const void *data, size_t length)
+    {
+        const unsigned char *input = static_cast<const unsigned char *>(data);
+        total += length;
+
+        if (pending + length < StripeSize) {
+            std::memcpy(stripe + pending, input, length);
+            pending += length;
+            return;
+        }
+
+        if (pending > 0) {
+            const size_t fill = StripeSize - pending;
+            std::memcpy(stripe + pending, input, fill);
+            consumeStripe(stripe);
+            input += fill;
+            length -= fill;
+            pending = 0;
+        }
+
+        while (length >= StripeSize) {
+            consumeStripe(input);
+            input += StripeSize;
+            length -= StripeSize;
+        }
+
+        std::memcpy(stripe, input, length);
+        pending = length;
+    }
+
+    // Digest of everything so far; more data may still be added afterwards
+    uint64_t digest() const
+    {
+        uint64_t hash;
+        if (total >= StripeSize) {
+            hash = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+            for (uint64_t lane : lanes) {
+                hash = (hash ^ round(0, lane)) * Prime1 + Prime4;
+            }
+        } else {
+            hash = seedValue + Prime5;
+        }
+        hash += total;
+
+        const unsigned char *p = stripe;
+        size_t left = pending;
+        while (left >= 8) {
+            hash ^= round(0, read64(p));
+            hash = rotl(hash, 27) * Prime1 + Prime4;
+            p += 8;
+            left -= 8;
+        }
+        if (left >= 4) {
+            hash ^= static_cast<uint64_t>(read32(p)) * Prime1;
+            hash = rotl(hash, 23) * Prime2 + Prime3;
+            p += 4;
+            left -= 4;
+        }
+        while (left > 0) {
+            hash ^= (*p) * Prime5;
+            hash = rotl(hash, 11) * Prime1;
+            ++p;
+            --left;
+        }
+
+        hash ^= hash >> 33;
+        hash *= Prime2;
+        hash ^= hash >> 29;
+        hash *= Prime3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+    static uint64_t hash(const void *data, size_t length, uint64_t seed = 0)
+    {
+        FastHash state(seed);
+        state.update(data, length);
+        return state.digest();
+    }
+
+private:
+    static const uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+    static const uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+    static const uint64_t Prime3 = 0x165667B19E3779F9ULL;
+    static const uint64_t Prime4 = 0x85EBCA77C2B2AE63ULL;
+    static const uint64_t Prime5 = 0x27D4EB2F165667C5ULL;
+    static const size_t StripeSize = 32;
+
+    static uint64_t rotl(uint64_t value, int bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    static uint64_t read64(const unsigned char *p)
+    {
+        uint64_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    static uint32_t read32(const unsigned char *p)
+    {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    static uint64_t round(uint64_t accumulator, uint64_t input)
+    {
+        accumulator += input * Prime2;
+        accumulator = rotl(accumulator, 31);
+        return accumulator * Prime1;
+    }
+
+    void consumeStripe(const unsigned char *p)
+    {
+        lanes[0] = round(lanes[0], read64(p));
+        lanes[1] = round(lanes[1], read64(p + 8));
+        lanes[2] = round(lanes[2], read64(p + 16));
+        lanes[3] = round(lanes[3], read64(p + 24));
+    }
+
+    uint64_t lanes[4];
+    uint64_t seedValue;
+    uint64_t total;
+    unsigned char stripe[StripeSize];
+    size_t pending;
+};
+
+#endif // FASTHASH_H
@@ -0,0 +1,222 @@
+#include "globset.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace {
+
+char fold(char c)
+{
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+} // namespace
+
+GlobSet::GlobSet()
+    : classCount(1)
+    , startState(0)
+    , states(0)
+{
+    std::memset(byteClass, 0, sizeof(byteClass));
+}
+
+void GlobSet::add(const std::string &pattern, uint32_t tag, Kind kind)
+{
+    // Identical patterns share their NFA positions and only differ in owners
+    std::string folded;
+    char previous = '\0';
+    for (char c : pattern) {
+        if (c == '*' && previous == '*') continue;
+        folded += fold(c);
+        previous = c;
+    }
+
+    auto it = patternIndex.find(folded);
+    if (it == patternIndex.end()) {
+        it = patternIndex.emplace(folded, static_cast<uint32_t>(patterns.size())).first;
+        patterns.emplace_back();
+        patterns.back().text = folded;
+    }
+    patterns[it->second].owners.emplace_back(tag, kind);
+}
+
+size_t GlobSet::patternCount() const
+{
+    return patterns.size();
+}
+
+uint32_t GlobSet::stateCount() const
+{
+    return states.load(std::memory_order_acquire);
+}
+
+void GlobSet::reset()
+{
+    for (std::unique_ptr<Block> &block : blocks) {
+        block.reset();
+    }
+    stateIds.clear();
+    states.store(0, std::memory_order_relaxed);
+}
+
+void GlobSet::compile()
+{
+    reset();
+    tokens.clear();
+    positionPattern.clear();
+
+    std::vector<uint32_t> start;
+    for (uint32_t id = 0; id < patterns.size(); ++id) {
+        start.push_back(static_cast<uint32_t>(tokens.size()));
+        for (char c : patterns[id].text) {
+            tokens.push_back(c);
+            positionPattern.push_back(id);
+        }
+        tokens.push_back('\0');
+        positionPattern.push_back(id);
+    }
+
+    // Every literal gets its own input class, all other bytes share class 0
+    std::memset(byteClass, 0, sizeof(byteClass));
+    classCount = 1;
+    for (char token : tokens) {
+        if (token == '\0' || token == '*' || token == '?') continue;
+        const unsigned char lower = static_cast<unsigned char>(token);
+        if (byteClass[lower] != 0) continue;
+        byteClass[lower] = static_cast<uint8_t>(classCount);
+        byteClass[static_cast<unsigned char>(std::toupper(lower))] = static_cast<uint8_t>(classCount);
+        classCount++;
+    }
+
+    // State 0 is the dead state without live positions
+    std::vector<uint32_t> dead;
+    intern(dead);
+    closure(start);
+    startState = intern(start);
+}
+
+// Adds the positions reachable without reading anything: a star may match
+// nothing, so the position after it is live as well. Sorted on return.
+void GlobSet::closure(std::vector<uint32_t> &positions) const
+{
+    for (size_t i = 0; i < positions.size(); ++i) {
+        if (tokens[positions[i]] == '*') positions.push_back(positions[i] + 1);
+    }
+    std::sort(positions.begin(), positions.end());
+    positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+}
+
+void GlobSet::advance(const std::vector<uint32_t> &positions, uint32_t inputClass, std::vector<uint32_t> &next) const
+{
+    next.clear();
+    for (uint32_t position : positions) {
+        const char token = tokens[position];
+        if (token == '*') {
+            next.push_back(position);
+        } else if (token == '?') {
+            next.push_back(position + 1);
+        } else if (token != '\0' && inputClass != 0
+                   && byteClass[static_cast<unsigned char>(token)] == inputClass) {
+            next.push_back(position + 1);
+        }
+    }
+    closure(next);
+}
+
+void GlobSet::selection(const std::vector<uint32_t> &positions, std::vector<uint32_t> &tags) const
+{
+    tags.clear();
+    std::vector<uint32_t> excluded;
+    for (uint32_t position : positions) {
+        if (tokens[position] != '\0') continue;
+        for (const std::pair<uint32_t, Kind> &owner : patterns[positionPattern[position]].owners) {
+            (owner.second == Include ? tags : excluded).push_back(owner.first);
+        }
+    }
+
+    std::sort(tags.begin(), tags.end());
+    tags.erase(std::unique(tags.begin(), tags.end()), tags.end());
+    if (excluded.empty()) return;
+
+    std::sort(excluded.begin(), excluded.end());
+    tags.erase(std::remove_if(tags.begin(), tags.end(), [&excluded](uint32_t tag) {
+        return std::binary_search(excluded.begin(), excluded.end(), tag);
+    }), tags.end());
+}
+
+// Returns the state for a set of positions, creating it if needed, or
+// Unknown once MaxStates exist. Called with buildLock held (or before the
+// set is shared, from compile()).
+uint32_t GlobSet::intern(std::vector<uint32_t> &positions) const
+{
+    auto it = stateIds.find(positions);
+    if (it != stateIds.end()) return it->second;
+
+    const uint32_t id = states.load(std::memory_order_relaxed);
+    if (id >= MaxStates) return Unknown;
+
+    std::unique_ptr<Block> &block = blocks[id / BlockStates];
+    if (!block) {
+        block.reset(new Block());
+        const size_t cells = static_cast<size_t>(BlockStates) * classCount;
+        block->next.reset(new std::atomic<uint32_t>[cells]);
+        for (size_t i = 0; i < cells; ++i) {
+            block->next[i].store(Unknown, std::memory_order_relaxed);
+        }
+    }
+    block->positions[id % BlockStates] = positions;
+    selection(positions, block->selected[id % BlockStates]);
+
+    stateIds.emplace(positions, id);
+    states.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+uint32_t GlobSet::step(uint32_t state, uint32_t inputClass) const
+{
+    std::lock_guard<std::mutex> guard(buildLock);
+
+    Block &block = *blocks[state / BlockStates];
+    std::atomic<uint32_t> &cell = block.next[(state % BlockStates) * classCount + inputClass];
+    uint32_t target = cell.load(std::memory_order_relaxed);
+    if (target != Unknown) return target;
+
+    std::vector<uint32_t> next;
+    advance(block.positions[state % BlockStates], inputClass, next);
+    target = intern(next);
+    if (target != Unknown) cell.store(target, std::memory_order_release);
+    return target;
+}
+
+const std::vector<uint32_t> &GlobSet::select(const char *name) const
+{
+    uint32_t state = startState;
+    for (const unsigned char *p = reinterpret_cast<const unsigned char *>(name); *p && state != 0; ++p) {
+        const uint32_t inputClass = byteClass[*p];
+        const Block &block = *blocks[state / BlockStates];
+        uint32_t next = block.next[(state % BlockStates) * classCount + inputClass].load(std::memory_order_acquire);
+        if (next == Unknown) {
+            next = step(state, inputClass);
+            if (next == Unknown) return selectSlowly(block.positions[state % BlockStates], p);
+        }
+        state = next;
+    }
+    return blocks[state / BlockStates]->selected[state % BlockStates];
+}
+
+// Simulates the NFA for the rest of a name once the automaton is full
+const std::vector<uint32_t> &GlobSet::selectSlowly(const std::vector<uint32_t> &start, const unsigned char *rest) const
+{
+    thread_local std::vector<uint32_t> current;
+    thread_local std::vector<uint32_t> next;
+    thread_local std::vector<uint32_t> tags;
+
+    current = start;
+    for (; *rest && !current.empty(); ++rest) {
+        advance(current, byteClass[*rest], next);
+        current.swap(next);
+    }
+    selection(current, tags);
+    return tags;
+}
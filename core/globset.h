@@ -0,0 +1,92 @@
+#ifndef GLOBSET_H
+#define GLOBSET_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Many shell-style patterns ('*', '?', ASCII case ignored like
+// wildcardMatch) compiled into one automaton. A name is matched against
+// all of them in a single pass over its characters, so the cost per name
+// does not depend on how many patterns there are.
+//
+// Every pattern carries a tag and either includes or excludes it; a name
+// selects the tags that one of its including patterns matches and none of
+// its excluding patterns does.
+//
+// The automaton is built lazily: a state is only determinised the first
+// time a name leads into it and is shared by every later name. Mixing
+// prefixes and suffixes ("site7_*", "*.log") makes the full automaton
+// explode combinatorially, but real file names only ever visit a small
+// part of it. Cached transitions are read without locking; building a new
+// state takes a lock. Past MaxStates names are matched by walking the
+// patterns directly, which is slower but gives the same answer.
+class GlobSet
+{
+public:
+    enum Kind { Include, Exclude };
+
+    static const uint32_t MaxStates = 16384;
+
+    GlobSet();
+
+    void add(const std::string &pattern, uint32_t tag, Kind kind = Include);
+    // Call once after the last add() and before the first select()
+    void compile();
+
+    size_t patternCount() const;
+    uint32_t stateCount() const;
+
+    // Tags selected by name, in increasing order. Thread-safe; the
+    // reference stays valid until the set is destroyed or compiled again
+    // (for the calling thread, until its next select()).
+    const std::vector<uint32_t> &select(const char *name) const;
+
+private:
+    struct Pattern
+    {
+        std::string text;
+        std::vector<std::pair<uint32_t, Kind>> owners;
+    };
+
+    static const uint32_t BlockStates = 256;
+    static const uint32_t MaxBlocks = MaxStates / BlockStates;
+    static const uint32_t Unknown = UINT32_MAX;
+
+    struct Block
+    {
+        std::unique_ptr<std::atomic<uint32_t>[]> next;
+        std::vector<uint32_t> positions[BlockStates];
+        std::vector<uint32_t> selected[BlockStates];
+    };
+
+    void reset();
+    void closure(std::vector<uint32_t> &positions) const;
+    void advance(const std::vector<uint32_t> &positions, uint32_t inputClass, std::vector<uint32_t> &next) const;
+    void selection(const std::vector<uint32_t> &positions, std::vector<uint32_t> &tags) const;
+    uint32_t intern(std::vector<uint32_t> &positions) const;
+    uint32_t step(uint32_t state, uint32_t inputClass) const;
+    const std::vector<uint32_t> &selectSlowly(const std::vector<uint32_t> &start, const unsigned char *rest) const;
+
+    std::vector<Pattern> patterns;
+    std::map<std::string, uint32_t> patternIndex;
+
+    // NFA: one position per pattern token plus an accepting one per pattern
+    std::vector<char> tokens;              // folded literal, '?', '*' or '\0' at the end of a pattern
+    std::vector<uint32_t> positionPattern;
+    uint8_t byteClass[256];
+    uint32_t classCount;
+    uint32_t startState;
+
+    // DFA states, filled in on demand
+    mutable std::unique_ptr<Block> blocks[MaxBlocks];
+    mutable std::atomic<uint32_t> states;
+    mutable std::mutex buildLock;
+    mutable std::map<std::vector<uint32_t>, uint32_t> stateIds;
+};
+
+#endif // GLOBSET_H
@@ -0,0 +1,42 @@
+#ifndef HARDWARECOLLECTOR_H
+#define HARDWARECOLLECTOR_H
+
+#include <QString>
+#include <QStringList>
+
+// One readable text per section of the Hardware page
+struct HardwareReport
+{
+    QString cpu;
+    QString gpu;
+    QString motherboard;
+    QString ram;
+    QString storage;
+    QString network;
+    QString usb;
+};
+
+// Reads the hardware summary from the system tools (wmic, nvidia-smi,
+// PowerShell) without any user interface, for the Hardware page and the
+// command line. collect() runs a dozen child processes and can take
+// seconds; a section that cannot be read says so instead of being empty.
+class HardwareCollector
+{
+public:
+    HardwareReport collect();
+
+    static QString formatBytes(quint64 bytes);
+
+private:
+    static QString executeCommand(const QString &command, const QStringList &arguments = QStringList());
+
+    QString fetchCPUInfo();
+    QString fetchGPUInfo();
+    QString fetchMotherboardInfo();
+    QString fetchRAMInfo();
+    QString fetchStorageInfo();
+    QString fetchNetworkInfo();
+    QString fetchUSBInfo();
+};
+
+#endif // HARDWARECOLLECTOR_H
@@ -0,0 +1,124 @@
+#include "iothrottle.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const int64_t PressureCheckIntervalUs = 1000 * 1000;
+// Spacing while backing off without a fixed rate
+const int64_t UnlimitedBackoffUs = 1000;
+// Sleeps are cut into slices so cancel() is noticed quickly
+const int64_t SleepSliceUs = 100 * 1000;
+
+int64_t steadyNowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+void lowerThreadPriority()
+{
+#ifdef __linux__
+    const int IoprioWhoProcess = 1;  // with who 0, the calling thread
+    const int IoprioClassIdle = 3;
+    const int IoprioClassShift = 13;
+    syscall(SYS_ioprio_set, IoprioWhoProcess, 0, IoprioClassIdle << IoprioClassShift);
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+#endif
+}
+
+IoThrottle::IoThrottle(int operationsPerSecond, double limit)
+    : intervalUs(operationsPerSecond > 0 ? 1000 * 1000 / operationsPerSecond : 0)
+    , pressureLimit(limit)
+    , nextSlotUs(0)
+    , nextCheckUs(0)
+    , backoffFactor(1)
+    , canceled(false)
+    , waitedUs(0)
+{
+}
+
+double IoThrottle::ioPressure()
+{
+#ifdef __linux__
+    std::FILE *file = std::fopen("/proc/pressure/io", "r");
+    if (!file) return -1;
+    double some = -1;
+    // some avg10=1.23 avg60=0.50 avg300=0.10 total=12345
+    if (std::fscanf(file, "some avg10=%lf", &some) != 1) some = -1;
+    std::fclose(file);
+    return some;
+#else
+    return -1;
+#endif
+}
+
+// Called with lock held
+void IoThrottle::checkPressure(int64_t nowUs)
+{
+    if (pressureLimit <= 0 || nowUs < nextCheckUs) return;
+    nextCheckUs = nowUs + PressureCheckIntervalUs;
+
+    const double pressure = ioPressure();
+    if (pressure < 0) {
+        // Kernel without PSI, only the fixed rate applies
+        pressureLimit = 0;
+        backoffFactor = 1;
+    } else if (pressure > pressureLimit) {
+        backoffFactor = std::min(MaxBackoff, backoffFactor * 2);
+    } else {
+        backoffFactor = std::max(1, backoffFactor / 2);
+    }
+}
+
+bool IoThrottle::acquire()
+{
+    int64_t slot;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        const int64_t now = steadyNowUs();
+        checkPressure(now);
+
+        int64_t spacing = intervalUs * backoffFactor;
+        if (intervalUs == 0 && backoffFactor > 1) spacing = UnlimitedBackoffUs * backoffFactor;
+        if (spacing == 0) return !canceled;
+
+        slot = std::max(now, nextSlotUs);
+        nextSlotUs = slot + spacing;
+    }
+
+    int64_t wait = slot - steadyNowUs();
+    if (wait > 0) waitedUs.fetch_add(wait, std::memory_order_relaxed);
+    while (wait > 0 && !canceled) {
+        std::this_thread::sleep_for(std::chrono::microseconds(std::min(wait, SleepSliceUs)));
+        wait = slot - steadyNowUs();
+    }
+    return !canceled;
+}
+
+void IoThrottle::cancel()
+{
+    canceled = true;
+}
+
+int IoThrottle::backoff() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return backoffFactor;
+}
+
+int64_t IoThrottle::waitedMs() const
+{
+    return waitedUs.load(std::memory_order_relaxed) / 1000;
+}
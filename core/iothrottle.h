@@ -0,0 +1,61 @@
+#ifndef IOTHROTTLE_H
+#define IOTHROTTLE_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+// Puts the calling thread into the idle I/O class and at the lowest CPU
+// priority, so its disk work only runs when nothing else wants the disk.
+// Threads it starts afterwards inherit both. An unprivileged process
+// cannot raise them again, so only call it on threads of their own.
+// Does nothing where the platform has no such classes.
+void lowerThreadPriority();
+
+// Spaces out file system operations for cleanups that must not disturb
+// the machine's workload: at most operationsPerSecond of them, and fewer
+// while the kernel reports I/O pressure. When the share of time tasks were
+// stalled on I/O over the last 10 seconds (the "some avg10" line of
+// /proc/pressure/io) exceeds pressureLimit percent, the spacing doubles
+// on every check, up to MaxBackoff times, and halves again once the
+// pressure is gone.
+//
+// acquire() is called by every worker before an operation and may be
+// called concurrently.
+class IoThrottle
+{
+public:
+    static const int MaxBackoff = 64;
+
+    // 0 operations per second for no fixed limit, 0 pressureLimit to
+    // ignore the pressure
+    explicit IoThrottle(int operationsPerSecond, double pressureLimit = 0);
+
+    // Blocks until the next operation may start, returns false once canceled
+    bool acquire();
+    void cancel();
+
+    // Current backoff multiplier, 1 when not backing off
+    int backoff() const;
+    // Total time callers spent waiting
+    int64_t waitedMs() const;
+
+    // "some avg10" of /proc/pressure/io in percent, -1 where unavailable
+    static double ioPressure();
+
+private:
+    void checkPressure(int64_t nowUs);
+
+    int64_t intervalUs;
+    double pressureLimit;
+
+    mutable std::mutex lock;
+    int64_t nextSlotUs;
+    int64_t nextCheckUs;
+    int backoffFactor;
+
+    std::atomic<bool> canceled;
+    std::atomic<int64_t> waitedUs;
+};
+
+#endif // IOTHROTTLE_H
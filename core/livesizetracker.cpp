@@ -0,0 +1,492 @@
+#include "livesizetracker.h"
+#include "pathutils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+#ifdef __linux__
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef __linux__
+const uint32_t WatchMask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE
+                           | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+
+// Re-reads the files directly inside a directory. Subdirectories on the
+// same device are returned by name so new and removed ones can be found.
+bool listDirectory(const std::string &path, ScanTotals &own, std::set<std::string> &subdirs)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat dirStat;
+    DIR *dir = fstat(fd, &dirStat) == 0 ? fdopendir(fd) : nullptr;
+    if (!dir) {
+        close(fd);
+        return false;
+    }
+
+    own = ScanTotals();
+    while (struct dirent *entry = readdir(dir)) {
+        const char *name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+
+        struct stat st;
+        if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            if (st.st_dev == dirStat.st_dev) subdirs.insert(name);
+            continue;
+        }
+        own.bytes += st.st_size;
+        own.allocated += static_cast<int64_t>(st.st_blocks) * 512;
+        own.files++;
+    }
+
+    closedir(dir);
+    return true;
+}
+#endif
+
+std::string baseName(const std::string &path)
+{
+    const size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+// Files directly inside every directory a rescan went through
+class RescanCollector : public ScanVisitor
+{
+public:
+    void leaveDirectory(const ScanDirSummary &dir) override
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        own[*dir.path] = dir.own;
+    }
+
+    std::mutex lock;
+    std::map<std::string, ScanTotals> own;
+};
+
+} // namespace
+
+LiveSizeTracker::LiveSizeTracker(const std::vector<std::string> &roots)
+    : roots(roots)
+    , totals(roots.size())
+    , degradedRoots(roots.size(), false)
+    , unwatched(0)
+    , rescanIndex(std::string())
+    , running(false)
+    , notifyFd(-1)
+    , coalesceMs(250)
+    , rescanSeconds(60)
+{
+    for (size_t i = 0; i < roots.size(); ++i) {
+        scanRootMap.push_back(static_cast<int>(i));
+    }
+    rescanIndex.setMaxAge(RescansPerListing * rescanSeconds);
+#ifdef __linux__
+    notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+LiveSizeTracker::~LiveSizeTracker()
+{
+    stop();
+#ifdef __linux__
+    if (notifyFd >= 0) close(notifyFd);
+#endif
+}
+
+bool LiveSizeTracker::isSupported()
+{
+#ifdef __linux__
+    return true;
+#else
+    return false;
+#endif
+}
+
+int64_t LiveSizeTracker::watchLimit()
+{
+    std::ifstream limit("/proc/sys/fs/inotify/max_user_watches");
+    int64_t value = -1;
+    limit >> value;
+    return value;
+}
+
+void LiveSizeTracker::setCoalesceInterval(int milliseconds)
+{
+    coalesceMs = std::max(0, milliseconds);
+}
+
+void LiveSizeTracker::setRescanInterval(int seconds)
+{
+    rescanSeconds = std::max(1, seconds);
+    rescanIndex.setMaxAge(RescansPerListing * rescanSeconds);
+}
+
+int LiveSizeTracker::rootFor(const std::string &path) const
+{
+    // Prefer the most specific root when roots are nested
+    int best = -1;
+    for (size_t i = 0; i < roots.size(); ++i) {
+        if (isPathUnder(path, roots[i]) && (best < 0 || roots[i].size() > roots[best].size())) {
+            best = static_cast<int>(i);
+        }
+    }
+    return best;
+}
+
+void LiveSizeTracker::addWatch(const std::string &path, DirState &state)
+{
+#ifdef __linux__
+    if (notifyFd >= 0 && !degradedRoots[state.rootIndex]) {
+        const int watch = inotify_add_watch(notifyFd, path.c_str(), WatchMask);
+        if (watch >= 0) {
+            state.watch = watch;
+            watches[watch] = path;
+            return;
+        }
+        if (errno == ENOSPC) {
+            // Out of watches: keep the ones we have and fall back to
+            // periodic rescans for the rest of this root
+            degradedRoots[state.rootIndex] = true;
+        }
+    }
+#else
+    (void)path;
+    degradedRoots[state.rootIndex] = true;
+#endif
+    unwatched++;
+}
+
+void LiveSizeTracker::leaveDirectory(const ScanDirSummary &dir)
+{
+    const std::string &path = *dir.path;
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (dir.rootIndex < 0 || dir.rootIndex >= static_cast<int>(scanRootMap.size())) return;
+    const int rootIndex = scanRootMap[dir.rootIndex];
+    if (rootIndex < 0) return;
+
+    DirState &state = directories[path];
+    ScanTotals &rootTotal = totals[rootIndex];
+    rootTotal.bytes += dir.own.bytes - state.bytes;
+    rootTotal.allocated += dir.own.allocated - state.allocated;
+    rootTotal.files += dir.own.files - state.files;
+    if (!state.recorded) rootTotal.directories++;
+
+    state.recorded = true;
+    state.rootIndex = rootIndex;
+    state.bytes = dir.own.bytes;
+    state.allocated = dir.own.allocated;
+    state.files = dir.own.files;
+
+    if (path != roots[rootIndex]) {
+        directories[parentPath(path)].children.insert(baseName(path));
+    }
+    if (state.watch < 0) addWatch(path, state);
+}
+
+bool LiveSizeTracker::start(const std::function<void()> &onChange)
+{
+    if (running) return true;
+#ifdef __linux__
+    if (notifyFd < 0) return false;
+#endif
+    changeCallback = onChange;
+    running = true;
+    worker = std::thread(&LiveSizeTracker::run, this);
+    return true;
+}
+
+void LiveSizeTracker::stop()
+{
+    running = false;
+    if (worker.joinable()) worker.join();
+}
+
+void LiveSizeTracker::run()
+{
+    typedef std::chrono::steady_clock Clock;
+    bool batchOpen = false;
+    Clock::time_point batchDeadline;
+    Clock::time_point nextRescan = Clock::now() + std::chrono::seconds(rescanSeconds);
+
+    while (running) {
+        int timeout = 200;
+        if (batchOpen) {
+            const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(batchDeadline - Clock::now());
+            timeout = static_cast<int>(std::max<int64_t>(0, std::min<int64_t>(timeout, remaining.count())));
+        }
+
+#ifdef __linux__
+        struct pollfd pollFd = {notifyFd, POLLIN, 0};
+        if (poll(&pollFd, 1, timeout) > 0 && (pollFd.revents & POLLIN)) {
+            readEvents();
+            if (!batchOpen && !dirtyDirs.empty()) {
+                // Let the burst settle before touching the filesystem
+                batchOpen = true;
+                batchDeadline = Clock::now() + std::chrono::milliseconds(coalesceMs);
+            }
+        }
+#else
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+#endif
+
+        bool changed = false;
+        if (batchOpen && Clock::now() >= batchDeadline) {
+            applyBatch();
+            batchOpen = false;
+            changed = true;
+        }
+        if (isDegraded() && Clock::now() >= nextRescan) {
+            rescanDegraded();
+            nextRescan = Clock::now() + std::chrono::seconds(rescanSeconds);
+            changed = true;
+        }
+        if (changed && changeCallback) changeCallback();
+    }
+}
+
+void LiveSizeTracker::readEvents()
+{
+#ifdef __linux__
+    alignas(struct inotify_event) char buffer[64 * 1024];
+    for (;;) {
+        const ssize_t length = read(notifyFd, buffer, sizeof(buffer));
+        if (length <= 0) break;
+
+        std::lock_guard<std::mutex> guard(lock);
+        for (ssize_t offset = 0; offset < length;) {
+            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(buffer + offset);
+            offset += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Events were dropped, every directory has to be re-read
+                for (const auto &item : directories) {
+                    dirtyDirs.insert(item.first);
+                }
+                continue;
+            }
+
+            auto it = watches.find(event->wd);
+            if (it == watches.end()) continue;
+            if (event->mask & IN_IGNORED) {
+                auto dir = directories.find(it->second);
+                if (dir != directories.end()) dir->second.watch = -1;
+                watches.erase(it);
+                continue;
+            }
+
+            // Any change inside a directory, including subdirectories being
+            // created, removed or renamed, is resolved by re-reading it
+            dirtyDirs.insert(it->second);
+        }
+    }
+#endif
+}
+
+void LiveSizeTracker::removeSubtree(const std::string &path)
+{
+    auto erase = [this](std::map<std::string, DirState>::iterator it) {
+        DirState &state = it->second;
+        ScanTotals &rootTotal = totals[state.rootIndex];
+        rootTotal.bytes -= state.bytes;
+        rootTotal.allocated -= state.allocated;
+        rootTotal.files -= state.files;
+        rootTotal.directories--;
+#ifdef __linux__
+        if (state.watch >= 0) {
+            inotify_rm_watch(notifyFd, state.watch);
+            watches.erase(state.watch);
+        } else {
+            unwatched = unwatched > 0 ? unwatched - 1 : 0;
+        }
+#endif
+        return directories.erase(it);
+    };
+
+    auto self = directories.find(path);
+    if (self != directories.end()) erase(self);
+
+    const std::string prefix = path + '/';
+    auto it = directories.lower_bound(prefix);
+    while (it != directories.end() && it->first.compare(0, prefix.size(), prefix) == 0) {
+        it = erase(it);
+    }
+}
+
+void LiveSizeTracker::applyBatch()
+{
+    std::vector<std::string> created;
+    const std::set<std::string> dirty = std::move(dirtyDirs);
+    dirtyDirs.clear();
+
+    for (const std::string &path : dirty) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (directories.find(path) == directories.end()) continue;
+        }
+
+        ScanTotals own;
+        std::set<std::string> subdirs;
+#ifdef __linux__
+        // A directory that vanished is removed when its parent is re-read
+        if (!listDirectory(path, own, subdirs)) continue;
+#endif
+
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = directories.find(path);
+        if (it == directories.end()) continue;
+
+        DirState &state = it->second;
+        ScanTotals &rootTotal = totals[state.rootIndex];
+        rootTotal.bytes += own.bytes - state.bytes;
+        rootTotal.allocated += own.allocated - state.allocated;
+        rootTotal.files += own.files - state.files;
+        state.bytes = own.bytes;
+        state.allocated = own.allocated;
+        state.files = own.files;
+
+        std::vector<std::string> gone;
+        for (const std::string &name : state.children) {
+            if (subdirs.find(name) == subdirs.end()) gone.push_back(name);
+        }
+        for (const std::string &name : subdirs) {
+            if (state.children.find(name) == state.children.end()) created.push_back(joinPath(path, name.c_str()));
+        }
+        state.children = subdirs;
+
+        for (const std::string &name : gone) {
+            removeSubtree(joinPath(path, name.c_str()));
+        }
+    }
+
+    scanNewDirectories(created);
+}
+
+void LiveSizeTracker::scanNewDirectories(const std::vector<std::string> &paths)
+{
+    if (paths.empty()) return;
+
+    std::vector<int> map;
+    for (const std::string &path : paths) {
+        map.push_back(rootFor(path));
+    }
+
+    // leaveDirectory() translates the sub-scan's root indices back to ours
+    std::vector<int> previous;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        previous.swap(scanRootMap);
+        scanRootMap = map;
+    }
+
+    DirScanner scanner;
+    scanner.setVisitor(this);
+    scanner.scan(paths);
+
+    std::lock_guard<std::mutex> guard(lock);
+    scanRootMap.swap(previous);
+}
+
+void LiveSizeTracker::rescanDegraded()
+{
+    for (size_t i = 0; i < roots.size() && running; ++i) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (!degradedRoots[i]) continue;
+        }
+
+        rescanIndex.resetStatistics();
+        RescanCollector found;
+        DirScanner scanner;
+        scanner.setCache(&rescanIndex);
+        scanner.setVisitor(&found);
+        scanner.scan(std::vector<std::string>(1, roots[i]));
+        if (!running) break;
+
+        // The per-directory states are brought in line with the rescan
+        // rather than only the root total, later events are applied to them
+        std::lock_guard<std::mutex> guard(lock);
+        std::vector<std::string> gone;
+        for (auto &item : directories) {
+            if (item.second.rootIndex != static_cast<int>(i)) continue;
+            if (found.own.find(item.first) == found.own.end()) {
+                gone.push_back(item.first);
+            } else {
+                item.second.children.clear();
+            }
+        }
+        for (const std::string &path : gone) {
+            removeSubtree(path);
+        }
+
+        ScanTotals &rootTotal = totals[i];
+        for (const auto &item : found.own) {
+            const std::string &path = item.first;
+            if (path != roots[i]) {
+                auto parent = directories.find(parentPath(path));
+                if (parent != directories.end() && parent->second.rootIndex == static_cast<int>(i)) {
+                    parent->second.children.insert(baseName(path));
+                }
+            }
+            // Nested roots keep their own states
+            if (rootFor(path) != static_cast<int>(i)) continue;
+
+            DirState &state = directories[path];
+            rootTotal.bytes += item.second.bytes - state.bytes;
+            rootTotal.allocated += item.second.allocated - state.allocated;
+            rootTotal.files += item.second.files - state.files;
+            state.bytes = item.second.bytes;
+            state.allocated = item.second.allocated;
+            state.files = item.second.files;
+            if (!state.recorded) {
+                rootTotal.directories++;
+                state.recorded = true;
+                state.rootIndex = static_cast<int>(i);
+                addWatch(path, state);
+            }
+        }
+    }
+}
+
+int LiveSizeTracker::rootCount() const
+{
+    return static_cast<int>(roots.size());
+}
+
+ScanTotals LiveSizeTracker::rootTotals(int rootIndex) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (rootIndex < 0 || rootIndex >= static_cast<int>(totals.size())) return ScanTotals();
+    return totals[rootIndex];
+}
+
+bool LiveSizeTracker::isDegraded() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return std::find(degradedRoots.begin(), degradedRoots.end(), true) != degradedRoots.end();
+}
+
+size_t LiveSizeTracker::watchCount() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return watches.size();
+}
+
+size_t LiveSizeTracker::unwatchedCount() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return unwatched;
+}
@@ -0,0 +1,98 @@
+#ifndef LIVESIZETRACKER_H
+#define LIVESIZETRACKER_H
+
+#include "dirscanner.h"
+#include "scanindex.h"
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Keeps the totals of a set of scan roots current after the initial scan.
+// Pass the tracker as the visitor of that scan: every directory it reports
+// is recorded and gets an inotify watch. Afterwards start() runs a thread
+// that collects events, coalesces bursts, re-reads only the directories
+// that changed and adjusts the totals by the difference.
+//
+// When the kernel runs out of inotify watches the affected roots are
+// marked degraded and are instead rescanned periodically, which stays
+// cheap because those rescans go through an in-memory ScanIndex. Its
+// entries expire after a few rescans, so files growing in place in a
+// degraded root are still picked up, only with some delay.
+class LiveSizeTracker : public ScanVisitor
+{
+public:
+    explicit LiveSizeTracker(const std::vector<std::string> &roots);
+    ~LiveSizeTracker() override;
+
+    static bool isSupported();
+    static int64_t watchLimit();
+
+    void leaveDirectory(const ScanDirSummary &dir) override;
+
+    // onChange is called from the tracker thread after totals changed
+    bool start(const std::function<void()> &onChange);
+    void stop();
+
+    void setCoalesceInterval(int milliseconds);
+    void setRescanInterval(int seconds);
+
+    int rootCount() const;
+    ScanTotals rootTotals(int rootIndex) const;
+    bool isDegraded() const;
+    size_t watchCount() const;
+    size_t unwatchedCount() const;
+
+private:
+    struct DirState
+    {
+        int rootIndex = 0;
+        int watch = -1;
+        int64_t bytes = 0;
+        int64_t allocated = 0;
+        int64_t files = 0;
+        bool recorded = false;
+        std::set<std::string> children;
+    };
+
+    // Rescans an index entry is reused for before it is listed again
+    static const int RescansPerListing = 5;
+
+    void run();
+    void readEvents();
+    void applyBatch();
+    void rescanDegraded();
+    void removeSubtree(const std::string &path);
+    void scanNewDirectories(const std::vector<std::string> &paths);
+    void addWatch(const std::string &path, DirState &state);
+    int rootFor(const std::string &path) const;
+
+    std::vector<std::string> roots;
+    std::vector<ScanTotals> totals;
+    std::vector<bool> degradedRoots;
+    std::vector<int> scanRootMap;
+
+    mutable std::mutex lock;
+    std::map<std::string, DirState> directories;
+    std::unordered_map<int, std::string> watches;
+    size_t unwatched;
+
+    // Directories changed in the current batch, only touched by the tracker thread
+    std::set<std::string> dirtyDirs;
+
+    ScanIndex rescanIndex;
+    std::function<void()> changeCallback;
+    std::thread worker;
+    std::atomic<bool> running;
+    int notifyFd;
+    int coalesceMs;
+    int rescanSeconds;
+};
+
+#endif // LIVESIZETRACKER_H
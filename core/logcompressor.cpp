@@ -0,0 +1,385 @@
+#include "logcompressor.h"
+#include "pathutils.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#ifdef RAPTOR_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <filesystem>
+#include <system_error>
+#endif
+
+namespace {
+
+const char CompressedSuffix[] = ".gz";
+const char PartialSuffix[] = ".partial";
+
+// One file being replaced by its compressed copy
+struct FileJob
+{
+    std::string path;
+    std::string target;
+    std::string partial;
+    int64_t size = 0;
+    int64_t offset = 0;      // read so far
+    int64_t written = 0;
+    bool failed = false;
+#ifdef __linux__
+    int input = -1;
+    int output = -1;
+    struct stat info;
+#else
+    std::FILE *input = nullptr;
+    std::FILE *output = nullptr;
+    std::filesystem::file_time_type modified;
+#endif
+};
+
+struct Chunk
+{
+    FileJob *job = nullptr;
+    bool last = false;
+    bool done = false;
+    bool failed = false;
+    std::vector<unsigned char> input;
+    std::vector<unsigned char> output;
+};
+
+// Compresses one chunk into a complete gzip member
+bool deflateChunk(Chunk &chunk, int level)
+{
+#ifdef RAPTOR_HAVE_ZLIB
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    // 15 window bits plus 16 for a gzip header and trailer
+    if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) return false;
+
+    chunk.output.resize(deflateBound(&stream, static_cast<uLong>(chunk.input.size())) + 32);
+    stream.next_in = chunk.input.data();
+    stream.avail_in = static_cast<uInt>(chunk.input.size());
+    stream.next_out = chunk.output.data();
+    stream.avail_out = static_cast<uInt>(chunk.output.size());
+    const int result = deflate(&stream, Z_FINISH);
+    chunk.output.resize(stream.total_out);
+    deflateEnd(&stream);
+    return result == Z_STREAM_END;
+#else
+    (void)chunk;
+    (void)level;
+    return false;
+#endif
+}
+
+bool openJob(FileJob &job)
+{
+    job.target = job.path + CompressedSuffix;
+    job.partial = job.target + PartialSuffix;
+#ifdef __linux__
+    job.input = ::open(job.path.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (job.input < 0) return false;
+    if (fstat(job.input, &job.info) != 0 || !S_ISREG(job.info.st_mode)) return false;
+    job.size = job.info.st_size;
+    posix_fadvise(job.input, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    // Never replace an existing archive
+    struct stat existing;
+    if (lstat(job.target.c_str(), &existing) == 0) return false;
+    job.output = ::open(job.partial.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_NOFOLLOW, 0600);
+    return job.output >= 0;
+#else
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    const fs::path path = fs::u8path(job.path);
+    if (!fs::is_regular_file(fs::symlink_status(path, ec))) return false;
+    job.size = static_cast<int64_t>(fs::file_size(path, ec));
+    job.modified = fs::last_write_time(path, ec);
+    if (ec || fs::exists(fs::u8path(job.target), ec)) return false;
+
+    job.input = std::fopen(job.path.c_str(), "rb");
+    if (!job.input) return false;
+    job.output = std::fopen(job.partial.c_str(), "wb");
+    return job.output != nullptr;
+#endif
+}
+
+bool readChunk(FileJob &job, std::vector<unsigned char> &buffer, size_t length)
+{
+    buffer.resize(length);
+#ifdef __linux__
+    size_t done = 0;
+    while (done < length) {
+        const ssize_t count = ::read(job.input, buffer.data() + done, length - done);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        done += static_cast<size_t>(count);
+    }
+    return true;
+#else
+    return std::fread(buffer.data(), 1, length, job.input) == length;
+#endif
+}
+
+bool writeChunk(FileJob &job, const std::vector<unsigned char> &data)
+{
+#ifdef __linux__
+    size_t done = 0;
+    while (done < data.size()) {
+        const ssize_t count = ::write(job.output, data.data() + done, data.size() - done);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        done += static_cast<size_t>(count);
+    }
+    return true;
+#else
+    return std::fwrite(data.data(), 1, data.size(), job.output) == data.size();
+#endif
+}
+
+void closeJob(FileJob &job)
+{
+#ifdef __linux__
+    if (job.input >= 0) ::close(job.input);
+    if (job.output >= 0) ::close(job.output);
+    job.input = job.output = -1;
+#else
+    if (job.input) std::fclose(job.input);
+    if (job.output) std::fclose(job.output);
+    job.input = job.output = nullptr;
+#endif
+}
+
+// Syncs the copy, gives it the original's metadata and puts it in place
+// of the original. Returns false, with the copy removed, when the
+// original changed or the copy could not be completed.
+bool finishJob(FileJob &job, bool &changed)
+{
+    changed = false;
+#ifdef __linux__
+    struct stat now;
+    if (fstat(job.input, &now) != 0 || now.st_size != job.info.st_size
+        || now.st_mtim.tv_sec != job.info.st_mtim.tv_sec || now.st_mtim.tv_nsec != job.info.st_mtim.tv_nsec) {
+        changed = true;
+        return false;
+    }
+
+    // Ownership only carries over when running as root
+    if (fchown(job.output, job.info.st_uid, job.info.st_gid) != 0) errno = 0;
+    const struct timespec times[2] = { job.info.st_atim, job.info.st_mtim };
+    if (fchmod(job.output, job.info.st_mode & 07777) != 0 || futimens(job.output, times) != 0) return false;
+    if (fsync(job.output) != 0) return false;
+
+    closeJob(job);
+    if (rename(job.partial.c_str(), job.target.c_str()) != 0) return false;
+    if (unlink(job.path.c_str()) != 0) {
+        // Both copies would stay otherwise
+        unlink(job.target.c_str());
+        return false;
+    }
+    return true;
+#else
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    const fs::path path = fs::u8path(job.path);
+    if (static_cast<int64_t>(fs::file_size(path, ec)) != job.size || fs::last_write_time(path, ec) != job.modified) {
+        changed = true;
+        return false;
+    }
+    if (std::fflush(job.output) != 0) return false;
+
+    closeJob(job);
+    const fs::path target = fs::u8path(job.target);
+    fs::rename(fs::u8path(job.partial), target, ec);
+    if (ec) return false;
+    fs::last_write_time(target, job.modified, ec);
+    fs::permissions(target, fs::status(path, ec).permissions(), ec);
+    if (!fs::remove(path, ec)) {
+        fs::remove(target, ec);
+        return false;
+    }
+    return true;
+#endif
+}
+
+void abandonJob(FileJob &job)
+{
+    closeJob(job);
+    std::remove(job.partial.c_str());
+}
+
+} // namespace
+
+LogCompressor::LogCompressor(int threadCount, int chunk, int compressionLevel)
+    : threads(threadCount)
+    , chunkSize(std::max(64 * 1024, chunk))
+    , level(std::min(9, std::max(1, compressionLevel)))
+    , canceled(false)
+{
+    if (threads <= 0) {
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+        if (threads <= 0) threads = 4;
+    }
+}
+
+bool LogCompressor::isSupported()
+{
+#ifdef RAPTOR_HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool LogCompressor::isCompressedName(const char *name)
+{
+    for (const char *pattern : { "*.gz", "*.xz", "*.bz2", "*.zst", "*.lz4", "*.zip", "*.7z" }) {
+        if (wildcardMatch(pattern, name)) return true;
+    }
+    return false;
+}
+
+void LogCompressor::cancel()
+{
+    canceled = true;
+}
+
+bool LogCompressor::isCanceled() const
+{
+    return canceled;
+}
+
+int LogCompressor::threadCount() const
+{
+    return threads;
+}
+
+CompressTotals LogCompressor::compress(const std::vector<std::string> &paths)
+{
+    CompressTotals totals;
+    if (!isSupported()) {
+        totals.failures = static_cast<int64_t>(paths.size());
+        return totals;
+    }
+
+    std::mutex lock;
+    std::condition_variable work;
+    std::condition_variable finished;
+    std::deque<Chunk *> queue;
+    bool stopping = false;
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; ++i) {
+        workers.emplace_back([&]() {
+            std::unique_lock<std::mutex> guard(lock);
+            while (true) {
+                work.wait(guard, [&]() { return stopping || !queue.empty(); });
+                if (queue.empty()) return;
+                Chunk *chunk = queue.front();
+                queue.pop_front();
+
+                guard.unlock();
+                const bool ok = deflateChunk(*chunk, level);
+                guard.lock();
+                chunk->failed = !ok;
+                chunk->done = true;
+                finished.notify_all();
+            }
+        });
+    }
+
+    // Chunks in file order; the front one is written as soon as it is done
+    // while reading keeps up to maxInFlight chunks ahead
+    const size_t maxInFlight = static_cast<size_t>(threads) * 2;
+    std::deque<std::unique_ptr<Chunk>> window;
+    std::vector<std::unique_ptr<FileJob>> jobs;
+    FileJob *reading = nullptr;
+    size_t nextPath = 0;
+
+    while (true) {
+        while (window.size() < maxInFlight && !canceled) {
+            if (!reading) {
+                if (nextPath == paths.size()) break;
+                jobs.emplace_back(new FileJob());
+                FileJob *job = jobs.back().get();
+                job->path = paths[nextPath++];
+                if (!openJob(*job)) {
+                    abandonJob(*job);
+                    totals.failures++;
+                    continue;
+                }
+                reading = job;
+            }
+
+            std::unique_ptr<Chunk> chunk(new Chunk());
+            chunk->job = reading;
+            const int64_t length = std::min<int64_t>(chunkSize, reading->size - reading->offset);
+            if (!readChunk(*reading, chunk->input, static_cast<size_t>(length))) {
+                // Shrunk while reading, finishJob() notices
+                reading->failed = true;
+            }
+            reading->offset += length;
+            chunk->last = reading->failed || reading->offset >= reading->size;
+            if (chunk->last) reading = nullptr;
+
+            std::lock_guard<std::mutex> guard(lock);
+            queue.push_back(chunk.get());
+            window.push_back(std::move(chunk));
+            work.notify_one();
+        }
+        if (window.empty()) break;
+
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            finished.wait(guard, [&]() { return window.front()->done; });
+        }
+        std::unique_ptr<Chunk> chunk = std::move(window.front());
+        window.pop_front();
+
+        FileJob &job = *chunk->job;
+        if (!job.failed && (chunk->failed || canceled || !writeChunk(job, chunk->output))) job.failed = true;
+        job.written += static_cast<int64_t>(chunk->output.size());
+        chunk->input = std::vector<unsigned char>();
+        chunk->output = std::vector<unsigned char>();
+
+        if (!chunk->last) continue;
+
+        bool changed = false;
+        if (!job.failed && finishJob(job, changed)) {
+            totals.files++;
+            totals.bytesIn += job.size;
+            totals.bytesOut += job.written;
+        } else if (changed) {
+            totals.changed++;
+        } else if (!canceled) {
+            totals.failures++;
+        }
+        abandonJob(job);
+    }
+
+    // A file canceled halfway had its last chunk never read
+    if (reading) abandonJob(*reading);
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    work.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    return totals;
+}
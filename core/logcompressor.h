@@ -0,0 +1,54 @@
+#ifndef LOGCOMPRESSOR_H
+#define LOGCOMPRESSOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// What one compress() call did
+struct CompressTotals
+{
+    int64_t files = 0;      // replaced by their compressed copy
+    int64_t bytesIn = 0;
+    int64_t bytesOut = 0;
+    int64_t failures = 0;
+    int64_t changed = 0;    // left alone because they were written to meanwhile
+};
+
+// Replaces files with gzip copies (name.gz) on several threads. Files are
+// read in chunks that are compressed independently as members of one gzip
+// stream, which gzip, zcat and zless read as a whole, so a single large
+// log keeps every core busy. Reading runs ahead of writing by a bounded
+// number of chunks, so memory stays around two chunks per thread however
+// big the files are, and small files are compressed side by side.
+//
+// A copy is written under a temporary name and renamed into place only
+// once complete; it takes over the original's timestamps and permissions
+// and the original is removed last. A file that changes while it is being
+// compressed is left as it was.
+class LogCompressor
+{
+public:
+    explicit LogCompressor(int threadCount = 0, int chunkSize = 1024 * 1024, int level = 6);
+
+    // False when built without zlib
+    static bool isSupported();
+    // Names that already are compressed archives
+    static bool isCompressedName(const char *name);
+
+    // Blocks until every file was handled or the run was canceled
+    CompressTotals compress(const std::vector<std::string> &paths);
+
+    void cancel();
+    bool isCanceled() const;
+    int threadCount() const;
+
+private:
+    int threads;
+    int chunkSize;
+    int level;
+    std::atomic<bool> canceled;
+};
+
+#endif // LOGCOMPRESSOR_H
@@ -0,0 +1,285 @@
+#include "metricsserver.h"
+#include "trace.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#ifdef __linux__
+#include <cerrno>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// A scraper that stalls longer than this is dropped, the next one waits
+const int ClientTimeoutMs = 2000;
+const size_t MaxRequestBytes = 8192;
+
+void appendValue(std::string &out, double value)
+{
+    if (std::isnan(value)) {
+        out += "NaN";
+    } else if (std::isinf(value)) {
+        out += value > 0 ? "+Inf" : "-Inf";
+    } else {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+        out += buffer;
+    }
+}
+
+void appendEscaped(std::string &out, const std::string &text, bool quotes)
+{
+    for (char c : text) {
+        if (c == '\\') {
+            out += "\\\\";
+        } else if (c == '\n') {
+            out += "\\n";
+        } else if (c == '"' && quotes) {
+            out += "\\\"";
+        } else {
+            out += c;
+        }
+    }
+}
+
+std::string render(const std::string &status, const std::string &contentType, const std::string &body)
+{
+    std::string text = "HTTP/1.1 " + status + "\r\n"
+                       "Content-Type: " + contentType + "\r\n"
+                       "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                       "Connection: close\r\n"
+                       "\r\n";
+    text += body;
+    return text;
+}
+
+#ifdef __linux__
+bool sendAll(int fd, const char *data, size_t size)
+{
+    while (size > 0) {
+        const ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+#endif
+
+} // namespace
+
+void MetricsWriter::family(const std::string &name, const char *type, const std::string &help)
+{
+    out += "# HELP " + name + " ";
+    appendEscaped(out, help, false);
+    out += "\n# TYPE " + name + " " + type + "\n";
+}
+
+void MetricsWriter::sample(const std::string &name, double value, const Labels &labels)
+{
+    out += name;
+    if (!labels.empty()) {
+        out += '{';
+        for (size_t i = 0; i < labels.size(); ++i) {
+            if (i > 0) out += ',';
+            out += labels[i].first;
+            out += "=\"";
+            appendEscaped(out, labels[i].second, true);
+            out += '"';
+        }
+        out += '}';
+    }
+    out += ' ';
+    appendValue(out, value);
+    out += '\n';
+}
+
+const std::string &MetricsWriter::text() const
+{
+    return out;
+}
+
+MetricsServer::MetricsServer(int port)
+    : listenPort(port)
+    , listenFd(-1)
+    , running(false)
+    , scrapeCount(0)
+{
+    wakeFds[0] = -1;
+    wakeFds[1] = -1;
+    std::atomic_store(&response, std::make_shared<const std::string>(
+        render("200 OK", "text/plain; version=0.0.4; charset=utf-8", std::string())));
+}
+
+MetricsServer::~MetricsServer()
+{
+    stop();
+}
+
+bool MetricsServer::start(std::string *error)
+{
+    if (running) return true;
+#ifdef __linux__
+    auto fail = [this, error](const char *what) {
+        if (error) *error = std::string(what) + ": " + std::strerror(errno);
+        if (listenFd >= 0) close(listenFd);
+        listenFd = -1;
+        return false;
+    };
+
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) return fail("socket");
+    const int reuse = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // Loopback only: the numbers describe this machine and are not meant
+    // for the network
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<uint16_t>(listenPort));
+    if (bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) return fail("bind");
+    if (listen(listenFd, 16) != 0) return fail("listen");
+    if (pipe2(wakeFds, O_CLOEXEC) != 0) return fail("pipe");
+
+    running = true;
+    thread = std::thread([this]() { serve(); });
+    return true;
+#else
+    if (error) *error = "not supported on this platform";
+    return false;
+#endif
+}
+
+void MetricsServer::stop()
+{
+#ifdef __linux__
+    if (!running) return;
+    running = false;
+    const char wake = 0;
+    if (write(wakeFds[1], &wake, 1) < 0) {
+        // The thread still notices on its next wakeup
+    }
+    thread.join();
+    close(listenFd);
+    close(wakeFds[0]);
+    close(wakeFds[1]);
+    listenFd = -1;
+    wakeFds[0] = -1;
+    wakeFds[1] = -1;
+#endif
+}
+
+bool MetricsServer::isRunning() const
+{
+    return running;
+}
+
+int MetricsServer::port() const
+{
+    return listenPort;
+}
+
+int64_t MetricsServer::scrapes() const
+{
+    return scrapeCount;
+}
+
+void MetricsServer::publish(const std::string &section, const std::string &text)
+{
+    TraceSpan span("MetricsServer::publish");
+    if (span.isActive()) span.setDetail(section);
+    std::lock_guard<std::mutex> guard(sectionLock);
+    sections[section] = text;
+
+    std::string body;
+    for (const auto &entry : sections) {
+        body += entry.second;
+    }
+    std::atomic_store(&response, std::make_shared<const std::string>(
+        render("200 OK", "text/plain; version=0.0.4; charset=utf-8", body)));
+}
+
+void MetricsServer::serve()
+{
+#ifdef __linux__
+    while (running) {
+        pollfd fds[2];
+        fds[0].fd = listenFd;
+        fds[0].events = POLLIN;
+        fds[1].fd = wakeFds[0];
+        fds[1].events = POLLIN;
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents) break;
+        if (!(fds[0].revents & POLLIN)) continue;
+
+        const int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) continue;
+        answer(fd);
+        close(fd);
+    }
+#endif
+}
+
+void MetricsServer::answer(int fd)
+{
+#ifdef __linux__
+    timeval timeout;
+    timeout.tv_sec = ClientTimeoutMs / 1000;
+    timeout.tv_usec = (ClientTimeoutMs % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    // Only the request line matters; the headers are read up to their end
+    // so the client sees an orderly close
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < MaxRequestBytes) {
+        const ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) break;
+        request.append(buffer, static_cast<size_t>(received));
+    }
+
+    const size_t methodEnd = request.find(' ');
+    const size_t pathEnd = methodEnd == std::string::npos ? std::string::npos : request.find(' ', methodEnd + 1);
+    if (pathEnd == std::string::npos) return;
+    const std::string method = request.substr(0, methodEnd);
+    std::string path = request.substr(methodEnd + 1, pathEnd - methodEnd - 1);
+    path = path.substr(0, path.find('?'));
+
+    if (method != "GET" && method != "HEAD") {
+        const std::string reply = render("405 Method Not Allowed", "text/plain", "Only GET is supported\n");
+        sendAll(fd, reply.data(), reply.size());
+        return;
+    }
+    if (path != "/metrics" && path != "/") {
+        const std::string reply = render("404 Not Found", "text/plain", "Metrics are at /metrics\n");
+        sendAll(fd, reply.data(), reply.size());
+        return;
+    }
+
+    scrapeCount++;
+    const std::shared_ptr<const std::string> current = std::atomic_load(&response);
+    size_t size = current->size();
+    if (method == "HEAD") size = current->find("\r\n\r\n") + 4;
+    sendAll(fd, current->data(), size);
+#else
+    (void)fd;
+#endif
+}
@@ -0,0 +1,75 @@
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Renders metric families in the Prometheus text exposition format
+class MetricsWriter
+{
+public:
+    typedef std::vector<std::pair<std::string, std::string>> Labels;
+
+    // Starts a family; its samples must follow before the next family.
+    // type is "gauge" or "counter".
+    void family(const std::string &name, const char *type, const std::string &help);
+    void sample(const std::string &name, double value, const Labels &labels = Labels());
+
+    const std::string &text() const;
+
+private:
+    std::string out;
+};
+
+// Serves the metrics Raptor collects over HTTP on 127.0.0.1, for
+// Prometheus to scrape. Whoever collects a set of numbers renders them
+// with a MetricsWriter and publishes the text as a section; every publish
+// renders the complete HTTP response once and swaps it in atomically.
+// A scrape only takes a reference to the current response and writes it
+// out on the server's own thread, so it never triggers collection and
+// never waits for the GUI or a publisher.
+//
+// Only available on Linux; start() fails elsewhere.
+class MetricsServer
+{
+public:
+    static const int DefaultPort = 9788;
+
+    explicit MetricsServer(int port = DefaultPort);
+    ~MetricsServer();
+
+    bool start(std::string *error = nullptr);
+    void stop();
+    bool isRunning() const;
+    int port() const;
+
+    // Replaces the section's text; sections appear sorted by name. Safe to
+    // call from any thread.
+    void publish(const std::string &section, const std::string &text);
+
+    int64_t scrapes() const;
+
+private:
+    void serve();
+    void answer(int fd);
+
+    int listenPort;
+    int listenFd;
+    int wakeFds[2];
+    std::thread thread;
+    std::atomic<bool> running;
+    std::atomic<int64_t> scrapeCount;
+
+    std::mutex sectionLock;  // publishers only
+    std::map<std::string, std::string> sections;
+    std::shared_ptr<const std::string> response;  // accessed with std::atomic_load/store
+};
+
+#endif // METRICSSERVER_H
@@ -0,0 +1,239 @@
+#include "networkprobe.h"
+#include "trace.h"
+
+#include <QFile>
+#include <QProcess>
+
+QString NetworkProbe::executeCommand(const QString &command, const QStringList &arguments)
+{
+    TraceSpan span("NetworkProbe::executeCommand");
+    if (span.isActive()) span.setDetail((command + " " + arguments.join(" ")).toStdString());
+    QProcess process;
+    process.start(command, arguments);
+    process.waitForFinished();
+    return QString::fromLocal8Bit(process.readAllStandardOutput());
+}
+
+QList<NetworkAdapter> NetworkProbe::adapters()
+{
+    TraceSpan span("NetworkProbe::adapters");
+    QList<NetworkAdapter> found;
+    QString ipconfigOutput = executeCommand("ipconfig", QStringList() << "/all");
+    QStringList lines = ipconfigOutput.split('\n');
+
+    NetworkAdapter current;
+
+    for (const QString &line : lines) {
+        QString trimmed = line.trimmed();
+
+        if (!trimmed.isEmpty() && trimmed.endsWith(":") && !trimmed.startsWith("   ")) {
+            if (!current.name.isEmpty() && !current.address.isEmpty()) {
+                found << current;
+            }
+
+            current.name = trimmed;
+            current.name.remove(":");
+            current.address.clear();
+        }
+        else if (trimmed.startsWith("IPv4 Address") || (trimmed.startsWith("IP Address") && !trimmed.contains("IPv6"))) {
+            QStringList parts = trimmed.split(":");
+            if (parts.size() > 1) {
+                current.address = parts[1].trimmed();
+                current.address.remove("(Preferred)");
+                current.address.remove("(Deprecated)");
+                current.address = current.address.trimmed();
+            }
+        }
+    }
+
+    if (!current.name.isEmpty() && !current.address.isEmpty()) {
+        found << current;
+    }
+    return found;
+}
+
+QStringList NetworkProbe::ipDetails()
+{
+    TraceSpan span("NetworkProbe::ipDetails");
+    QStringList details;
+    QString output = executeCommand("ipconfig", QStringList());
+
+    QStringList lines = output.split('\n');
+    for (const QString &line : lines) {
+        QString trimmed = line.trimmed();
+        if (trimmed.contains("IPv4") || trimmed.startsWith("IP Address") ||
+            trimmed.startsWith("Subnet") || trimmed.startsWith("Default Gateway")) {
+            details << trimmed;
+        }
+    }
+    return details;
+}
+
+ConnectionSummary NetworkProbe::connections(int recentLimit)
+{
+    TraceSpan span("NetworkProbe::connections");
+    ConnectionSummary summary;
+    QString output = executeCommand("netstat", QStringList() << "-n");
+    QStringList lines = output.split('\n');
+
+    for (const QString &line : lines) {
+        if (line.startsWith("  TCP")) {
+            summary.tcp++;
+            if (summary.tcp <= recentLimit) {
+                summary.recentTcp << line.trimmed();
+            }
+        } else if (line.startsWith("  UDP")) {
+            summary.udp++;
+        }
+    }
+    return summary;
+}
+
+QList<InterfaceCounters> NetworkProbe::interfaceCounters()
+{
+    TraceSpan span("NetworkProbe::interfaceCounters");
+    QList<InterfaceCounters> counters;
+#ifdef __linux__
+    // "  eth0: rxbytes rxpackets errs drop fifo frame compressed multicast
+    //  txbytes txpackets ...", after two header lines
+    QFile file("/proc/net/dev");
+    if (!file.open(QIODevice::ReadOnly)) return counters;
+    const QStringList lines = QString::fromLatin1(file.readAll()).split('\n');
+    for (int i = 2; i < lines.size(); ++i) {
+        const int colon = lines[i].indexOf(':');
+        if (colon < 0) continue;
+        const QStringList fields = lines[i].mid(colon + 1).simplified().split(' ');
+        if (fields.size() < 10) continue;
+
+        InterfaceCounters nic;
+        nic.name = lines[i].left(colon).trimmed();
+        nic.receivedBytes = fields[0].toLongLong();
+        nic.receivedPackets = fields[1].toLongLong();
+        nic.sentBytes = fields[8].toLongLong();
+        nic.sentPackets = fields[9].toLongLong();
+        counters << nic;
+    }
+#else
+    // "Bytes   received   sent" and "Unicast packets   received   sent"
+    QString output = executeCommand("netstat", QStringList() << "-e");
+    InterfaceCounters total;
+    total.name = "total";
+    bool found = false;
+    for (const QString &line : output.split('\n')) {
+        const QStringList fields = line.simplified().split(' ');
+        if (fields.size() < 3) continue;
+        if (fields[0] == "Bytes") {
+            total.receivedBytes = fields[fields.size() - 2].toLongLong();
+            total.sentBytes = fields[fields.size() - 1].toLongLong();
+            found = true;
+        } else if (fields[0] == "Unicast") {
+            total.receivedPackets = fields[fields.size() - 2].toLongLong();
+            total.sentPackets = fields[fields.size() - 1].toLongLong();
+        }
+    }
+    if (found) counters << total;
+#endif
+    return counters;
+}
+
+QString NetworkProbe::ethernetStatus()
+{
+    TraceSpan span("NetworkProbe::ethernetStatus");
+    QString adapterName = ethernetAdapterName();
+
+    // Try PowerShell method first (more reliable)
+    QString psOutput = executeCommand("powershell", QStringList() << "-Command" <<
+        QString("$adapter = Get-NetAdapter -Name '%1' -ErrorAction SilentlyContinue; if ($adapter) { if ($adapter.Status -eq 'Up') { 'Connected' } else { 'Disabled' } } else { 'Not Found' }").arg(adapterName));
+
+    QString status = psOutput.trimmed();
+    if (!status.isEmpty() && status != "null") {
+        return status;
+    }
+
+    // Fallback to netsh method
+    QString output = executeCommand("netsh", QStringList() << "interface" << "show" << "interface");
+    QStringList lines = output.split('\n');
+    for (const QString &line : lines) {
+        if (line.contains(adapterName) || line.contains("Ethernet") || line.contains("Local Area Connection")) {
+            if (line.contains("Connected")) {
+                return "Connected";
+            } else if (line.contains("Disconnected")) {
+                return "Disabled";
+            } else if (line.contains("Enabled")) {
+                return "Enabled";
+            } else if (line.contains("Disabled")) {
+                return "Disabled";
+            }
+        }
+    }
+
+    return "Not Found";
+}
+
+QString NetworkProbe::wifiAdapterStatus()
+{
+    TraceSpan span("NetworkProbe::wifiAdapterStatus");
+    QString output = executeCommand("powershell", QStringList() << "-Command" <<
+        "$adapter = Get-NetAdapter -Name 'Wi-Fi' -ErrorAction SilentlyContinue; "
+        "if ($adapter) { if ($adapter.Status -eq 'Up') { 'Enabled' } else { 'Disabled' } } else { 'Not Found' }");
+
+    return output.trimmed();
+}
+
+QString NetworkProbe::wifiRadioStatus()
+{
+    TraceSpan span("NetworkProbe::wifiRadioStatus");
+    QString output = executeCommand("powershell", QStringList() << "-Command" <<
+        "$interface = netsh interface show interface 'Wi-Fi'; "
+        "if ($interface -like '*Enabled*') { 'Enabled' } else { 'Disabled' }");
+
+    return output.trimmed();
+}
+
+QString NetworkProbe::bluetoothAdapterStatus()
+{
+    TraceSpan span("NetworkProbe::bluetoothAdapterStatus");
+    QString output = executeCommand("powershell", QStringList() << "-Command" <<
+        "$bt = Get-PnpDevice -Class Bluetooth -Status 'OK' -ErrorAction SilentlyContinue | Select-Object -First 1; "
+        "if ($bt) { 'Enabled' } else { 'Disabled' }");
+
+    return output.trimmed();
+}
+
+QString NetworkProbe::bluetoothRadioStatus()
+{
+    TraceSpan span("NetworkProbe::bluetoothRadioStatus");
+    QString output = executeCommand("powershell", QStringList() << "-Command" <<
+        "$radio = Get-WmiObject -Namespace 'Root\\WMI' -Class 'MS_SystemInformation' -ErrorAction SilentlyContinue; "
+        "if ($radio) { 'Enabled' } else { 'Disabled' }");
+
+    return output.trimmed();
+}
+
+AdapterStates NetworkProbe::adapterStates()
+{
+    TraceSpan span("NetworkProbe::adapterStates");
+    AdapterStates states;
+    states.ethernet = ethernetStatus();
+    states.wifiAdapter = wifiAdapterStatus();
+    states.wifiRadio = wifiRadioStatus();
+    states.bluetoothAdapter = bluetoothAdapterStatus();
+    states.bluetoothRadio = bluetoothRadioStatus();
+    return states;
+}
+
+QString NetworkProbe::ethernetAdapterName()
+{
+    TraceSpan span("NetworkProbe::ethernetAdapterName");
+    // Find the actual Ethernet adapter name
+    QString output = executeCommand("powershell", QStringList() << "-Command" <<
+        "Get-NetAdapter -Physical | Where-Object {$_.InterfaceDescription -like '*Ethernet*' -or $_.Name -like '*Ethernet*'} | Select-Object -First 1 | Select-Object -ExpandProperty Name");
+
+    QString name = output.trimmed();
+    if (!name.isEmpty() && name != "null") {
+        return name;
+    }
+
+    // Fallback to common names
+    return "Ethernet";
+}
@@ -0,0 +1,69 @@
+#ifndef NETWORKPROBE_H
+#define NETWORKPROBE_H
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+// An adapter that has an IPv4 address
+struct NetworkAdapter
+{
+    QString name;
+    QString address;
+};
+
+struct ConnectionSummary
+{
+    int tcp = 0;
+    int udp = 0;
+    QStringList recentTcp;  // the first few netstat lines
+};
+
+// Traffic counters of an interface since it came up
+struct InterfaceCounters
+{
+    QString name;
+    qint64 receivedBytes = 0;
+    qint64 sentBytes = 0;
+    qint64 receivedPackets = 0;
+    qint64 sentPackets = 0;
+};
+
+// What the Network page's adapter buttons show
+struct AdapterStates
+{
+    QString ethernet;
+    QString wifiAdapter;
+    QString wifiRadio;
+    QString bluetoothAdapter;
+    QString bluetoothRadio;
+};
+
+// Reads the state of the network from the system tools (ipconfig, netstat,
+// PowerShell) without any user interface, for the Network page and the
+// command line. Every call runs a child process and blocks until it ends.
+class NetworkProbe
+{
+public:
+    QList<NetworkAdapter> adapters();
+    // IPv4 address, subnet and gateway lines of ipconfig
+    QStringList ipDetails();
+    ConnectionSummary connections(int recentLimit = 10);
+    // Per interface from /proc/net/dev on Linux; elsewhere one "total"
+    // entry from netstat -e
+    QList<InterfaceCounters> interfaceCounters();
+
+    // "Connected", "Enabled", "Disabled" or "Not Found"
+    QString ethernetStatus();
+    QString wifiAdapterStatus();
+    QString wifiRadioStatus();
+    QString bluetoothAdapterStatus();
+    QString bluetoothRadioStatus();
+    // All of the above in one go
+    AdapterStates adapterStates();
+    QString ethernetAdapterName();
+
+    static QString executeCommand(const QString &command, const QStringList &arguments = QStringList());
+};
+
+#endif // NETWORKPROBE_H
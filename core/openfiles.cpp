@@ -0,0 +1,178 @@
+#include "openfiles.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstdlib>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Processes handed to a thread at a time
+const size_t ProcessBatch = 16;
+
+#ifdef __linux__
+bool isNumber(const char *name)
+{
+    if (!*name) return false;
+    for (const char *c = name; *c; ++c) {
+        if (*c < '0' || *c > '9') return false;
+    }
+    return true;
+}
+
+std::vector<int> listProcesses()
+{
+    std::vector<int> pids;
+    DIR *proc = opendir("/proc");
+    if (!proc) return pids;
+    const int self = static_cast<int>(getpid());
+    while (struct dirent *entry = readdir(proc)) {
+        if (!isNumber(entry->d_name)) continue;
+        const int pid = std::atoi(entry->d_name);
+        // Our own descriptors are the scan's, not a reason to keep a file
+        if (pid != self) pids.push_back(pid);
+    }
+    closedir(proc);
+    return pids;
+}
+#endif
+
+} // namespace
+
+OpenFileSet::OpenFileSet(int threadCount)
+    : threads(threadCount)
+    , processTotal(0)
+    , checkedTotal(0)
+{
+    if (threads <= 0) {
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+        if (threads <= 0) threads = 4;
+    }
+}
+
+bool OpenFileSet::isSupported()
+{
+#ifdef __linux__
+    return access("/proc/self/fd", R_OK) == 0;
+#else
+    return false;
+#endif
+}
+
+void OpenFileSet::clear()
+{
+    files.clear();
+    processTotal = 0;
+    checkedTotal = 0;
+}
+
+void OpenFileSet::refresh()
+{
+#ifdef __linux__
+    const std::vector<int> pids = listProcesses();
+
+    // One slot per pid, filled by whichever thread takes it
+    std::vector<std::vector<Key>> found(pids.size());
+    std::vector<char> readable(pids.size(), 0);
+    std::atomic<size_t> next(0);
+    std::atomic<int64_t> checked(0);
+
+    auto readProcess = [&](size_t index) {
+        const int pid = pids[index];
+        std::vector<Key> &keys = found[index];
+
+        char path[64];
+        std::snprintf(path, sizeof(path), "/proc/%d/fd", pid);
+        const int fdDir = ::open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        // Other users' processes are not readable without privileges
+        if (fdDir < 0) return;
+        DIR *dir = fdopendir(fdDir);
+        if (!dir) {
+            ::close(fdDir);
+            return;
+        }
+
+        int64_t statted = 0;
+        while (struct dirent *entry = readdir(dir)) {
+            if (!isNumber(entry->d_name)) continue;
+
+            // Follows the magic link to the open file itself
+            struct stat st;
+            if (fstatat(fdDir, entry->d_name, &st, 0) != 0) continue;
+            ++statted;
+            // Pipes, sockets and the like cannot be in a cleanup root
+            if (S_ISREG(st.st_mode)) {
+                keys.push_back(Key{static_cast<uint64_t>(st.st_dev), static_cast<uint64_t>(st.st_ino)});
+            }
+        }
+        closedir(dir);
+
+        checked.fetch_add(statted, std::memory_order_relaxed);
+        readable[index] = 1;
+    };
+
+    auto work = [&]() {
+        while (true) {
+            const size_t start = next.fetch_add(ProcessBatch, std::memory_order_relaxed);
+            if (start >= pids.size()) return;
+            const size_t end = std::min(pids.size(), start + ProcessBatch);
+            for (size_t i = start; i < end; ++i) {
+                readProcess(i);
+            }
+        }
+    };
+
+    const size_t helperCount = std::min(static_cast<size_t>(threads), pids.size() / ProcessBatch + 1) - 1;
+    std::vector<std::thread> helpers;
+    for (size_t i = 0; i < helperCount; ++i) {
+        helpers.emplace_back(work);
+    }
+    work();
+    for (std::thread &helper : helpers) {
+        helper.join();
+    }
+
+    std::vector<Key> keys;
+    int readableCount = 0;
+    for (size_t i = 0; i < pids.size(); ++i) {
+        if (!readable[i]) continue;
+        keys.insert(keys.end(), found[i].begin(), found[i].end());
+        ++readableCount;
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    files.swap(keys);
+    processTotal = readableCount;
+    checkedTotal = checked;
+#endif
+}
+
+bool OpenFileSet::contains(uint64_t device, uint64_t inode) const
+{
+    return std::binary_search(files.begin(), files.end(), Key{device, inode});
+}
+
+size_t OpenFileSet::size() const
+{
+    return files.size();
+}
+
+int OpenFileSet::processCount() const
+{
+    return processTotal;
+}
+
+int64_t OpenFileSet::descriptorsChecked() const
+{
+    return checkedTotal;
+}
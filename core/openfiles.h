@@ -0,0 +1,55 @@
+#ifndef OPENFILES_H
+#define OPENFILES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Regular files some process currently holds open, as (device, inode)
+// pairs, so a cleanup can leave them alone instead of failing on them or
+// pulling a live temp file out from under a running service. Built from
+// /proc/<pid>/fd on Linux; elsewhere the set stays empty and locked files
+// are left to the retry queue.
+//
+// Processes are read on several threads. Every refresh stats every
+// descriptor again: the kernel hands out the lowest free number, so a
+// file closed and another one opened in its place usually share one, and
+// nothing cheaper than the stat tells them apart.
+//
+// contains() may be called from any number of threads between refreshes.
+class OpenFileSet
+{
+public:
+    explicit OpenFileSet(int threadCount = 0);
+
+    static bool isSupported();
+
+    void refresh();
+    void clear();
+
+    bool contains(uint64_t device, uint64_t inode) const;
+    size_t size() const;
+
+    // Of the last refresh
+    int processCount() const;
+    int64_t descriptorsChecked() const;
+
+private:
+    struct Key
+    {
+        uint64_t device;
+        uint64_t inode;
+        bool operator<(const Key &other) const
+        {
+            return device != other.device ? device < other.device : inode < other.inode;
+        }
+        bool operator==(const Key &other) const { return device == other.device && inode == other.inode; }
+    };
+
+    int threads;
+    std::vector<Key> files;  // sorted, for lock-free lookups
+    int processTotal;
+    int64_t checkedTotal;
+};
+
+#endif // OPENFILES_H
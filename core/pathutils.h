@@ -0,0 +1,73 @@
+#ifndef PATHUTILS_H
+#define PATHUTILS_H
+
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#ifndef __linux__
+#include <chrono>
+#include <filesystem>
+#endif
+
+// Appends name to dir with exactly one separator between them
+inline std::string joinPath(const std::string &dir, const char *name)
+{
+    std::string path;
+    path.reserve(dir.size() + 1 + std::strlen(name));
+    path = dir;
+    if (path.empty() || path.back() != '/') path += '/';
+    path += name;
+    return path;
+}
+
+// True when path is root itself or lies somewhere below it
+inline bool isPathUnder(const std::string &path, const std::string &root)
+{
+    if (path.compare(0, root.size(), root) != 0) return false;
+    return path.size() == root.size() || path[root.size()] == '/' || (!root.empty() && root.back() == '/');
+}
+
+inline std::string parentPath(const std::string &path)
+{
+    const size_t slash = path.find_last_of('/');
+    if (slash == std::string::npos) return std::string();
+    return slash == 0 ? std::string("/") : path.substr(0, slash);
+}
+
+// Matches name against a shell-style pattern using '*' and '?', ignoring
+// ASCII case the way the Windows shell does
+inline bool wildcardMatch(const char *pattern, const char *name)
+{
+    const char *star = nullptr;
+    const char *resume = nullptr;
+    while (*name) {
+        if (*pattern == '*') {
+            star = pattern++;
+            resume = name;
+        } else if (*pattern == '?'
+                   || std::tolower(static_cast<unsigned char>(*pattern)) == std::tolower(static_cast<unsigned char>(*name))) {
+            ++pattern;
+            ++name;
+        } else if (star) {
+            pattern = star + 1;
+            name = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (*pattern == '*') ++pattern;
+    return *pattern == '\0';
+}
+
+#ifndef __linux__
+// Seconds since the Unix epoch, the unit st_mtime uses on Linux
+inline int64_t unixSeconds(std::filesystem::file_time_type time)
+{
+    const auto systemTime = std::chrono::system_clock::now() + (time - std::filesystem::file_time_type::clock::now());
+    return std::chrono::duration_cast<std::chrono::seconds>(systemTime.time_since_epoch()).count();
+}
+#endif
+
+#endif // PATHUTILS_H
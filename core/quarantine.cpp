@@ -0,0 +1,526 @@
+#include "quarantine.h"
+#include "binaryio.h"
+#include "dirscanner.h"
+#include "iothrottle.h"
+#include "pathutils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <set>
+
+#ifdef __linux__
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <filesystem>
+#include <system_error>
+#endif
+
+namespace {
+
+const char RunMagic[4] = {'R', 'P', 'Q', 'R'};
+const uint32_t RunVersion = 1;
+const char RunSuffix[] = ".run";
+
+// Name of the per-file-system stores, never touched by a cleanup
+const char StoreName[] = ".raptor-quarantine";
+
+int64_t unixNow()
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool endsWith(const std::string &text, const char *suffix)
+{
+    const size_t length = std::strlen(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+#ifdef __linux__
+const unsigned RenameNoReplace = 1;  // RENAME_NOREPLACE
+
+// Renames without ever replacing an existing entry
+int renameNoReplace(int fromFd, const char *from, int toFd, const char *to)
+{
+#ifdef SYS_renameat2
+    if (syscall(SYS_renameat2, fromFd, from, toFd, to, RenameNoReplace) == 0) return 0;
+    if (errno != ENOSYS && errno != EINVAL) return -1;
+#endif
+    // Kernel or file system without renameat2, the check races only with
+    // someone recreating the name at the same moment
+    struct stat st;
+    if (fstatat(toFd, to, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+        errno = EEXIST;
+        return -1;
+    }
+    return renameat(fromFd, from, toFd, to);
+}
+
+bool makeDirectories(const std::string &path)
+{
+    if (mkdir(path.c_str(), 0700) == 0 || errno == EEXIST) return true;
+    if (errno != ENOENT) return false;
+    const std::string parent = parentPath(path);
+    if (parent.empty() || parent == path || !makeDirectories(parent)) return false;
+    return mkdir(path.c_str(), 0700) == 0 || errno == EEXIST;
+}
+
+std::vector<std::string> listNames(const std::string &path)
+{
+    std::vector<std::string> names;
+    DIR *dir = opendir(path.c_str());
+    if (!dir) return names;
+    while (dirent *entry = readdir(dir)) {
+        if (std::strcmp(entry->d_name, ".") == 0 || std::strcmp(entry->d_name, "..") == 0) continue;
+        names.push_back(entry->d_name);
+    }
+    closedir(dir);
+    return names;
+}
+
+bool isDirectory(const std::string &path)
+{
+    struct stat st;
+    return lstat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool renamePath(const std::string &from, const std::string &to)
+{
+    return renameNoReplace(AT_FDCWD, from.c_str(), AT_FDCWD, to.c_str()) == 0;
+}
+
+bool removeDirectory(const std::string &path)
+{
+    return rmdir(path.c_str()) == 0;
+}
+
+bool removeFile(const std::string &path)
+{
+    return unlink(path.c_str()) == 0;
+}
+
+#else
+namespace fs = std::filesystem;
+
+bool makeDirectories(const std::string &path)
+{
+    std::error_code ec;
+    fs::create_directories(fs::u8path(path), ec);
+    return fs::is_directory(fs::u8path(path), ec);
+}
+
+std::vector<std::string> listNames(const std::string &path)
+{
+    std::vector<std::string> names;
+    std::error_code ec;
+    for (fs::directory_iterator it(fs::u8path(path), ec), end; !ec && it != end; it.increment(ec)) {
+        names.push_back(it->path().filename().u8string());
+    }
+    return names;
+}
+
+bool isDirectory(const std::string &path)
+{
+    std::error_code ec;
+    return fs::is_directory(fs::symlink_status(fs::u8path(path), ec));
+}
+
+bool renamePath(const std::string &from, const std::string &to)
+{
+    // std::filesystem::rename replaces existing files
+    std::error_code ec;
+    if (fs::exists(fs::symlink_status(fs::u8path(to), ec))) return false;
+    fs::rename(fs::u8path(from), fs::u8path(to), ec);
+    return !ec;
+}
+
+bool removeDirectory(const std::string &path)
+{
+    std::error_code ec;
+    return fs::remove(fs::u8path(path), ec);
+}
+
+bool removeFile(const std::string &path)
+{
+    return removeDirectory(path);
+}
+#endif
+
+// Moves everything in from into to, merging folders that exist on both
+// sides. Returns true once from is empty and removed.
+bool restoreTree(const std::string &from, const std::string &to, Quarantine::Totals &totals)
+{
+    bool complete = true;
+    for (const std::string &name : listNames(from)) {
+        const std::string source = joinPath(from, name.c_str());
+        const std::string target = joinPath(to, name.c_str());
+        if (renamePath(source, target)) {
+            totals.entries++;
+        } else if (isDirectory(source) && isDirectory(target)) {
+            complete = restoreTree(source, target, totals) && complete;
+        } else {
+            totals.conflicts++;
+            complete = false;
+        }
+    }
+    return complete && removeDirectory(from);
+}
+
+// Renames the files a filter accepts, recreating their folders below the
+// store. Called concurrently from the scanner's workers.
+class FileMover : public ScanVisitor
+{
+public:
+    FileMover(const std::string &rootPath, const std::string &storePath, const TreeDeleter::Filter &accept)
+        : root(rootPath)
+        , store(storePath)
+        , filter(accept)
+        , moved(0)
+        , failed(0)
+    {
+    }
+
+    void visitFile(const ScanFileEntry &entry) override
+    {
+        if (!entry.dirPath || Quarantine::isStorePath(*entry.dirPath)) return;
+        if (!filter(entry)) return;
+
+        const std::string &dirPath = *entry.dirPath;
+        const std::string targetDir = store + dirPath.substr(std::min(root.size(), dirPath.size()));
+        if (!ensureDirectory(targetDir)) {
+            failed.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+#ifdef __linux__
+        const bool renamed = renameNoReplace(entry.dirFd, entry.name, AT_FDCWD,
+                                             joinPath(targetDir, entry.name).c_str()) == 0;
+#else
+        const bool renamed = renamePath(joinPath(dirPath, entry.name), joinPath(targetDir, entry.name));
+#endif
+        (renamed ? moved : failed).fetch_add(1, std::memory_order_relaxed);
+    }
+
+    int64_t entriesMoved() const { return moved.load(std::memory_order_relaxed); }
+    int64_t failures() const { return failed.load(std::memory_order_relaxed); }
+
+private:
+    bool ensureDirectory(const std::string &path)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (created.count(path)) return true;
+        if (!makeDirectories(path)) return false;
+        created.insert(path);
+        return true;
+    }
+
+    const std::string &root;
+    const std::string &store;
+    const TreeDeleter::Filter &filter;
+    std::mutex lock;
+    std::set<std::string> created;
+    std::atomic<int64_t> moved;
+    std::atomic<int64_t> failed;
+};
+
+} // namespace
+
+Quarantine::Quarantine(const std::string &quarantineDirectory)
+    : directory(quarantineDirectory)
+    , canceled(false)
+    , activeScanner(nullptr)
+    , activeDeleter(nullptr)
+    , gracePeriod(0)
+    , purgeIntervalSeconds(0)
+    , stopping(false)
+{
+}
+
+Quarantine::~Quarantine()
+{
+    stopPurger();
+}
+
+bool Quarantine::isStorePath(const std::string &path)
+{
+    return path.find(StoreName) != std::string::npos;
+}
+
+std::string Quarantine::recordPath(const std::string &id) const
+{
+    return joinPath(directory, (id + RunSuffix).c_str());
+}
+
+// The store for root's file system, created if needed, or an empty
+// string when there is none the user may write to
+std::string Quarantine::storeFor(const std::string &root) const
+{
+#ifdef __linux__
+    struct stat rootStat;
+    struct stat st;
+    if (stat(root.c_str(), &rootStat) != 0) return std::string();
+    if (makeDirectories(directory) && stat(directory.c_str(), &st) == 0 && st.st_dev == rootStat.st_dev) {
+        return directory;
+    }
+
+    // Top of the root's file system: its last ancestor on the same device
+    std::string top = root;
+    while (top != "/") {
+        const std::string parent = parentPath(top);
+        if (parent.empty() || stat(parent.c_str(), &st) != 0 || st.st_dev != rootStat.st_dev) break;
+        top = parent;
+    }
+
+    // One store per user, like .Trash-<uid>. The top may be shared with
+    // other users (a tmpfs /tmp), so never follow a planted symlink.
+    const std::string store = joinPath(top, (std::string(StoreName) + "-" + std::to_string(getuid())).c_str());
+    if (mkdir(store.c_str(), 0700) != 0 && errno != EEXIST) return std::string();
+    if (lstat(store.c_str(), &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != getuid()
+        || st.st_dev != rootStat.st_dev) {
+        return std::string();
+    }
+    return store;
+#else
+    std::error_code ec;
+    const fs::path rootPath = fs::u8path(root);
+    if (makeDirectories(directory) && fs::u8path(directory).root_name() == rootPath.root_name()) {
+        return directory;
+    }
+
+    const fs::path store = rootPath.root_path() / StoreName;
+    if (!makeDirectories(store.u8string())) return std::string();
+    return store.generic_u8string();
+#endif
+}
+
+void Quarantine::begin(int64_t now)
+{
+    canceled = false;
+    current = Run();
+    current.created = now;
+
+    // Seconds are unique enough, unless two cleanups start within one
+    current.id = std::to_string(now);
+    std::vector<char> existing;
+    for (int suffix = 2; readWholeFile(recordPath(current.id), existing); ++suffix) {
+        current.id = std::to_string(now) + "-" + std::to_string(suffix);
+    }
+}
+
+bool Quarantine::move(const std::string &root, const TreeDeleter::Filter &filter, Totals &totals)
+{
+    const std::string store = storeFor(root);
+    if (store.empty()) return false;
+
+    const std::string target = joinPath(joinPath(store, current.id.c_str()),
+                                        std::to_string(current.roots.size()).c_str());
+    if (!makeDirectories(target)) return false;
+    current.roots.push_back(root);
+    current.stores.push_back(target);
+
+    if (!filter) {
+        // The store may be inside root when root is the top of its file system
+        for (const std::string &name : listNames(root)) {
+            if (canceled) break;
+            if (name.compare(0, std::strlen(StoreName), StoreName) == 0) continue;
+            if (renamePath(joinPath(root, name.c_str()), joinPath(target, name.c_str()))) {
+                totals.entries++;
+            } else {
+                totals.failures++;
+            }
+        }
+        return true;
+    }
+
+    DirScanner scanner;
+    FileMover mover(root, target, filter);
+    scanner.setVisitor(&mover);
+    {
+        std::lock_guard<std::mutex> guard(activeLock);
+        activeScanner = &scanner;
+    }
+    if (canceled) scanner.cancel();
+
+    scanner.scan(std::vector<std::string>{root});
+
+    {
+        std::lock_guard<std::mutex> guard(activeLock);
+        activeScanner = nullptr;
+    }
+    totals.entries += mover.entriesMoved();
+    totals.failures += mover.failures();
+    return true;
+}
+
+std::string Quarantine::commit()
+{
+    Run run;
+    std::swap(run, current);
+    if (run.roots.empty()) return std::string();
+
+    Writer writer;
+    writer.raw(RunMagic, sizeof(RunMagic));
+    writer.u32(RunVersion);
+    writer.i64(run.created);
+    writer.varint(run.roots.size());
+    for (size_t i = 0; i < run.roots.size(); ++i) {
+        writer.str(run.roots[i]);
+        writer.str(run.stores[i]);
+    }
+
+    // Without a record the entries could neither be restored nor purged,
+    // so put them back right away
+    if (!writeFileAtomically(recordPath(run.id), writer.buffer)) {
+        Totals totals;
+        for (size_t i = 0; i < run.roots.size(); ++i) {
+            restoreTree(run.stores[i], run.roots[i], totals);
+            removeDirectory(parentPath(run.stores[i]));
+        }
+        return std::string();
+    }
+    return run.id;
+}
+
+void Quarantine::cancel()
+{
+    canceled = true;
+    std::lock_guard<std::mutex> guard(activeLock);
+    if (activeScanner) activeScanner->cancel();
+}
+
+bool Quarantine::loadRun(const std::string &filePath, Run &run) const
+{
+    std::vector<char> data;
+    if (!readWholeFile(filePath, data)) return false;
+
+    Reader reader(data);
+    char magic[4];
+    reader.raw(magic, sizeof(magic));
+    if (!reader.ok() || std::memcmp(magic, RunMagic, sizeof(magic)) != 0) return false;
+    if (reader.u32() != RunVersion) return false;
+    run.created = reader.i64();
+
+    const uint64_t count = reader.varint();
+    for (uint64_t i = 0; i < count && reader.ok(); ++i) {
+        run.roots.push_back(reader.str());
+        run.stores.push_back(reader.str());
+    }
+    return reader.ok();
+}
+
+std::vector<Quarantine::Run> Quarantine::runs() const
+{
+    std::vector<Run> found;
+    for (const std::string &name : listNames(directory)) {
+        if (!endsWith(name, RunSuffix)) continue;
+        Run run;
+        run.id = name.substr(0, name.size() - std::strlen(RunSuffix));
+        if (loadRun(joinPath(directory, name.c_str()), run)) found.push_back(run);
+    }
+    std::sort(found.begin(), found.end(), [](const Run &a, const Run &b) {
+        return a.created != b.created ? a.created < b.created : a.id < b.id;
+    });
+    return found;
+}
+
+Quarantine::Totals Quarantine::restore(const std::string &id)
+{
+    std::lock_guard<std::mutex> guard(runLock);
+
+    Totals totals;
+    Run run;
+    if (!loadRun(recordPath(id), run)) return totals;
+
+    bool complete = true;
+    for (size_t i = 0; i < run.roots.size(); ++i) {
+        // The folder may have been removed since, e.g. a whole browser cache
+        if (!makeDirectories(run.roots[i])) {
+            totals.failures++;
+            complete = false;
+            continue;
+        }
+        complete = restoreTree(run.stores[i], run.roots[i], totals) && complete;
+        removeDirectory(parentPath(run.stores[i]));
+    }
+
+    // Leftovers keep their record so the purger still deletes them
+    if (complete) removeFile(recordPath(id));
+    return totals;
+}
+
+int Quarantine::purge(int64_t cutoff)
+{
+    std::lock_guard<std::mutex> guard(runLock);
+
+    int purged = 0;
+    for (const Run &run : runs()) {
+        if (run.created >= cutoff) continue;
+        if (stopping) break;
+
+        TreeDeleter deleter;
+        {
+            std::lock_guard<std::mutex> activeGuard(activeLock);
+            activeDeleter = &deleter;
+        }
+        deleter.remove(run.stores);
+        {
+            std::lock_guard<std::mutex> activeGuard(activeLock);
+            activeDeleter = nullptr;
+        }
+        if (deleter.isCanceled()) break;
+
+        // The deleter never removes its roots
+        for (const std::string &store : run.stores) {
+            removeDirectory(store);
+            removeDirectory(parentPath(store));
+        }
+        removeFile(recordPath(run.id));
+        purged++;
+    }
+    return purged;
+}
+
+void Quarantine::startPurger(int64_t grace, int intervalSeconds)
+{
+    stopPurger();
+    gracePeriod = grace;
+    purgeIntervalSeconds = std::max(1, intervalSeconds);
+    purger = std::thread(&Quarantine::purgeLoop, this);
+}
+
+void Quarantine::stopPurger()
+{
+    {
+        std::lock_guard<std::mutex> guard(purgerLock);
+        stopping = true;
+    }
+    purgerWakeup.notify_all();
+    {
+        std::lock_guard<std::mutex> guard(activeLock);
+        if (activeDeleter) activeDeleter->cancel();
+    }
+    if (purger.joinable()) purger.join();
+    stopping = false;
+}
+
+void Quarantine::purgeLoop()
+{
+    // The deleter's workers are created by this thread and inherit it
+    lowerThreadPriority();
+
+    std::unique_lock<std::mutex> guard(purgerLock);
+    while (!stopping) {
+        guard.unlock();
+        purge(unixNow() - gracePeriod);
+        guard.lock();
+        purgerWakeup.wait_for(guard, std::chrono::seconds(purgeIntervalSeconds), [this]() {
+            return stopping.load();
+        });
+    }
+}
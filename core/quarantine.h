@@ -0,0 +1,105 @@
+#ifndef QUARANTINE_H
+#define QUARANTINE_H
+
+#include "treedeleter.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class DirScanner;
+
+// Undoable cleanups. Instead of deleting, a run renames what a cleanup
+// would delete into a quarantine directory on the same file system: a
+// whole folder costs one rename per entry directly inside it, so the
+// cleanup finishes almost at once no matter how much it covers. The run
+// can be restored until a purger thread deletes it after a grace period.
+//
+// Renames cannot cross file systems, so every file system gets its own
+// store: the directory given to the constructor when the root lives on the
+// same one, otherwise a ".raptor-quarantine" directory at the top of the
+// root's file system. Roots without a usable store are left alone and
+// move() says so, the caller deletes them as usual. The run records are
+// kept in the constructor's directory.
+class Quarantine
+{
+public:
+    struct Totals
+    {
+        int64_t entries = 0;    // files and folders renamed
+        int64_t failures = 0;
+        int64_t conflicts = 0;  // restore only: the original name is taken again
+    };
+
+    struct Run
+    {
+        std::string id;
+        int64_t created = 0;                        // seconds since the epoch
+        std::vector<std::string> roots;
+        std::vector<std::string> stores;            // where each root's entries went
+    };
+
+    explicit Quarantine(const std::string &directory);
+    ~Quarantine();
+
+    // Starts collecting a new run; now is in seconds since the epoch
+    void begin(int64_t now);
+    // Without a filter, renames every entry directly inside root. With
+    // one, renames the files it accepts one by one below root and leaves
+    // the folders in place. Returns false when root has no store.
+    bool move(const std::string &root, const TreeDeleter::Filter &filter, Totals &totals);
+    // Records the run so restore() and the purger find it, returns its id
+    // or an empty string when nothing was moved
+    std::string commit();
+
+    void cancel();
+
+    // Recorded runs, oldest first
+    std::vector<Run> runs() const;
+    // Moves a run's entries back. Entries whose name was taken again in the
+    // meantime stay in quarantine and are purged with the rest later.
+    Totals restore(const std::string &id);
+
+    // Deletes the runs created before cutoff, returns how many. Stops
+    // early when stopPurger() is called meanwhile.
+    int purge(int64_t cutoff);
+    // Purges runs older than gracePeriod seconds every intervalSeconds, on
+    // a thread of its own with idle CPU and I/O priority
+    void startPurger(int64_t gracePeriod, int intervalSeconds = 3600);
+    void stopPurger();
+
+    // True for paths inside a store, which cleanups must leave alone
+    static bool isStorePath(const std::string &path);
+
+private:
+    bool loadRun(const std::string &filePath, Run &run) const;
+    std::string recordPath(const std::string &id) const;
+    std::string storeFor(const std::string &root) const;
+    void purgeLoop();
+
+    std::string directory;
+
+    // The run being collected
+    Run current;
+    std::atomic<bool> canceled;
+
+    std::mutex activeLock;
+    DirScanner *activeScanner;
+    TreeDeleter *activeDeleter;
+
+    // Serializes restore() and purge() on the recorded runs
+    mutable std::mutex runLock;
+
+    std::mutex purgerLock;
+    std::condition_variable purgerWakeup;
+    std::thread purger;
+    int64_t gracePeriod;
+    int purgeIntervalSeconds;
+    std::atomic<bool> stopping;
+};
+
+#endif // QUARANTINE_H
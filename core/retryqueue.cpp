@@ -0,0 +1,276 @@
+#include "retryqueue.h"
+
+#include <algorithm>
+#include <chrono>
+
+#ifdef __linux__
+#include <cerrno>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <filesystem>
+#include <system_error>
+#endif
+
+namespace {
+
+int64_t steadyNowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+RetryQueue::RetryQueue(int attempts, int firstDelay, int maxDelay)
+    : maxAttempts(std::max(1, attempts))
+    , firstDelayMs(std::max(1, firstDelay))
+    , maxDelayMs(std::max(firstDelay, maxDelay))
+    , running(0)
+    , canceled(false)
+    , stopping(false)
+    , queued(0)
+    , files(0)
+    , bytes(0)
+{
+}
+
+RetryQueue::~RetryQueue()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wakeup.notify_all();
+    if (thread.joinable()) thread.join();
+}
+
+// Orders the pending heap so the entry due first is at the front
+bool RetryQueue::dueLater(const Entry &a, const Entry &b)
+{
+    return a.dueMs > b.dueMs;
+}
+
+RetryQueue::Reason RetryQueue::classify(int error)
+{
+#ifdef _WIN32
+    // std::filesystem reports Win32 error codes here
+    switch (error) {
+    case 32:   // ERROR_SHARING_VIOLATION
+    case 33:   // ERROR_LOCK_VIOLATION
+    case 170:  // ERROR_BUSY
+        return Busy;
+    case 5:    // ERROR_ACCESS_DENIED, also returned while a delete is pending
+        return AccessDenied;
+    case 2:    // ERROR_FILE_NOT_FOUND
+    case 3:    // ERROR_PATH_NOT_FOUND
+        return Missing;
+    default:
+        return Other;
+    }
+#else
+    switch (error) {
+    case EBUSY:
+    case ETXTBSY:
+    case EAGAIN:
+    case EINTR:
+        return Busy;
+    case EACCES:
+    case EPERM:
+        return AccessDenied;
+    case ENOENT:
+        return Missing;
+    default:
+        return Other;
+    }
+#endif
+}
+
+const char *RetryQueue::describe(Reason reason)
+{
+    switch (reason) {
+    case Busy:
+        return "in use";
+    case AccessDenied:
+        return "access denied";
+    case Missing:
+        return "already gone";
+    default:
+        return "other error";
+    }
+}
+
+int RetryQueue::allowedAttempts(Reason reason) const
+{
+    switch (reason) {
+    case Busy:
+        return maxAttempts;
+    case AccessDenied:
+        return std::min(2, maxAttempts);
+    default:
+        return 1;
+    }
+}
+
+void RetryQueue::push(const std::string &path, int error)
+{
+    Failure failure;
+    failure.path = path;
+    failure.error = error;
+    failure.reason = classify(error);
+    failure.attempts = 1;
+    if (failure.reason == Missing) return;
+
+    std::lock_guard<std::mutex> guard(lock);
+    queued.fetch_add(1, std::memory_order_relaxed);
+    if (canceled || allowedAttempts(failure.reason) <= 1) {
+        given.push_back(failure);
+        return;
+    }
+
+    pending.push_back(Entry{failure, steadyNowMs() + firstDelayMs});
+    std::push_heap(pending.begin(), pending.end(), &RetryQueue::dueLater);
+
+    // Most cleanups never fail, so the thread only starts with the first retry
+    if (!thread.joinable()) thread = std::thread(&RetryQueue::run, this);
+    wakeup.notify_one();
+}
+
+void RetryQueue::run()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    while (!stopping) {
+        if (pending.empty()) {
+            drained.notify_all();
+            wakeup.wait(guard);
+            continue;
+        }
+
+        const int64_t wait = pending.front().dueMs - steadyNowMs();
+        if (wait > 0) {
+            wakeup.wait_for(guard, std::chrono::milliseconds(wait));
+            continue;
+        }
+
+        std::pop_heap(pending.begin(), pending.end(), &RetryQueue::dueLater);
+        Entry entry = std::move(pending.back());
+        pending.pop_back();
+        running++;
+
+        guard.unlock();
+        const bool done = attempt(entry.failure);
+        guard.lock();
+        running--;
+
+        if (done) continue;
+        if (canceled || entry.failure.attempts >= allowedAttempts(entry.failure.reason)) {
+            given.push_back(entry.failure);
+            continue;
+        }
+
+        // firstDelayMs, then twice as long after every failed attempt
+        const int shift = std::min(entry.failure.attempts - 1, 20);
+        entry.dueMs = steadyNowMs() + std::min<int64_t>(static_cast<int64_t>(firstDelayMs) << shift, maxDelayMs);
+        pending.push_back(std::move(entry));
+        std::push_heap(pending.begin(), pending.end(), &RetryQueue::dueLater);
+    }
+    drained.notify_all();
+}
+
+// Returns true once the entry is gone, otherwise updates the failure
+bool RetryQueue::attempt(Failure &failure)
+{
+    failure.attempts++;
+
+#ifdef __linux__
+    struct stat st;
+    if (lstat(failure.path.c_str(), &st) != 0) {
+        if (errno == ENOENT) return true;
+        failure.error = errno;
+        failure.reason = classify(errno);
+        return false;
+    }
+
+    const bool directory = S_ISDIR(st.st_mode);
+    if ((directory ? rmdir(failure.path.c_str()) : unlink(failure.path.c_str())) == 0) {
+        if (!directory) {
+            files.fetch_add(1, std::memory_order_relaxed);
+            bytes.fetch_add(st.st_size, std::memory_order_relaxed);
+        }
+        return true;
+    }
+    if (errno == ENOENT) return true;
+    failure.error = errno;
+#else
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    const fs::path path = fs::u8path(failure.path);
+
+    const fs::file_status status = fs::symlink_status(path, ec);
+    if (!fs::exists(status)) return true;
+
+    // Read-only files cannot be deleted on Windows
+    if (failure.reason == AccessDenied) {
+        fs::permissions(path, fs::perms::owner_write, fs::perm_options::add, ec);
+    }
+
+    const bool directory = fs::is_directory(status);
+    const uintmax_t size = fs::is_regular_file(status) ? fs::file_size(path, ec) : 0;
+    ec.clear();
+    if (fs::remove(path, ec)) {
+        if (!directory) {
+            files.fetch_add(1, std::memory_order_relaxed);
+            bytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed);
+        }
+        return true;
+    }
+    if (!ec || ec == std::errc::no_such_file_or_directory) return true;
+    failure.error = ec.value();
+#endif
+
+    failure.reason = classify(failure.error);
+    return failure.reason == Missing;
+}
+
+void RetryQueue::finish()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    drained.wait(guard, [this]() {
+        return pending.empty() && running == 0;
+    });
+}
+
+void RetryQueue::cancel()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        canceled = true;
+        for (const Entry &entry : pending) {
+            given.push_back(entry.failure);
+        }
+        pending.clear();
+    }
+    wakeup.notify_all();
+    drained.notify_all();
+}
+
+int64_t RetryQueue::entriesQueued() const
+{
+    return queued.load(std::memory_order_relaxed);
+}
+
+int64_t RetryQueue::filesRemoved() const
+{
+    return files.load(std::memory_order_relaxed);
+}
+
+int64_t RetryQueue::bytesRemoved() const
+{
+    return bytes.load(std::memory_order_relaxed);
+}
+
+std::vector<RetryQueue::Failure> RetryQueue::failures() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return given;
+}
@@ -0,0 +1,88 @@
+#ifndef RETRYQUEUE_H
+#define RETRYQUEUE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Deletions that failed and may succeed a little later, retried on a
+// thread of their own so the deleter never waits for a locked file. Every
+// failure is classified first: a busy file is retried with exponentially
+// growing delays up to a cap, a denied one once more (on Windows a virus
+// scanner or a pending delete often holds it only briefly, and the
+// read-only attribute is cleared before that attempt), anything else is
+// given up on at once. An entry that disappeared in the meantime counts as
+// done.
+//
+// push() may be called concurrently, typically from a TreeDeleter failure
+// callback; finish() waits for the retries still due and then failures()
+// tells what could not be removed and why.
+class RetryQueue
+{
+public:
+    enum Reason { Busy, AccessDenied, Missing, Other };
+
+    struct Failure
+    {
+        std::string path;
+        int error = 0;       // errno value of the last attempt
+        Reason reason = Other;
+        int attempts = 0;    // including the original one
+    };
+
+    explicit RetryQueue(int maxAttempts = 6, int firstDelayMs = 50, int maxDelayMs = 2000);
+    ~RetryQueue();
+
+    static Reason classify(int error);
+    static const char *describe(Reason reason);
+
+    void push(const std::string &path, int error);
+
+    // Blocks until every entry was removed or given up on
+    void finish();
+    // Gives up on whatever is still waiting, finish() returns right away
+    void cancel();
+
+    int64_t entriesQueued() const;
+    int64_t filesRemoved() const;
+    int64_t bytesRemoved() const;
+    // Valid after finish(), in the order the entries were given up on
+    std::vector<Failure> failures() const;
+
+private:
+    struct Entry
+    {
+        Failure failure;
+        int64_t dueMs;
+    };
+
+    static bool dueLater(const Entry &a, const Entry &b);
+
+    void run();
+    bool attempt(Failure &failure);
+    int allowedAttempts(Reason reason) const;
+
+    int maxAttempts;
+    int firstDelayMs;
+    int maxDelayMs;
+
+    std::thread thread;
+    mutable std::mutex lock;
+    std::condition_variable wakeup;
+    std::condition_variable drained;
+    std::vector<Entry> pending;    // min-heap on dueMs
+    std::vector<Failure> given;
+    int running;
+    bool canceled;
+    bool stopping;
+
+    std::atomic<int64_t> queued;
+    std::atomic<int64_t> files;
+    std::atomic<int64_t> bytes;
+};
+
+#endif // RETRYQUEUE_H
@@ -0,0 +1,265 @@
+#include "samplingscheduler.h"
+#include "trace.h"
+
+#include <algorithm>
+
+SamplingScheduler::SamplingScheduler(int threads)
+    : epoch(Clock::now())
+    , nextId(1)
+    , slots(WheelSize)
+    , cursor(0)
+    , stopping(false)
+{
+    wheelThread = std::thread(&SamplingScheduler::runWheel, this);
+    for (int i = 0; i < std::max(1, threads); ++i) {
+        workers.emplace_back(&SamplingScheduler::runWorker, this, i);
+    }
+}
+
+SamplingScheduler::~SamplingScheduler()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wheelCondition.notify_all();
+    readyCondition.notify_all();
+    wheelThread.join();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+SamplingScheduler &SamplingScheduler::shared()
+{
+    static SamplingScheduler scheduler;
+    return scheduler;
+}
+
+SamplingScheduler::Id SamplingScheduler::add(const char *name, int periodMs, int toleranceMs,
+                                             bool onlyWhenObserved, std::function<void()> collect)
+{
+    std::unique_ptr<Collector> collector(new Collector());
+    collector->name = name;
+    collector->periodTicks = periodMs > 0 ? std::max(1, (periodMs + TickMs - 1) / TickMs) : 0;
+    collector->toleranceTicks = std::min(std::max(0, toleranceMs) / TickMs, WheelSize - 1);
+    collector->onlyWhenObserved = onlyWhenObserved;
+    collector->collect = std::move(collect);
+
+    std::lock_guard<std::mutex> guard(lock);
+    const Id id = nextId++;
+    Collector &added = *collector;
+    collectors[id] = std::move(collector);
+    if (isActive(added)) schedule(id, added, currentTick());
+    return id;
+}
+
+void SamplingScheduler::remove(Id id)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    auto found = collectors.find(id);
+    if (found == collectors.end()) return;
+
+    Collector &collector = *found->second;
+    collector.removed = true;
+    unschedule(id, collector);
+    // A queued run is dropped by the worker that picks it up
+    finishedCondition.wait(guard, [&collector]() { return !collector.running; });
+    collectors.erase(id);
+}
+
+void SamplingScheduler::subscribe(Id id)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    auto found = collectors.find(id);
+    if (found == collectors.end()) return;
+
+    Collector &collector = *found->second;
+    collector.observers++;
+    if (!collector.scheduled && isActive(collector)) schedule(id, collector, currentTick());
+}
+
+void SamplingScheduler::unsubscribe(Id id)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    auto found = collectors.find(id);
+    if (found == collectors.end()) return;
+
+    Collector &collector = *found->second;
+    if (collector.observers > 0) collector.observers--;
+    if (!isActive(collector)) unschedule(id, collector);
+}
+
+void SamplingScheduler::trigger(Id id)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    auto found = collectors.find(id);
+    if (found == collectors.end() || found->second->removed) return;
+
+    Collector &collector = *found->second;
+    if (collector.running) {
+        collector.rerun = true;
+    } else {
+        enqueue(id, collector);
+    }
+}
+
+bool SamplingScheduler::isActive(const Collector &collector) const
+{
+    if (collector.removed || collector.periodTicks == 0) return false;
+    return !collector.onlyWhenObserved || collector.observers > 0;
+}
+
+int64_t SamplingScheduler::currentTick() const
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - epoch).count() / TickMs;
+}
+
+// Called with the lock held
+void SamplingScheduler::schedule(Id id, Collector &collector, int64_t dueTick)
+{
+    // The wheel has already fired everything up to the cursor
+    dueTick = std::max(dueTick, cursor + 1);
+
+    // The earliest wakeup already planned in the window, or else the end
+    // of the window, where later collectors can still join it
+    const int64_t lastTick = dueTick + collector.toleranceTicks;
+    int64_t slotTick = lastTick;
+    for (int64_t tick = dueTick; tick < lastTick && slotTick == lastTick; ++tick) {
+        for (const SlotEntry &entry : slots[tick % WheelSize]) {
+            if (entry.tick == tick) {
+                slotTick = tick;
+                break;
+            }
+        }
+    }
+
+    collector.scheduled = true;
+    collector.dueTick = dueTick;
+    collector.slotTick = slotTick;
+    slots[slotTick % WheelSize].push_back({id, slotTick});
+    wheelCondition.notify_one();
+}
+
+// Called with the lock held
+void SamplingScheduler::unschedule(Id id, Collector &collector)
+{
+    if (!collector.scheduled) return;
+
+    std::vector<SlotEntry> &slot = slots[collector.slotTick % WheelSize];
+    const int64_t slotTick = collector.slotTick;
+    slot.erase(std::remove_if(slot.begin(), slot.end(), [id, slotTick](const SlotEntry &entry) {
+        return entry.id == id && entry.tick == slotTick;
+    }), slot.end());
+    collector.scheduled = false;
+}
+
+// Called with the lock held
+void SamplingScheduler::enqueue(Id id, Collector &collector)
+{
+    if (collector.queued) return;
+    collector.queued = true;
+    ready.push_back(id);
+    readyCondition.notify_one();
+}
+
+// Called with the lock held; -1 when nothing is scheduled
+int64_t SamplingScheduler::nextWakeup() const
+{
+    int64_t later = -1;
+    for (int64_t tick = cursor + 1; tick <= cursor + WheelSize; ++tick) {
+        for (const SlotEntry &entry : slots[tick % WheelSize]) {
+            if (entry.tick == tick) return tick;
+            if (later < 0 || entry.tick < later) later = entry.tick;
+        }
+    }
+    return later;
+}
+
+// Called with the lock held
+void SamplingScheduler::fire(int64_t tick)
+{
+    std::vector<SlotEntry> &slot = slots[tick % WheelSize];
+    std::vector<Id> due;
+    for (auto entry = slot.begin(); entry != slot.end();) {
+        if (entry->tick == tick) {
+            due.push_back(entry->id);
+            entry = slot.erase(entry);
+        } else {
+            ++entry;
+        }
+    }
+
+    const int64_t now = currentTick();
+    for (Id id : due) {
+        Collector &collector = *collectors[id];
+        collector.scheduled = false;
+        // A run that is still going takes the place of this one
+        if (!collector.running) enqueue(id, collector);
+        // Counted from the window rather than the wakeup, so joining an
+        // earlier or later wakeup does not make the period drift. After a
+        // stall (a suspended machine) the missed runs are not made up.
+        schedule(id, collector, std::max(collector.dueTick + collector.periodTicks, now + 1));
+    }
+}
+
+void SamplingScheduler::runWheel()
+{
+    Trace::setThreadName("Sampling wheel");
+    std::unique_lock<std::mutex> guard(lock);
+    while (!stopping) {
+        const int64_t next = nextWakeup();
+        if (next < 0) {
+            // Every collector is suspended or manual; sleep until one is not
+            wheelCondition.wait(guard);
+            continue;
+        }
+
+        const int64_t now = currentTick();
+        if (next > now) {
+            // Woken early when a collector is scheduled, which may be sooner
+            wheelCondition.wait_until(guard, epoch + std::chrono::milliseconds(next * TickMs));
+            continue;
+        }
+
+        TraceSpan span("SamplingScheduler::fire");
+        for (int64_t tick = next; tick >= 0 && tick <= now; tick = nextWakeup()) {
+            cursor = tick;
+            fire(tick);
+        }
+        cursor = std::max(cursor, now);
+    }
+}
+
+void SamplingScheduler::runWorker(int index)
+{
+    Trace::setThreadName("Sampling worker " + std::to_string(index + 1));
+    std::unique_lock<std::mutex> guard(lock);
+    for (;;) {
+        readyCondition.wait(guard, [this]() { return stopping || !ready.empty(); });
+        if (stopping) return;
+
+        const Id id = ready.front();
+        ready.pop_front();
+        auto found = collectors.find(id);
+        if (found == collectors.end()) continue;
+
+        // remove() keeps the collector alive until running is cleared
+        Collector &collector = *found->second;
+        collector.queued = false;
+        if (collector.removed) continue;
+
+        collector.running = true;
+        do {
+            collector.rerun = false;
+            guard.unlock();
+            {
+                TraceSpan span(collector.name);
+                collector.collect();
+            }
+            guard.lock();
+        } while (collector.rerun && !collector.removed && !stopping);
+        collector.running = false;
+        finishedCondition.notify_all();
+    }
+}
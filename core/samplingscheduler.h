@@ -0,0 +1,121 @@
+#ifndef SAMPLINGSCHEDULER_H
+#define SAMPLINGSCHEDULER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Runs the periodic collectors of all pages and exporters from one timer
+// wheel and a small pool of worker threads, instead of a timer each.
+//
+// A collector has a period and a jitter tolerance: a run may start up to
+// tolerance later than due. When it is scheduled it joins a wakeup that
+// is already planned inside that window, and only otherwise gets one of
+// its own at the end of the window, so collectors with nearby periods
+// share their wakeups. Nothing ticks while no collector is due: with all
+// collectors suspended the scheduler thread sleeps until something
+// changes.
+//
+// Collectors added with onlyWhenObserved run only while somebody
+// subscribes to them, a page while it is shown or an exporter while it
+// is on. A collector never runs twice at once; a run that is still going
+// when the next one is due skips that one. Collectors run on the workers
+// and hand their results to the GUI thread themselves.
+class SamplingScheduler
+{
+public:
+    typedef int Id;
+
+    // Granularity of the wheel; periods and tolerances are rounded to it
+    static const int TickMs = 10;
+
+    explicit SamplingScheduler(int threads = 2);
+    ~SamplingScheduler();
+
+    // The scheduler all pages share
+    static SamplingScheduler &shared();
+
+    // name labels the collector's trace spans and must be a string
+    // literal. A period of 0 only runs the collector when triggered.
+    Id add(const char *name, int periodMs, int toleranceMs, bool onlyWhenObserved,
+           std::function<void()> collect);
+    // Waits for a run in progress, so the collector may use whatever it
+    // captured until then. Not to be called from the collector itself.
+    void remove(Id id);
+
+    // Subscriptions are counted; the first one schedules the collector to
+    // run within its tolerance
+    void subscribe(Id id);
+    void unsubscribe(Id id);
+    // Runs the collector as soon as a worker is free, observed or not.
+    // While it runs, it runs again once it is done.
+    void trigger(Id id);
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Collector
+    {
+        const char *name = nullptr;
+        int64_t periodTicks = 0;
+        int64_t toleranceTicks = 0;
+        bool onlyWhenObserved = false;
+        std::function<void()> collect;
+
+        int observers = 0;
+        bool scheduled = false;  // has an entry in the wheel
+        int64_t dueTick = 0;     // start of the window it is scheduled in
+        int64_t slotTick = 0;    // tick it fires at
+        bool queued = false;     // waiting for a worker
+        bool running = false;
+        bool rerun = false;      // triggered while running
+        bool removed = false;
+    };
+
+    struct SlotEntry
+    {
+        Id id;
+        int64_t tick;
+    };
+
+    // Ticks the wheel covers; later wakeups wait for the next round
+    static const int WheelSize = 512;
+
+    bool isActive(const Collector &collector) const;
+    int64_t currentTick() const;
+    void schedule(Id id, Collector &collector, int64_t dueTick);
+    void unschedule(Id id, Collector &collector);
+    void enqueue(Id id, Collector &collector);
+    int64_t nextWakeup() const;
+    void fire(int64_t tick);
+
+    void runWheel();
+    void runWorker(int index);
+
+    const Clock::time_point epoch;
+
+    std::mutex lock;
+    std::condition_variable wheelCondition;   // the wheel changed
+    std::condition_variable readyCondition;   // a collector was queued
+    std::condition_variable finishedCondition;  // a run ended
+
+    std::map<Id, std::unique_ptr<Collector>> collectors;
+    Id nextId;
+    std::vector<std::vector<SlotEntry>> slots;
+    int64_t cursor;  // last tick the wheel has fired
+    std::deque<Id> ready;
+    bool stopping;
+
+    std::thread wheelThread;
+    std::vector<std::thread> workers;
+};
+
+#endif // SAMPLINGSCHEDULER_H
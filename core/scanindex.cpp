@@ -0,0 +1,220 @@
+#include "scanindex.h"
+#include "binaryio.h"
+#include "pathutils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+
+namespace {
+
+const char IndexMagic[4] = {'R', 'P', 'I', 'X'};
+const uint32_t IndexVersion = 2;
+
+// A listing taken less than this long after the directory's last change
+// may have raced with that change, so it is not reused
+const int64_t RacyWindowNs = 2000000000LL;
+
+// Default for how long a listing is trusted without looking at its files
+const int DefaultMaxAgeSeconds = 24 * 60 * 60;
+
+int64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+ScanIndex::ScanIndex(const std::string &filePath)
+    : filePath(filePath)
+    , generation(1)
+    , maxAgeNs(DefaultMaxAgeSeconds * 1000000000LL)
+    , hitCount(0)
+    , missCount(0)
+{
+}
+
+ScanIndex::Shard &ScanIndex::shardFor(const std::string &path)
+{
+    return shards[std::hash<std::string>()(path) % ShardCount];
+}
+
+bool ScanIndex::load()
+{
+    clear();
+
+    std::vector<char> data;
+    if (!readWholeFile(filePath, data)) return false;
+
+    Reader reader(data);
+    char magic[4];
+    reader.raw(magic, sizeof(magic));
+    if (!reader.ok() || std::memcmp(magic, IndexMagic, sizeof(magic)) != 0) return false;
+    if (reader.u32() != IndexVersion) return false;
+
+    const uint64_t count = reader.u64();
+    for (uint64_t i = 0; i < count && reader.ok(); ++i) {
+        std::string path = reader.str();
+        Record record;
+        record.stamp.device = reader.u64();
+        record.stamp.inode = reader.u64();
+        record.stamp.mtimeNs = reader.i64();
+        record.listedAtNs = reader.i64();
+        record.bytes = reader.i64();
+        record.allocated = reader.i64();
+        record.files = reader.i64();
+        const uint32_t subdirCount = reader.u32();
+        for (uint32_t j = 0; j < subdirCount && reader.ok(); ++j) {
+            record.subdirs.push_back(reader.str());
+        }
+        if (!reader.ok()) break;
+
+        Shard &shard = shardFor(path);
+        shard.records.emplace(std::move(path), std::move(record));
+    }
+
+    if (!reader.ok()) {
+        // A truncated index is worth nothing, start over with a full scan
+        clear();
+        return false;
+    }
+    return true;
+}
+
+bool ScanIndex::save() const
+{
+    Writer writer;
+    writer.raw(IndexMagic, sizeof(IndexMagic));
+    writer.u32(IndexVersion);
+    writer.u64(size());
+
+    for (const Shard &shard : shards) {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        for (const auto &item : shard.records) {
+            const Record &record = item.second;
+            writer.str(item.first);
+            writer.u64(record.stamp.device);
+            writer.u64(record.stamp.inode);
+            writer.i64(record.stamp.mtimeNs);
+            writer.i64(record.listedAtNs);
+            writer.i64(record.bytes);
+            writer.i64(record.allocated);
+            writer.i64(record.files);
+            writer.u32(static_cast<uint32_t>(record.subdirs.size()));
+            for (const std::string &name : record.subdirs) {
+                writer.str(name);
+            }
+        }
+    }
+
+    return writeFileAtomically(filePath, writer.buffer);
+}
+
+void ScanIndex::clear()
+{
+    for (Shard &shard : shards) {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        shard.records.clear();
+    }
+}
+
+void ScanIndex::setMaxAge(int seconds)
+{
+    maxAgeNs = std::max(0, seconds) * 1000000000LL;
+}
+
+void ScanIndex::prune(const std::vector<std::string> &roots)
+{
+    for (Shard &shard : shards) {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        for (auto it = shard.records.begin(); it != shard.records.end();) {
+            bool stale = false;
+            if (it->second.generation != generation) {
+                for (const std::string &root : roots) {
+                    if (isPathUnder(it->first, root)) {
+                        stale = true;
+                        break;
+                    }
+                }
+            }
+            it = stale ? shard.records.erase(it) : std::next(it);
+        }
+    }
+}
+
+bool ScanIndex::lookup(const std::string &path, const DirStamp &stamp,
+                       ScanTotals &own, std::vector<std::string> &subdirs)
+{
+    Shard &shard = shardFor(path);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    auto it = shard.records.find(path);
+    if (it == shard.records.end()) {
+        missCount++;
+        return false;
+    }
+
+    Record &record = it->second;
+    record.generation = generation;
+    if (record.stamp.device != stamp.device || record.stamp.inode != stamp.inode
+        || record.stamp.mtimeNs != stamp.mtimeNs
+        || record.listedAtNs - record.stamp.mtimeNs < RacyWindowNs
+        || (maxAgeNs > 0 && nowNs() - record.listedAtNs > maxAgeNs)) {
+        missCount++;
+        return false;
+    }
+
+    own.bytes = record.bytes;
+    own.allocated = record.allocated;
+    own.files = record.files;
+    own.errors = 0;
+    subdirs = record.subdirs;
+    hitCount++;
+    return true;
+}
+
+void ScanIndex::store(const std::string &path, const DirStamp &stamp,
+                      const ScanTotals &own, const std::vector<std::string> &subdirs)
+{
+    Record record;
+    record.stamp = stamp;
+    record.listedAtNs = nowNs();
+    record.bytes = own.bytes;
+    record.allocated = own.allocated;
+    record.files = own.files;
+    record.subdirs = subdirs;
+    record.generation = generation;
+
+    Shard &shard = shardFor(path);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    shard.records[path] = std::move(record);
+}
+
+void ScanIndex::resetStatistics()
+{
+    generation++;
+    hitCount = 0;
+    missCount = 0;
+}
+
+int64_t ScanIndex::hits() const
+{
+    return hitCount;
+}
+
+int64_t ScanIndex::misses() const
+{
+    return missCount;
+}
+
+size_t ScanIndex::size() const
+{
+    size_t total = 0;
+    for (const Shard &shard : shards) {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        total += shard.records.size();
+    }
+    return total;
+}
@@ -0,0 +1,80 @@
+#ifndef SCANINDEX_H
+#define SCANINDEX_H
+
+#include "dirscanner.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// On-disk index of directory listings used to make rescans incremental.
+// Each directory is keyed by path and stamped with device, inode and
+// mtime. A directory whose stamp is unchanged is not read again; its file
+// totals and subdirectory names come from the index and only the
+// subdirectories themselves are revisited.
+//
+// Directory mtime only changes when entries are added, removed or renamed,
+// not when a file grows in place, so an entry is also listed again once it
+// is older than the maximum age. Directories modified just before they
+// were listed are never trusted, which avoids missing changes within
+// mtime granularity.
+class ScanIndex : public ScanCache
+{
+public:
+    explicit ScanIndex(const std::string &filePath);
+
+    bool load();
+    bool save() const;
+    void clear();
+
+    // Entries listed longer ago than this are listed again, so that files
+    // growing in place are seen within that time. 0 keeps them forever.
+    void setMaxAge(int seconds);
+
+    // Drops entries below the given roots that were not seen since the
+    // last resetStatistics(), i.e. directories that no longer exist
+    void prune(const std::vector<std::string> &roots);
+
+    bool lookup(const std::string &path, const DirStamp &stamp,
+                ScanTotals &own, std::vector<std::string> &subdirs) override;
+    void store(const std::string &path, const DirStamp &stamp,
+               const ScanTotals &own, const std::vector<std::string> &subdirs) override;
+
+    void resetStatistics();
+    int64_t hits() const;
+    int64_t misses() const;
+    size_t size() const;
+
+private:
+    struct Record
+    {
+        DirStamp stamp;
+        int64_t listedAtNs = 0;
+        int64_t bytes = 0;
+        int64_t allocated = 0;
+        int64_t files = 0;
+        std::vector<std::string> subdirs;
+        uint32_t generation = 0;
+    };
+
+    struct Shard
+    {
+        mutable std::mutex lock;
+        std::unordered_map<std::string, Record> records;
+    };
+
+    static const int ShardCount = 64;
+
+    Shard &shardFor(const std::string &path);
+
+    std::string filePath;
+    Shard shards[ShardCount];
+    uint32_t generation;
+    int64_t maxAgeNs;
+    std::atomic<int64_t> hitCount;
+    std::atomic<int64_t> missCount;
+};
+
+#endif // SCANINDEX_H
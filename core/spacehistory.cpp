@@ -0,0 +1,227 @@
+#include "spacehistory.h"
+#include "binaryio.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const char HistoryMagic[4] = {'R', 'P', 'S', 'H'};
+const uint32_t HistoryVersion = 1;
+
+// A fit needs this many samples spread over at least MinimumSpan
+const size_t MinimumSamples = 6;
+const int64_t MinimumSpan = 3 * 60 * 60;
+const int64_t FineWindow = 24 * 60 * 60;
+const int64_t CoarseWindow = 7 * 24 * 60 * 60;
+// Pairs grow with the square of the samples; more than this adds nothing
+const size_t MaximumFitSamples = 120;
+
+void writeSamples(Writer &writer, const std::deque<SpaceHistory::Sample> &samples)
+{
+    writer.varint(samples.size());
+    SpaceHistory::Sample previous;
+    for (const SpaceHistory::Sample &sample : samples) {
+        writer.svarint(sample.time - previous.time);
+        writer.svarint(sample.freeBytes - previous.freeBytes);
+        previous = sample;
+    }
+}
+
+void readSamples(Reader &reader, std::deque<SpaceHistory::Sample> &samples)
+{
+    const uint64_t count = reader.varint();
+    SpaceHistory::Sample sample;
+    for (uint64_t i = 0; i < count && reader.ok(); ++i) {
+        sample.time += reader.svarint();
+        sample.freeBytes += reader.svarint();
+        samples.push_back(sample);
+    }
+}
+
+// Adds or updates the last sample, keeping samples interval apart and no
+// older than span
+bool addSample(std::deque<SpaceHistory::Sample> &samples, const SpaceHistory::Sample &sample,
+               int64_t interval, int64_t span)
+{
+    bool added = false;
+    if (!samples.empty() && sample.time - samples.back().time < interval) {
+        samples.back().freeBytes = sample.freeBytes;
+    } else {
+        samples.push_back(sample);
+        added = true;
+    }
+    while (!samples.empty() && samples.front().time < sample.time - span) {
+        samples.pop_front();
+    }
+    return added;
+}
+
+std::vector<SpaceHistory::Sample> recent(const std::deque<SpaceHistory::Sample> &samples, int64_t since)
+{
+    std::vector<SpaceHistory::Sample> selected;
+    for (const SpaceHistory::Sample &sample : samples) {
+        if (sample.time >= since) selected.push_back(sample);
+    }
+    return selected;
+}
+
+bool enoughForFit(const std::vector<SpaceHistory::Sample> &samples)
+{
+    return samples.size() >= MinimumSamples && samples.back().time - samples.front().time >= MinimumSpan;
+}
+
+double median(std::vector<double> &values)
+{
+    const size_t middle = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(middle), values.end());
+    return values[middle];
+}
+
+} // namespace
+
+SpaceHistory::SpaceHistory(const std::string &filePath)
+    : filePath(filePath)
+{
+}
+
+bool SpaceHistory::load()
+{
+    histories.clear();
+
+    std::vector<char> data;
+    if (!readWholeFile(filePath, data)) return false;
+
+    Reader reader(data);
+    char magic[4];
+    reader.raw(magic, sizeof(magic));
+    if (!reader.ok() || std::memcmp(magic, HistoryMagic, sizeof(magic)) != 0) return false;
+    if (reader.u32() != HistoryVersion) return false;
+
+    const uint32_t count = reader.u32();
+    for (uint32_t i = 0; i < count && reader.ok(); ++i) {
+        const std::string name = reader.str();
+        Volume &volume = histories[name];
+        volume.totalBytes = reader.i64();
+        readSamples(reader, volume.fine);
+        readSamples(reader, volume.coarse);
+    }
+
+    if (!reader.ok()) {
+        histories.clear();
+        return false;
+    }
+    return true;
+}
+
+bool SpaceHistory::save() const
+{
+    Writer writer;
+    writer.raw(HistoryMagic, sizeof(HistoryMagic));
+    writer.u32(HistoryVersion);
+    writer.u32(static_cast<uint32_t>(histories.size()));
+    for (const auto &item : histories) {
+        writer.str(item.first);
+        writer.i64(item.second.totalBytes);
+        writeSamples(writer, item.second.fine);
+        writeSamples(writer, item.second.coarse);
+    }
+    return writeFileAtomically(filePath, writer.buffer);
+}
+
+bool SpaceHistory::add(const std::string &name, int64_t time, int64_t freeBytes, int64_t totalBytes)
+{
+    Volume &volume = histories[name];
+    // A clock set back would leave samples out of order and a resized
+    // volume makes them meaningless, start over either way
+    if ((!volume.fine.empty() && time < volume.fine.back().time)
+        || (volume.totalBytes != 0 && volume.totalBytes != totalBytes)) {
+        volume.fine.clear();
+        volume.coarse.clear();
+    }
+    volume.totalBytes = totalBytes;
+
+    Sample sample;
+    sample.time = time;
+    sample.freeBytes = freeBytes;
+    const bool added = addSample(volume.fine, sample, FineInterval, FineSpan);
+    addSample(volume.coarse, sample, CoarseInterval, CoarseSpan);
+    return added;
+}
+
+SpaceHistory::Forecast SpaceHistory::forecast(const std::string &name, int64_t now) const
+{
+    Forecast forecast;
+    auto found = histories.find(name);
+    if (found == histories.end() || found->second.fine.empty()) return forecast;
+    const Volume &volume = found->second;
+    forecast.totalBytes = volume.totalBytes;
+    forecast.freeBytes = volume.fine.back().freeBytes;
+
+    std::vector<Sample> samples = recent(volume.fine, now - FineWindow);
+    if (!enoughForFit(samples)) {
+        samples = recent(volume.coarse, now - CoarseWindow);
+        if (!enoughForFit(samples)) return forecast;
+    }
+
+    // Every n-th sample, always keeping the newest
+    if (samples.size() > MaximumFitSamples) {
+        std::vector<Sample> thinned;
+        const size_t step = (samples.size() + MaximumFitSamples - 1) / MaximumFitSamples;
+        for (size_t i = (samples.size() - 1) % step; i < samples.size(); i += step) {
+            thinned.push_back(samples[i]);
+        }
+        samples.swap(thinned);
+    }
+
+    std::vector<double> slopes;
+    slopes.reserve(samples.size() * (samples.size() - 1) / 2);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        for (size_t j = i + 1; j < samples.size(); ++j) {
+            const int64_t seconds = samples[j].time - samples[i].time;
+            if (seconds <= 0) continue;
+            slopes.push_back(static_cast<double>(samples[j].freeBytes - samples[i].freeBytes) / seconds);
+        }
+    }
+    if (slopes.empty()) return forecast;
+    const double slope = median(slopes);
+
+    // Free space now on the fitted line
+    std::vector<double> atNow;
+    atNow.reserve(samples.size());
+    for (const Sample &sample : samples) {
+        atNow.push_back(static_cast<double>(sample.freeBytes) + slope * static_cast<double>(now - sample.time));
+    }
+    const double freeNow = std::max(0.0, median(atNow));
+
+    forecast.freeBytes = static_cast<int64_t>(freeNow);
+    forecast.bytesPerDay = slope * 24 * 60 * 60;
+    forecast.samples = static_cast<int>(samples.size());
+    if (slope < 0) forecast.secondsToFull = static_cast<int64_t>(freeNow / -slope);
+    return forecast;
+}
+
+std::vector<std::string> SpaceHistory::volumes() const
+{
+    std::vector<std::string> names;
+    for (const auto &item : histories) {
+        names.push_back(item.first);
+    }
+    return names;
+}
+
+std::vector<SpaceHistory::Sample> SpaceHistory::samples(const std::string &name) const
+{
+    std::vector<Sample> all;
+    auto found = histories.find(name);
+    if (found == histories.end()) return all;
+
+    // Hourly samples up to where the fine ones begin
+    const Volume &volume = found->second;
+    const int64_t fineStart = volume.fine.empty() ? INT64_MAX : volume.fine.front().time;
+    for (const Sample &sample : volume.coarse) {
+        if (sample.time < fineStart) all.push_back(sample);
+    }
+    all.insert(all.end(), volume.fine.begin(), volume.fine.end());
+    return all;
+}
@@ -0,0 +1,71 @@
+#ifndef SPACEHISTORY_H
+#define SPACEHISTORY_H
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+// Free space of every volume over time, kept on disk so the trend survives
+// restarts. Each volume holds a sample every few minutes for the last two
+// days and one per hour for the last month, a few thousand samples in all,
+// stored as varint deltas.
+//
+// forecast() fits a line through the recent samples with the Theil-Sen
+// estimator, the median of the slopes between all pairs of samples. A
+// cleanup or a large download shows up as a single step that barely moves
+// the median, so the forecast follows the steady growth instead.
+class SpaceHistory
+{
+public:
+    struct Sample
+    {
+        int64_t time = 0;       // seconds since the epoch
+        int64_t freeBytes = 0;
+    };
+
+    struct Forecast
+    {
+        int64_t freeBytes = -1;       // at the time of the forecast, from the fit
+        int64_t totalBytes = 0;
+        double bytesPerDay = 0;       // negative while the volume fills up
+        int64_t secondsToFull = -1;   // -1 when free space is not shrinking
+        int samples = 0;              // used for the fit, 0 when there are too few
+    };
+
+    static const int64_t FineInterval = 5 * 60;
+    static const int64_t FineSpan = 2 * 24 * 60 * 60;
+    static const int64_t CoarseInterval = 60 * 60;
+    static const int64_t CoarseSpan = 30 * 24 * 60 * 60;
+
+    explicit SpaceHistory(const std::string &filePath);
+
+    bool load();
+    bool save() const;
+
+    // Records a reading. Readings closer together than FineInterval update
+    // the last sample instead of adding one. Returns true when a sample was
+    // added, which is when saving is worth it.
+    bool add(const std::string &volume, int64_t time, int64_t freeBytes, int64_t totalBytes);
+
+    // Trend of the last day, or of the last week while the fine samples
+    // cover less than a few hours
+    Forecast forecast(const std::string &volume, int64_t now) const;
+
+    std::vector<std::string> volumes() const;
+    std::vector<Sample> samples(const std::string &volume) const;
+
+private:
+    struct Volume
+    {
+        int64_t totalBytes = 0;
+        std::deque<Sample> fine;
+        std::deque<Sample> coarse;
+    };
+
+    std::string filePath;
+    std::map<std::string, Volume> histories;
+};
+
+#endif // SPACEHISTORY_H
@@ -0,0 +1,187 @@
+#ifndef TOPK_H
+#define TOPK_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Keeps the `capacity` heaviest items of a stream. Items need an int64_t
+// `weight` member. Memory never grows past capacity, and once the heap is
+// full floor() tells callers which items are not worth building at all.
+template <typename T>
+class TopK
+{
+public:
+    explicit TopK(size_t capacity = 0) : limit(capacity) {}
+
+    void setCapacity(size_t capacity)
+    {
+        limit = capacity;
+        heap.clear();
+    }
+
+    // Weight an item must exceed to be kept, -1 while there is room
+    int64_t floor() const
+    {
+        return heap.size() < limit ? -1 : heap.front().weight;
+    }
+
+    bool accepts(int64_t weight) const
+    {
+        return limit > 0 && weight > floor();
+    }
+
+    void push(T item)
+    {
+        if (!accepts(item.weight)) return;
+        if (heap.size() == limit) {
+            std::pop_heap(heap.begin(), heap.end(), lighter);
+            heap.back() = std::move(item);
+        } else {
+            heap.push_back(std::move(item));
+        }
+        std::push_heap(heap.begin(), heap.end(), lighter);
+    }
+
+    void clear() { heap.clear(); }
+    size_t size() const { return heap.size(); }
+
+    // Heaviest first
+    std::vector<T> sorted() const
+    {
+        std::vector<T> items = heap;
+        std::sort(items.begin(), items.end(), [](const T &a, const T &b) { return a.weight > b.weight; });
+        return items;
+    }
+
+private:
+    static bool lighter(const T &a, const T &b)
+    {
+        // std heaps are max-heaps, so invert to keep the lightest on top
+        return a.weight > b.weight;
+    }
+
+    size_t limit;
+    std::vector<T> heap;
+};
+
+// Weighted Space-Saving: totals per key for a stream with any number of
+// distinct keys, using `capacity` counters. While there are no more keys
+// than counters the totals are exact. After that the lightest counter is
+// handed to each new key, which inherits its weight as `error`, so a
+// reported total overestimates the real one by at most error, and every
+// key heavier than total weight / capacity is guaranteed to be present.
+template <typename Key, typename Hash = std::hash<Key>>
+class HeavyHitters
+{
+public:
+    struct Counter
+    {
+        Key key;
+        int64_t weight = 0;
+        int64_t count = 0;
+        int64_t error = 0;
+    };
+
+    explicit HeavyHitters(size_t capacity = 0) : limit(capacity) {}
+
+    void setCapacity(size_t capacity)
+    {
+        limit = capacity;
+        clear();
+    }
+
+    void add(const Key &key, int64_t weight)
+    {
+        if (limit == 0) return;
+
+        auto found = positions.find(key);
+        if (found != positions.end()) {
+            Counter &counter = heap[found->second];
+            counter.weight += weight;
+            counter.count++;
+            siftDown(found->second);
+            return;
+        }
+
+        if (heap.size() < limit) {
+            Counter counter;
+            counter.key = key;
+            counter.weight = weight;
+            counter.count = 1;
+            heap.push_back(counter);
+            positions[key] = heap.size() - 1;
+            siftUp(heap.size() - 1);
+            return;
+        }
+
+        // Evict the lightest key and let the new one start from its weight
+        Counter &lightest = heap.front();
+        positions.erase(lightest.key);
+        lightest.error = lightest.weight;
+        lightest.key = key;
+        lightest.weight += weight;
+        lightest.count++;
+        positions[key] = 0;
+        siftDown(0);
+    }
+
+    void clear()
+    {
+        heap.clear();
+        positions.clear();
+    }
+
+    size_t size() const { return heap.size(); }
+
+    // Heaviest first
+    std::vector<Counter> sorted() const
+    {
+        std::vector<Counter> counters = heap;
+        std::sort(counters.begin(), counters.end(),
+                  [](const Counter &a, const Counter &b) { return a.weight > b.weight; });
+        return counters;
+    }
+
+private:
+    void swapAt(size_t a, size_t b)
+    {
+        std::swap(heap[a], heap[b]);
+        positions[heap[a].key] = a;
+        positions[heap[b].key] = b;
+    }
+
+    void siftUp(size_t index)
+    {
+        while (index > 0) {
+            const size_t parent = (index - 1) / 2;
+            if (heap[parent].weight <= heap[index].weight) break;
+            swapAt(parent, index);
+            index = parent;
+        }
+    }
+
+    void siftDown(size_t index)
+    {
+        for (;;) {
+            const size_t left = index * 2 + 1;
+            const size_t right = left + 1;
+            size_t smallest = index;
+            if (left < heap.size() && heap[left].weight < heap[smallest].weight) smallest = left;
+            if (right < heap.size() && heap[right].weight < heap[smallest].weight) smallest = right;
+            if (smallest == index) break;
+            swapAt(index, smallest);
+            index = smallest;
+        }
+    }
+
+    size_t limit;
+    std::vector<Counter> heap;  // min-heap on weight
+    std::unordered_map<Key, size_t, Hash> positions;
+};
+
+#endif // TOPK_H
@@ -0,0 +1,229 @@
+#include "trace.h"
+#include "binaryio.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+std::atomic<bool> Trace::enabledFlag(false);
+
+namespace {
+
+const size_t ChunkSpans = 4096;
+// About 20 MB per thread before spans are dropped
+const size_t MaxChunks = 64;
+const size_t DetailLength = 63;
+
+struct Span
+{
+    const char *name;
+    uint64_t startNs;
+    uint64_t durationNs;
+    char detail[DetailLength + 1];
+};
+
+struct Chunk
+{
+    Span spans[ChunkSpans];
+};
+
+// Written by its thread only. The exporter reads the spans below count,
+// and only while recording is paused and no write is in progress.
+struct ThreadBuffer
+{
+    int id = 0;
+    std::string name;
+    std::atomic<bool> writing{false};
+    std::atomic<size_t> count{0};
+    std::atomic<int64_t> dropped{0};
+    std::vector<std::unique_ptr<Chunk>> chunks;
+};
+
+std::mutex registryLock;
+std::vector<std::unique_ptr<ThreadBuffer>> &registry()
+{
+    // Buffers outlive their threads so their spans can still be exported
+    static std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    return buffers;
+}
+
+ThreadBuffer &threadBuffer()
+{
+    thread_local ThreadBuffer *buffer = nullptr;
+    if (!buffer) {
+        std::lock_guard<std::mutex> guard(registryLock);
+        registry().push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer()));
+        buffer = registry().back().get();
+        buffer->id = static_cast<int>(registry().size());
+    }
+    return *buffer;
+}
+
+// Waits until no thread is in the middle of recording a span; called
+// after recording was switched off, so none can start one either
+void waitForWriters()
+{
+    std::lock_guard<std::mutex> guard(registryLock);
+    for (const std::unique_ptr<ThreadBuffer> &buffer : registry()) {
+        while (buffer->writing.load()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void appendJsonString(std::string &out, const char *text)
+{
+    out += '"';
+    for (const char *c = text; *c; ++c) {
+        const unsigned char ch = static_cast<unsigned char>(*c);
+        if (ch == '"' || ch == '\\') {
+            out += '\\';
+            out += *c;
+        } else if (ch < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", ch);
+            out += escaped;
+        } else {
+            out += *c;
+        }
+    }
+    out += '"';
+}
+
+void appendMicroseconds(std::string &out, uint64_t ns)
+{
+    char text[32];
+    std::snprintf(text, sizeof(text), "%llu.%03llu",
+                  static_cast<unsigned long long>(ns / 1000), static_cast<unsigned long long>(ns % 1000));
+    out += text;
+}
+
+} // namespace
+
+void Trace::start()
+{
+    enabledFlag = true;
+}
+
+void Trace::stop()
+{
+    enabledFlag = false;
+    waitForWriters();
+}
+
+void Trace::clear()
+{
+    std::lock_guard<std::mutex> guard(registryLock);
+    for (const std::unique_ptr<ThreadBuffer> &buffer : registry()) {
+        buffer->count = 0;
+        buffer->dropped = 0;
+    }
+}
+
+void Trace::setThreadName(const std::string &name)
+{
+    ThreadBuffer &buffer = threadBuffer();
+    std::lock_guard<std::mutex> guard(registryLock);
+    buffer.name = name;
+}
+
+uint64_t Trace::nowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Trace::record(const char *name, uint64_t startNs, const std::string &detail)
+{
+    const uint64_t endNs = nowNs();
+    ThreadBuffer &buffer = threadBuffer();
+
+    // Announce the write before checking the flag, stop() does the reverse
+    buffer.writing.store(true);
+    if (!enabledFlag.load()) {
+        buffer.writing.store(false);
+        return;
+    }
+
+    const size_t index = buffer.count.load(std::memory_order_relaxed);
+    if (index / ChunkSpans >= MaxChunks) {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        buffer.writing.store(false, std::memory_order_release);
+        return;
+    }
+    if (index / ChunkSpans >= buffer.chunks.size()) {
+        buffer.chunks.push_back(std::unique_ptr<Chunk>(new Chunk));
+    }
+
+    Span &span = buffer.chunks[index / ChunkSpans]->spans[index % ChunkSpans];
+    span.name = name;
+    span.startNs = startNs;
+    span.durationNs = endNs - startNs;
+    const size_t length = std::min(detail.size(), DetailLength);
+    detail.copy(span.detail, length);
+    span.detail[length] = '\0';
+
+    buffer.count.store(index + 1, std::memory_order_release);
+    buffer.writing.store(false, std::memory_order_release);
+}
+
+int64_t Trace::droppedSpans()
+{
+    std::lock_guard<std::mutex> guard(registryLock);
+    int64_t dropped = 0;
+    for (const std::unique_ptr<ThreadBuffer> &buffer : registry()) {
+        dropped += buffer->dropped;
+    }
+    return dropped;
+}
+
+bool Trace::writeChromeJson(const std::string &filePath)
+{
+    const bool wasEnabled = isEnabled();
+    stop();
+
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    {
+        std::lock_guard<std::mutex> guard(registryLock);
+        for (const std::unique_ptr<ThreadBuffer> &buffer : registry()) {
+            const size_t count = buffer->count.load(std::memory_order_acquire);
+            if (count == 0) continue;
+            const std::string tid = std::to_string(buffer->id);
+
+            if (!buffer->name.empty()) {
+                out += first ? "" : ",";
+                first = false;
+                out += "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" + tid + ",\"args\":{\"name\":";
+                appendJsonString(out, buffer->name.c_str());
+                out += "}}";
+            }
+
+            for (size_t i = 0; i < count; ++i) {
+                const Span &span = buffer->chunks[i / ChunkSpans]->spans[i % ChunkSpans];
+                out += first ? "" : ",";
+                first = false;
+                out += "{\"ph\":\"X\",\"cat\":\"raptor\",\"pid\":1,\"tid\":" + tid + ",\"name\":";
+                appendJsonString(out, span.name);
+                out += ",\"ts\":";
+                appendMicroseconds(out, span.startNs);
+                out += ",\"dur\":";
+                appendMicroseconds(out, span.durationNs);
+                if (span.detail[0]) {
+                    out += ",\"args\":{\"detail\":";
+                    appendJsonString(out, span.detail);
+                    out += "}";
+                }
+                out += "}";
+            }
+        }
+    }
+    out += "]}\n";
+
+    if (wasEnabled) start();
+    return writeFileAtomically(filePath, std::vector<char>(out.begin(), out.end()));
+}
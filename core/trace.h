@@ -0,0 +1,66 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Scoped timing spans, exported as Chrome trace-event JSON for
+// chrome://tracing or Perfetto. Every thread records into a buffer of its
+// own, so recording takes no locks; while tracing is off a span costs one
+// relaxed load.
+//
+// Span names must be string literals (or otherwise outlive the trace).
+// writeChromeJson() pauses recording while it reads the buffers.
+class Trace
+{
+public:
+    static bool isEnabled() { return enabledFlag.load(std::memory_order_relaxed); }
+
+    static void start();
+    static void stop();
+    // Drops what was recorded so far; tracing must be stopped
+    static void clear();
+
+    // Shown for the calling thread in the trace viewer
+    static void setThreadName(const std::string &name);
+
+    static bool writeChromeJson(const std::string &filePath);
+    // Spans lost because a thread's buffer was full
+    static int64_t droppedSpans();
+
+    static uint64_t nowNs();
+    static void record(const char *name, uint64_t startNs, const std::string &detail);
+
+    static std::atomic<bool> enabledFlag;
+};
+
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char *name)
+        : spanName(Trace::isEnabled() ? name : nullptr)
+        , startNs(spanName ? Trace::nowNs() : 0)
+    {
+    }
+
+    ~TraceSpan()
+    {
+        if (spanName) Trace::record(spanName, startNs, spanDetail);
+    }
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+    // Check before building a detail string, so a disabled span stays free
+    bool isActive() const { return spanName != nullptr; }
+    // Shown as the span's argument, e.g. the command a span ran
+    void setDetail(const std::string &detail) { spanDetail = detail; }
+
+private:
+    const char *spanName;
+    uint64_t startNs;
+    std::string spanDetail;
+};
+
+#endif // TRACE_H
@@ -0,0 +1,904 @@
+#include "treedeleter.h"
+#include "deletionplan.h"
+#include "iothrottle.h"
+#include "pathutils.h"
+#include "workqueue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#else
+#include <filesystem>
+#include <system_error>
+#endif
+
+// IORING_OP_UNLINKAT arrived together with IORING_ENTER_EXT_ARG in 5.11,
+// older headers do not know the opcode at all
+#if defined(__linux__) && defined(IORING_ENTER_EXT_ARG) && defined(__NR_io_uring_setup)
+#define TREEDELETER_IO_URING 1
+#endif
+
+namespace {
+
+#ifdef __linux__
+// Layout of the records returned by getdents64
+struct LinuxDirent64
+{
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+const size_t DirentBufferSize = 64 * 1024;
+#endif
+
+#ifdef TREEDELETER_IO_URING
+const unsigned RingEntries = 256;
+
+// Just enough io_uring to batch unlinkat calls. Requests are queued with
+// the name pointing into the caller's getdents buffer, so the caller must
+// drain() before it reuses the buffer or closes the directory.
+class UnlinkRing
+{
+public:
+    UnlinkRing()
+        : ringFd(-1)
+        , entries(0)
+        , queued(0)
+        , sqMap(nullptr)
+        , cqMap(nullptr)
+        , sqMapSize(0)
+        , cqMapSize(0)
+        , sqes(nullptr)
+    {
+    }
+
+    ~UnlinkRing()
+    {
+        shutdown();
+    }
+
+    bool open(unsigned size)
+    {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ringFd = static_cast<int>(syscall(__NR_io_uring_setup, size, &params));
+        if (ringFd < 0) return false;
+
+        entries = params.sq_entries;
+        sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (singleMap) {
+            sqMapSize = cqMapSize = std::max(sqMapSize, cqMapSize);
+        }
+
+        sqMap = mmap(nullptr, sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+        if (sqMap == MAP_FAILED) {
+            sqMap = nullptr;
+            shutdown();
+            return false;
+        }
+        if (singleMap) {
+            cqMap = sqMap;
+        } else {
+            cqMap = mmap(nullptr, cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+            if (cqMap == MAP_FAILED) {
+                cqMap = nullptr;
+                shutdown();
+                return false;
+            }
+        }
+        void *sqeMap = mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+        if (sqeMap == MAP_FAILED) {
+            shutdown();
+            return false;
+        }
+        sqes = static_cast<io_uring_sqe *>(sqeMap);
+
+        char *sq = static_cast<char *>(sqMap);
+        sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+        sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        sqMask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+        char *cq = static_cast<char *>(cqMap);
+        cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        cqMask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    // True when the running kernel implements IORING_OP_UNLINKAT
+    bool supportsUnlink() const
+    {
+        const size_t size = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+        std::unique_ptr<char[]> storage(new char[size]());
+        io_uring_probe *probe = reinterpret_cast<io_uring_probe *>(storage.get());
+        if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PROBE, probe, 256) < 0) return false;
+        return probe->last_op >= IORING_OP_UNLINKAT
+            && (probe->ops[IORING_OP_UNLINKAT].flags & IO_URING_OP_SUPPORTED);
+    }
+
+    bool isOpen() const
+    {
+        return ringFd >= 0;
+    }
+
+    bool isFull() const
+    {
+        return queued >= entries;
+    }
+
+    void queue(int dirFd, const char *name, uint64_t userData)
+    {
+        const unsigned tail = *sqTail;
+        const unsigned index = tail & sqMask;
+        io_uring_sqe *sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_UNLINKAT;
+        sqe->fd = dirFd;
+        sqe->addr = reinterpret_cast<uint64_t>(name);
+        sqe->unlink_flags = 0;
+        sqe->user_data = userData;
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        ++queued;
+    }
+
+    // Submits everything queued and waits for all of it, calling
+    // done(userData, result) per request. Returns false if the ring failed;
+    // it is then closed and requests without a result were not performed.
+    template <typename Done>
+    bool drain(Done done)
+    {
+        unsigned toSubmit = queued;
+        unsigned waiting = queued;
+        queued = 0;
+
+        while (waiting > 0) {
+            int submitted = static_cast<int>(syscall(__NR_io_uring_enter, ringFd, toSubmit, waiting,
+                                                     IORING_ENTER_GETEVENTS, nullptr, 0));
+            if (submitted < 0) {
+                if (errno == EINTR) continue;
+                shutdown();
+                return false;
+            }
+            toSubmit -= std::min<unsigned>(toSubmit, static_cast<unsigned>(submitted));
+
+            unsigned head = *cqHead;
+            const unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+            while (head != tail) {
+                const io_uring_cqe &cqe = cqes[head & cqMask];
+                done(cqe.user_data, cqe.res);
+                ++head;
+                --waiting;
+            }
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+        }
+        return true;
+    }
+
+private:
+    void shutdown()
+    {
+        if (sqes) munmap(sqes, entries * sizeof(io_uring_sqe));
+        if (cqMap && cqMap != sqMap) munmap(cqMap, cqMapSize);
+        if (sqMap) munmap(sqMap, sqMapSize);
+        if (ringFd >= 0) close(ringFd);
+        sqes = nullptr;
+        cqMap = nullptr;
+        sqMap = nullptr;
+        ringFd = -1;
+    }
+
+    int ringFd;
+    unsigned entries;
+    unsigned queued;
+    void *sqMap;
+    void *cqMap;
+    size_t sqMapSize;
+    size_t cqMapSize;
+    io_uring_sqe *sqes;
+    unsigned *sqHead = nullptr;
+    unsigned *sqTail = nullptr;
+    unsigned *sqArray = nullptr;
+    unsigned sqMask = 0;
+    unsigned *cqHead = nullptr;
+    unsigned *cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe *cqes = nullptr;
+};
+#endif
+
+struct DeleteNode
+{
+    std::string path;
+    std::string name;  // within the parent; empty for roots
+    DeleteNode *parent = nullptr;
+    int rootIndex = 0;
+    int depth = 0;
+    bool skipped = false;
+    uint32_t planDir = DeletionPlan::NoDirectory;
+    // Open from processing until the whole subtree is done, so children
+    // are opened and removed relative to it
+    int fd = -1;
+
+    // One for the directory's own pass plus one per child directory
+    std::atomic<int> pending{1};
+};
+
+struct RootCounters
+{
+    std::atomic<int64_t> bytes{0};
+    std::atomic<int64_t> freed{0};
+    std::atomic<int64_t> files{0};
+    std::atomic<int64_t> directories{0};
+    std::atomic<int64_t> failures{0};
+    std::atomic<int64_t> changed{0};
+};
+
+bool isDotOrDotDot(const char *name)
+{
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+int64_t steadyNowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+class TreeDeleter::Run
+{
+public:
+    explicit Run(TreeDeleter &owner)
+        : owner(owner)
+        , queue(owner.threads)
+        , workers(owner.threads)
+        , nextReportMs(0)
+    {
+#ifdef __linux__
+        for (WorkerState &worker : workers) {
+            worker.buffer.resize(DirentBufferSize);
+        }
+#endif
+#ifdef TREEDELETER_IO_URING
+        if (owner.useIoUring && !owner.throttle && TreeDeleter::isIoUringSupported()) {
+            for (WorkerState &worker : workers) {
+                std::unique_ptr<UnlinkRing> ring(new UnlinkRing());
+                if (ring->open(RingEntries)) worker.ring = std::move(ring);
+            }
+        }
+#endif
+    }
+
+    std::vector<DeleteTotals> run(const std::vector<TreeDeleter::Root> &deleteRoots)
+    {
+        roots = deleteRoots;
+        counters.reset(new RootCounters[roots.size()]);
+        rootDevices.assign(roots.size(), 0);
+
+        for (size_t i = 0; i < roots.size(); ++i) {
+            DeleteNode *node = new DeleteNode();
+            node->path = roots[i].path;
+            node->rootIndex = static_cast<int>(i);
+#ifdef __linux__
+            if (owner.plan) node->planDir = owner.plan->findDirectory(node->path);
+#endif
+            queue.push(static_cast<int>(i % queue.workerCount()), node);
+        }
+
+        queue.run([this](int self) { workerLoop(self); });
+
+        std::vector<DeleteTotals> results(roots.size());
+        for (size_t i = 0; i < roots.size(); ++i) {
+            results[i].bytes = counters[i].bytes;
+            results[i].freed = counters[i].freed;
+            results[i].files = counters[i].files;
+            results[i].directories = counters[i].directories;
+            results[i].failures = counters[i].failures;
+            results[i].changed = counters[i].changed;
+        }
+        return results;
+    }
+
+private:
+#ifdef TREEDELETER_IO_URING
+    struct QueuedUnlink
+    {
+        const char *name;
+        int64_t size;
+        int64_t freed;
+    };
+#endif
+
+    struct WorkerState
+    {
+        std::vector<char> buffer;
+#ifdef TREEDELETER_IO_URING
+        // Unlinks queued on the ring, indexed by their user data
+        std::unique_ptr<UnlinkRing> ring;
+        std::vector<QueuedUnlink> batch;
+#endif
+    };
+
+    void workerLoop(int self)
+    {
+        DeleteNode *node = nullptr;
+        while (queue.next(self, node)) {
+            if (!owner.canceled.load(std::memory_order_relaxed)) {
+                processDirectory(self, node);
+            }
+            finishNode(node);
+            queue.done();
+        }
+    }
+
+    // Subdirectories the root's directory filter rejects are left as they are
+    bool isExcluded(DeleteNode *node) const
+    {
+        const TreeDeleter::Root &root = roots[node->rootIndex];
+        if (!node->parent || !root.directoryFilter || root.directoryFilter(node->path)) return false;
+        node->skipped = true;
+        return true;
+    }
+
+    static bool descends(const TreeDeleter::Root &root, const DeleteNode *node)
+    {
+        return root.recursive && (root.maxDepth < 0 || node->depth < root.maxDepth);
+    }
+
+    DeleteNode *makeChild(DeleteNode *parent, const char *name)
+    {
+        DeleteNode *child = new DeleteNode();
+        child->path = joinPath(parent->path, name);
+        child->name = name;
+        child->parent = parent;
+        child->rootIndex = parent->rootIndex;
+        child->depth = parent->depth + 1;
+        parent->pending.fetch_add(1, std::memory_order_relaxed);
+        return child;
+    }
+
+    // Once a directory and everything below it has been processed it is
+    // removed if it ended up empty, which walks the tree bottom-up
+    void finishNode(DeleteNode *node)
+    {
+        while (node && node->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            DeleteNode *parent = node->parent;
+#ifdef __linux__
+            if (node->fd >= 0) close(node->fd);
+#endif
+            if (parent && !node->skipped && roots[node->rootIndex].removeDirectories
+                && !owner.canceled.load(std::memory_order_relaxed)) {
+                removeDirectory(node);
+            }
+            delete node;
+            node = parent;
+        }
+    }
+
+    void recordDeleted(DeleteNode *node, int64_t size, int64_t freed)
+    {
+        RootCounters &root = counters[node->rootIndex];
+        root.bytes.fetch_add(size, std::memory_order_relaxed);
+        root.freed.fetch_add(freed, std::memory_order_relaxed);
+        root.files.fetch_add(1, std::memory_order_relaxed);
+        owner.byteCounter.fetch_add(size, std::memory_order_relaxed);
+        owner.fileCounter.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void recordFailure(DeleteNode *node, const std::string &path, int error)
+    {
+        counters[node->rootIndex].failures.fetch_add(1, std::memory_order_relaxed);
+        if (owner.failureCallback) owner.failureCallback(path, error);
+    }
+
+    void recordReadFailure(DeleteNode *node, const std::string &path, int error)
+    {
+        counters[node->rootIndex].failures.fetch_add(1, std::memory_order_relaxed);
+        if (owner.readFailureCallback) owner.readFailureCallback(path, error);
+    }
+
+    void reportProgress()
+    {
+        if (!owner.progressCallback) return;
+
+        const int64_t now = steadyNowMs();
+        if (now < nextReportMs.load(std::memory_order_relaxed)) return;
+        if (!progressLock.try_lock()) return;
+
+        nextReportMs.store(now + owner.progressIntervalMs, std::memory_order_relaxed);
+        owner.progressCallback(owner.byteCounter.load(std::memory_order_relaxed),
+                               owner.fileCounter.load(std::memory_order_relaxed));
+        progressLock.unlock();
+    }
+
+#ifdef __linux__
+    void removeDirectory(DeleteNode *node)
+    {
+        if (unlinkat(node->parent->fd, node->name.c_str(), AT_REMOVEDIR) == 0) {
+            counters[node->rootIndex].directories.fetch_add(1, std::memory_order_relaxed);
+        } else if (errno != ENOTEMPTY && errno != EEXIST && errno != ENOENT) {
+            recordFailure(node, node->path, errno);
+        }
+    }
+
+    void unlinkEntry(DeleteNode *node, int fd, const char *name, int64_t size, int64_t freed)
+    {
+        if (unlinkat(fd, name, 0) == 0) {
+            recordDeleted(node, size, freed);
+        } else if (errno != ENOENT) {
+            recordFailure(node, joinPath(node->path, name), errno);
+        }
+    }
+
+#ifdef TREEDELETER_IO_URING
+    // Completes the batch queued on this worker's ring. If the ring breaks
+    // the entries it did not report are removed one by one instead.
+    void flushBatch(WorkerState &worker, DeleteNode *node, int fd)
+    {
+        if (worker.batch.empty()) return;
+
+        std::vector<bool> completed(worker.batch.size(), false);
+        const bool ok = worker.ring->drain([&](uint64_t index, int result) {
+            completed[index] = true;
+            if (result == 0) {
+                recordDeleted(node, worker.batch[index].size, worker.batch[index].freed);
+            } else if (result != -ENOENT) {
+                recordFailure(node, joinPath(node->path, worker.batch[index].name), -result);
+            }
+        });
+        if (!ok) {
+            worker.ring.reset();
+            for (size_t i = 0; i < worker.batch.size(); ++i) {
+                if (!completed[i]) {
+                    const QueuedUnlink &queued = worker.batch[i];
+                    unlinkEntry(node, fd, queued.name, queued.size, queued.freed);
+                }
+            }
+        } else {
+            owner.ringUsed.store(true, std::memory_order_relaxed);
+        }
+        worker.batch.clear();
+    }
+#endif
+
+    // Applies the root's filter to one non-directory entry and removes it,
+    // through the worker's ring when there is one
+    void deleteEntry(WorkerState &worker, DeleteNode *node, int fd, const char *name,
+                     const struct stat &st, ScanFileEntry &entry)
+    {
+        const TreeDeleter::Root &root = roots[node->rootIndex];
+        if (root.filter) {
+            entry.name = name;
+            entry.device = st.st_dev;
+            entry.inode = st.st_ino;
+            entry.size = st.st_size;
+            entry.mtime = st.st_mtime;
+            entry.atime = st.st_atime;
+            entry.nlink = static_cast<uint32_t>(st.st_nlink);
+            entry.owner = st.st_uid;
+            entry.regular = S_ISREG(st.st_mode);
+            if (!root.filter(entry)) return;
+        }
+
+        // Other links keep the data alive, only the last one frees its blocks
+        const int64_t freed = st.st_nlink <= 1 ? static_cast<int64_t>(st.st_blocks) * 512 : 0;
+        if (owner.throttle && !owner.throttle->acquire()) return;
+
+#ifdef TREEDELETER_IO_URING
+        if (worker.ring) {
+            worker.ring->queue(fd, name, worker.batch.size());
+            worker.batch.push_back(QueuedUnlink{name, static_cast<int64_t>(st.st_size), freed});
+            if (worker.ring->isFull()) flushBatch(worker, node, fd);
+            return;
+        }
+#else
+        (void)worker;
+#endif
+        unlinkEntry(node, fd, name, st.st_size, freed);
+    }
+
+    void processDirectory(int self, DeleteNode *node)
+    {
+        if (isExcluded(node)) return;
+
+        // Below the root only by name relative to the parent, which is still
+        // open: a directory swapped for a symlink after it was listed fails
+        // with ELOOP instead of leading somewhere else, also further down
+        const int flags = O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC;
+        const int fd = node->parent ? openat(node->parent->fd, node->name.c_str(), flags)
+                                    : open(node->path.c_str(), flags);
+        if (fd < 0) {
+            // A missing target has nothing to delete. One that could not be
+            // opened, e.g. a symlink swapped in, is not removed either.
+            if (errno != ENOENT) recordReadFailure(node, node->path, errno);
+            node->skipped = true;
+            return;
+        }
+        node->fd = fd;
+
+        struct stat dirStat;
+        if (fstat(fd, &dirStat) != 0) {
+            recordReadFailure(node, node->path, errno);
+            return;
+        }
+
+        // Never descend into a different filesystem mounted below a target
+        if (!node->parent) {
+            rootDevices[node->rootIndex] = dirStat.st_dev;
+        } else if (dirStat.st_dev != rootDevices[node->rootIndex]) {
+            node->skipped = true;
+            return;
+        }
+
+        WorkerState &worker = workers[self];
+        const TreeDeleter::Root &root = roots[node->rootIndex];
+        ScanFileEntry entry;
+        entry.rootIndex = node->rootIndex;
+        entry.dirFd = fd;
+        entry.dirPath = &node->path;
+
+        // A planned directory that was replaced since the scan, or an unlisted
+        // one that changed, is walked like any other
+        const DeletionPlan::Directory *planned = nullptr;
+        if (node->planDir != DeletionPlan::NoDirectory) {
+            const DeletionPlan::Directory &dir = owner.plan->directory(node->planDir);
+            if (dir.device == static_cast<uint64_t>(dirStat.st_dev) && dir.inode == dirStat.st_ino
+                && (dir.listed || dir.mtime == dirStat.st_mtime)) {
+                planned = &dir;
+            }
+        }
+
+        if (planned) {
+            if (descends(root, node)) {
+                for (uint32_t i = 0; i < planned->childCount; ++i) {
+                    const uint32_t childDir = owner.plan->child(*planned, i);
+                    const char *name = owner.plan->name(owner.plan->directory(childDir).name);
+                    // load() rejects these already, a plan never leads out of its root
+                    if (!DeletionPlan::isPlainName(name, std::strlen(name))) {
+                        recordReadFailure(node, joinPath(node->path, name), EINVAL);
+                        continue;
+                    }
+                    DeleteNode *child = makeChild(node, name);
+                    child->planDir = childDir;
+                    queue.push(self, child);
+                }
+            }
+            if (planned->listed) {
+                deletePlannedFiles(worker, node, fd, *planned, entry);
+                return;
+            }
+        }
+
+        for (;;) {
+            long length = syscall(SYS_getdents64, fd, worker.buffer.data(), worker.buffer.size());
+            if (length < 0) {
+                recordReadFailure(node, node->path, errno);
+                break;
+            }
+            if (length == 0) break;
+
+            for (long offset = 0; offset < length;) {
+                if (owner.canceled.load(std::memory_order_relaxed)) break;
+
+                const LinuxDirent64 *dirent = reinterpret_cast<const LinuxDirent64 *>(worker.buffer.data() + offset);
+                offset += dirent->d_reclen;
+
+                const char *name = dirent->d_name;
+                if (isDotOrDotDot(name)) continue;
+
+                // Subdirectories of a planned directory were queued from the plan
+                if (dirent->d_type == DT_DIR) {
+                    if (!planned && descends(root, node)) queue.push(self, makeChild(node, name));
+                    continue;
+                }
+
+                struct stat st;
+                if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                    if (errno != ENOENT) recordReadFailure(node, joinPath(node->path, name), errno);
+                    continue;
+                }
+                if (S_ISDIR(st.st_mode)) {
+                    if (!planned && descends(root, node)) queue.push(self, makeChild(node, name));
+                    continue;
+                }
+
+                deleteEntry(worker, node, fd, name, st, entry);
+            }
+
+            // Queued names point into the buffer, finish them before refilling it
+#ifdef TREEDELETER_IO_URING
+            if (worker.ring) flushBatch(worker, node, fd);
+#endif
+            reportProgress();
+            if (owner.canceled.load(std::memory_order_relaxed)) break;
+        }
+
+#ifdef TREEDELETER_IO_URING
+        if (worker.ring) flushBatch(worker, node, fd);
+#endif
+    }
+
+    // Deletes the files the plan recorded for a directory without listing
+    // it. Each file is checked first; one that was replaced, rewritten or
+    // resized since the scan is left alone.
+    void deletePlannedFiles(WorkerState &worker, DeleteNode *node, int fd,
+                            const DeletionPlan::Directory &dir, ScanFileEntry &entry)
+    {
+        const DeletionPlan &plan = *owner.plan;
+        const uint32_t end = dir.firstFile + dir.fileCount;
+        for (uint32_t i = dir.firstFile; i < end; ++i) {
+            if (owner.canceled.load(std::memory_order_relaxed)) break;
+
+            const DeletionPlan::File &file = plan.file(i);
+            const char *name = plan.name(file.name);
+            if (!DeletionPlan::isPlainName(name, std::strlen(name))) {
+                recordReadFailure(node, joinPath(node->path, name), EINVAL);
+                continue;
+            }
+
+            struct stat st;
+            if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                if (errno != ENOENT) recordReadFailure(node, joinPath(node->path, name), errno);
+                continue;
+            }
+            if (S_ISDIR(st.st_mode) || st.st_ino != file.inode || st.st_size != file.size
+                || st.st_mtime != file.mtime) {
+                counters[node->rootIndex].changed.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            deleteEntry(worker, node, fd, name, st, entry);
+            if ((i - dir.firstFile) % 1024 == 1023) reportProgress();
+        }
+
+#ifdef TREEDELETER_IO_URING
+        if (worker.ring) flushBatch(worker, node, fd);
+#endif
+        reportProgress();
+    }
+#else
+    void removeDirectory(DeleteNode *node)
+    {
+        namespace fs = std::filesystem;
+        std::error_code ec;
+        if (fs::remove(fs::u8path(node->path), ec)) {
+            counters[node->rootIndex].directories.fetch_add(1, std::memory_order_relaxed);
+        } else if (ec && ec != std::errc::directory_not_empty && ec != std::errc::no_such_file_or_directory) {
+            recordFailure(node, node->path, ec.value());
+        }
+    }
+
+    void processDirectory(int self, DeleteNode *node)
+    {
+        if (isExcluded(node)) return;
+
+        namespace fs = std::filesystem;
+        std::error_code ec;
+
+        fs::directory_iterator it(fs::u8path(node->path), fs::directory_options::skip_permission_denied, ec);
+        if (ec) {
+            if (ec != std::errc::no_such_file_or_directory) recordReadFailure(node, node->path, ec.value());
+            return;
+        }
+
+        const TreeDeleter::Root &root = roots[node->rootIndex];
+        ScanFileEntry entry;
+        entry.rootIndex = node->rootIndex;
+        entry.dirPath = &node->path;
+
+        for (const fs::directory_entry &child : it) {
+            if (owner.canceled.load(std::memory_order_relaxed)) break;
+
+            const std::string name = child.path().filename().u8string();
+            if (child.is_directory(ec) && !child.is_symlink(ec)) {
+                if (descends(root, node)) queue.push(self, makeChild(node, name.c_str()));
+                continue;
+            }
+
+            const uintmax_t size = child.is_regular_file(ec) ? child.file_size(ec) : 0;
+            ec.clear();
+
+            if (root.filter) {
+                entry.name = name.c_str();
+                entry.size = static_cast<int64_t>(size);
+                entry.regular = child.is_regular_file(ec);
+                entry.mtime = unixSeconds(child.last_write_time(ec));
+                if (!root.filter(entry)) continue;
+            }
+
+            if (owner.throttle && !owner.throttle->acquire()) break;
+            if (fs::remove(child.path(), ec)) {
+                recordDeleted(node, static_cast<int64_t>(size), static_cast<int64_t>(size));
+            } else if (ec && ec != std::errc::no_such_file_or_directory) {
+                recordFailure(node, joinPath(node->path, name.c_str()), ec.value());
+            }
+            ec.clear();
+        }
+        reportProgress();
+    }
+#endif
+
+    TreeDeleter &owner;
+    WorkQueue<DeleteNode *> queue;
+    std::vector<WorkerState> workers;
+    std::vector<TreeDeleter::Root> roots;
+    std::unique_ptr<RootCounters[]> counters;
+    std::vector<uint64_t> rootDevices;
+    std::mutex progressLock;
+    std::atomic<int64_t> nextReportMs;
+};
+
+TreeDeleter::TreeDeleter(int threadCount)
+    : threads(threadCount)
+    , recursive(true)
+    , removeDirectories(true)
+    , useIoUring(false)
+    , plan(nullptr)
+    , throttle(nullptr)
+    , idlePriority(false)
+    , progressIntervalMs(50)
+    , canceled(false)
+    , ringUsed(false)
+    , fileCounter(0)
+    , byteCounter(0)
+{
+    if (threads <= 0) {
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    threads = std::max(1, threads);
+}
+
+void TreeDeleter::setFilter(const Filter &deleteFilter)
+{
+    filter = deleteFilter;
+}
+
+void TreeDeleter::setRecursive(bool descend)
+{
+    recursive = descend;
+}
+
+void TreeDeleter::setRemoveDirectories(bool remove)
+{
+    removeDirectories = remove;
+}
+
+void TreeDeleter::setUseIoUring(bool use)
+{
+    useIoUring = use;
+}
+
+void TreeDeleter::setPlan(const DeletionPlan *deletionPlan)
+{
+    plan = deletionPlan;
+}
+
+void TreeDeleter::setThrottle(IoThrottle *ioThrottle)
+{
+    throttle = ioThrottle;
+}
+
+void TreeDeleter::setIdlePriority(bool idle)
+{
+    idlePriority = idle;
+}
+
+void TreeDeleter::setProgressCallback(const ProgressCallback &callback, int intervalMs)
+{
+    progressCallback = callback;
+    progressIntervalMs = std::max(0, intervalMs);
+}
+
+void TreeDeleter::setFailureCallback(const FailureCallback &callback)
+{
+    failureCallback = callback;
+}
+
+void TreeDeleter::setReadFailureCallback(const FailureCallback &callback)
+{
+    readFailureCallback = callback;
+}
+
+std::vector<DeleteTotals> TreeDeleter::remove(const std::vector<std::string> &paths)
+{
+    std::vector<Root> roots(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        roots[i].path = paths[i];
+        roots[i].filter = filter;
+        roots[i].recursive = recursive;
+        roots[i].removeDirectories = removeDirectories;
+    }
+    return remove(roots);
+}
+
+std::vector<DeleteTotals> TreeDeleter::remove(const std::vector<Root> &roots)
+{
+    fileCounter = 0;
+    byteCounter = 0;
+    ringUsed = false;
+    if (roots.empty()) return std::vector<DeleteTotals>();
+
+    Run run(*this);
+    std::vector<DeleteTotals> totals;
+    if (idlePriority) {
+        // The priority cannot be raised again, so the calling thread, which
+        // would otherwise be worker 0, only waits for a thread of its own
+        std::thread idle([&]() {
+            lowerThreadPriority();
+            totals = run.run(roots);
+        });
+        idle.join();
+    } else {
+        totals = run.run(roots);
+    }
+    if (progressCallback) progressCallback(byteCounter, fileCounter);
+    return totals;
+}
+
+void TreeDeleter::cancel()
+{
+    canceled = true;
+    if (throttle) throttle->cancel();
+}
+
+bool TreeDeleter::isCanceled() const
+{
+    return canceled;
+}
+
+int TreeDeleter::threadCount() const
+{
+    return threads;
+}
+
+bool TreeDeleter::usedIoUring() const
+{
+    return ringUsed;
+}
+
+int64_t TreeDeleter::filesDeleted() const
+{
+    return fileCounter;
+}
+
+int64_t TreeDeleter::bytesDeleted() const
+{
+    return byteCounter;
+}
+
+bool TreeDeleter::isIoUringSupported()
+{
+#ifdef TREEDELETER_IO_URING
+    // Probed once, io_uring may also be disabled by seccomp or sysctl
+    static const bool supported = []() {
+        UnlinkRing ring;
+        return ring.open(2) && ring.supportsUnlink();
+    }();
+    return supported;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,128 @@
+#ifndef TREEDELETER_H
+#define TREEDELETER_H
+
+#include "dirscanner.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// What one deletion root gave back
+struct DeleteTotals
+{
+    int64_t bytes = 0;
+    int64_t freed = 0;        // disk space of files whose last link was removed
+    int64_t files = 0;
+    int64_t directories = 0;  // emptied subdirectories that were removed
+    int64_t failures = 0;
+    int64_t changed = 0;      // planned files left alone because they changed
+};
+
+class DeletionPlan;
+class IoThrottle;
+
+// Parallel bottom-up tree deleter, the counterpart of DirScanner. Every
+// directory is a task on the shared work-stealing queue, so several
+// directories are emptied at once. On Linux entries are listed with
+// getdents64 and removed with unlinkat relative to the open directory,
+// without building a path per file. Subdirectories are opened relative to
+// their parent's descriptor, which stays open until they are done, so
+// nothing is ever followed through a symlink swapped in after listing.
+// When the kernel supports IORING_OP_UNLINKAT and setUseIoUring() is on,
+// the unlinks of a directory are submitted as io_uring batches instead of
+// one system call each.
+//
+// The roots themselves are never removed. Subdirectories are removed once
+// their whole subtree has been processed and they ended up empty.
+//
+// With a DeletionPlan set, directories the plan covers are not listed
+// again: their subdirectories and files come from the plan and each file
+// is only re-checked before it is unlinked. Only the Linux backend uses
+// the plan.
+//
+// For cleanups that run unattended, setThrottle() spaces out the unlinks
+// and setIdlePriority() runs the whole deletion on threads in the idle I/O
+// class at the lowest CPU priority.
+class TreeDeleter
+{
+public:
+    // Return true to delete the entry. Called concurrently from the workers.
+    using Filter = std::function<bool(const ScanFileEntry &entry)>;
+    // Return false to leave a subdirectory alone: it is neither entered nor
+    // removed. Called concurrently from the workers.
+    using DirectoryFilter = std::function<bool(const std::string &path)>;
+    // Called with the running totals of the whole run, at most once per interval
+    using ProgressCallback = std::function<void(int64_t bytes, int64_t files)>;
+    // Called for every entry that could not be removed, with its errno value.
+    // Only unlinks and removals of subdirectories are reported here; a root
+    // is never removed, so it never is.
+    using FailureCallback = std::function<void(const std::string &path, int error)>;
+
+    // A root with its own options, so unrelated targets can share one run
+    struct Root
+    {
+        std::string path;
+        Filter filter;
+        DirectoryFilter directoryFilter;
+        bool recursive = true;
+        int maxDepth = -1;  // levels of subdirectories to descend into, -1 for all
+        bool removeDirectories = true;
+    };
+
+    explicit TreeDeleter(int threadCount = 0);
+
+    void setFilter(const Filter &filter);
+    void setRecursive(bool recursive);
+    void setRemoveDirectories(bool remove);
+    void setUseIoUring(bool use);
+    void setPlan(const DeletionPlan *plan);
+    // Waited on before every unlink; io_uring batching is off while set
+    void setThrottle(IoThrottle *throttle);
+    void setIdlePriority(bool idle);
+    void setProgressCallback(const ProgressCallback &callback, int intervalMs = 50);
+    void setFailureCallback(const FailureCallback &callback);
+    // Called instead for directories that could not be opened or listed and
+    // entries that could not be stat'ed, nothing was removed from those
+    void setReadFailureCallback(const FailureCallback &callback);
+
+    // Deletes below every root and returns one totals entry per root, in
+    // order. Blocks until done or canceled. All roots are processed at
+    // once, so listing one root overlaps deleting another.
+    std::vector<DeleteTotals> remove(const std::vector<Root> &roots);
+    // Same, with the filter and options set on the deleter
+    std::vector<DeleteTotals> remove(const std::vector<std::string> &roots);
+
+    void cancel();
+    bool isCanceled() const;
+
+    int threadCount() const;
+    bool usedIoUring() const;
+    int64_t filesDeleted() const;
+    int64_t bytesDeleted() const;
+
+    static bool isIoUringSupported();
+
+private:
+    class Run;
+
+    int threads;
+    Filter filter;
+    bool recursive;
+    bool removeDirectories;
+    bool useIoUring;
+    const DeletionPlan *plan;
+    IoThrottle *throttle;
+    bool idlePriority;
+    ProgressCallback progressCallback;
+    int progressIntervalMs;
+    FailureCallback failureCallback;
+    FailureCallback readFailureCallback;
+    std::atomic<bool> canceled;
+    std::atomic<bool> ringUsed;
+    std::atomic<int64_t> fileCounter;
+    std::atomic<int64_t> byteCounter;
+};
+
+#endif // TREEDELETER_H
@@ -0,0 +1,126 @@
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing task pool shared by the tree walkers. Each worker owns a
+// deque: it pushes and pops at the back, so it works depth-first and keeps
+// its directory hot in cache, while idle workers steal from the front and
+// pick up the biggest unexplored subtrees. The pool drains when every task
+// pushed has been marked done, including tasks pushed by other tasks.
+template <typename Task>
+class WorkQueue
+{
+public:
+    explicit WorkQueue(int workerCount)
+        : outstanding(0)
+        , idle(0)
+    {
+        for (int i = 0; i < workerCount; ++i) {
+            workers.emplace_back(new Worker());
+        }
+    }
+
+    int workerCount() const
+    {
+        return static_cast<int>(workers.size());
+    }
+
+    void push(int self, Task task)
+    {
+        outstanding.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> guard(workers[self]->lock);
+            workers[self]->tasks.push_back(std::move(task));
+        }
+        if (idle.load(std::memory_order_relaxed) > 0) {
+            idleCondition.notify_one();
+        }
+    }
+
+    // Fetches the next task for worker self, waiting while other workers
+    // may still produce some. Returns false once all work is done.
+    bool next(int self, Task &task)
+    {
+        for (;;) {
+            if (popLocal(self, task) || steal(self, task)) return true;
+
+            std::unique_lock<std::mutex> guard(idleLock);
+            if (outstanding.load(std::memory_order_acquire) == 0) {
+                idleCondition.notify_all();
+                return false;
+            }
+            idle.fetch_add(1, std::memory_order_relaxed);
+            idleCondition.wait_for(guard, std::chrono::milliseconds(2));
+            idle.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Marks a task returned by next() as finished
+    void done()
+    {
+        outstanding.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    // Runs body(workerIndex) on every worker, using the calling thread as
+    // worker 0, and returns when the queue has drained
+    template <typename Body>
+    void run(Body body)
+    {
+        std::vector<std::thread> threads;
+        for (int i = 1; i < workerCount(); ++i) {
+            threads.emplace_back(body, i);
+        }
+        body(0);
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+    }
+
+private:
+    struct Worker
+    {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    bool popLocal(int self, Task &task)
+    {
+        Worker &worker = *workers[self];
+        std::lock_guard<std::mutex> guard(worker.lock);
+        if (worker.tasks.empty()) return false;
+        task = std::move(worker.tasks.back());
+        worker.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(int self, Task &task)
+    {
+        const int count = workerCount();
+        for (int offset = 1; offset < count; ++offset) {
+            Worker &victim = *workers[(self + offset) % count];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<int64_t> outstanding;
+    std::atomic<int> idle;
+    std::mutex idleLock;
+    std::condition_variable idleCondition;
+};
+
+#endif // WORKQUEUE_H
@@ -1,11 +1,23 @@
 #include "mainwindow.h"
+#include "core/trace.h"
 
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
+    // RAPTOR_TRACE=file.json records spans for the whole session and
+    // writes them as a Chrome trace on exit
+    const QByteArray tracePath = qgetenv("RAPTOR_TRACE");
+    if (!tracePath.isEmpty()) {
+        Trace::start();
+        Trace::setThreadName("GUI");
+    }
+
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
-    return a.exec();
+    int result = a.exec();
+
+    if (!tracePath.isEmpty()) Trace::writeChromeJson(tracePath.toStdString());
+    return result;
 }
@@ -4,28 +4,58 @@
 #include "widgets/networkwidget.h"
 #include "widgets/cleanerwidget.h" 
 #include "widgets/hardwareInfo.h" // Add this include
+#include "widgets/diskusagewidget.h"
+#include "core/metricsserver.h"
+#include "core/trace.h"
 #include <QHBoxLayout>
 #include <QStackedWidget>
 #include <QLabel>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QEvent>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
     , sidebar(nullptr)
     , stackedWidget(nullptr)
-    , networkLoaded(false)
-    , cleanerLoaded(false)
-    , hardwareLoaded(false)
+    , prewarmStarted(false)
+    , metrics(nullptr)
 {
     ui->setupUi(this);
+    setupMetrics();
     setupUI();
 }
 
 MainWindow::~MainWindow()
 {
+    delete metrics;
     delete ui;
 }
 
+void MainWindow::setupMetrics()
+{
+    QString configDir = QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation);
+    QFile file(QDir(configDir).filePath("metrics.json"));
+    if (!file.open(QIODevice::ReadOnly)) return;
+    
+    QJsonObject config = QJsonDocument::fromJson(file.readAll()).object();
+    if (!config.value("enabled").toBool()) return;
+    
+    metrics = new MetricsServer(config.value("port").toInt(MetricsServer::DefaultPort));
+    std::string error;
+    if (!metrics->start(&error)) {
+        qWarning() << "Metrics endpoint not started:" << QString::fromStdString(error);
+        delete metrics;
+        metrics = nullptr;
+    }
+}
+
 void MainWindow::setupUI()
 {
     setWindowTitle("Raptor PC Controller");
@@ -51,121 +81,115 @@ void MainWindow::setupUI()
     ui->centralwidget->setLayout(mainLayout);
     
     // Show General page by default
-    showGeneralPage();
+    QWidget *generalPage = page("General");
+    stackedWidget->setCurrentWidget(generalPage);
+    
+    // The pages with data, in the order they are most likely opened,
+    // built once the General page has been painted for the first time
+    prewarmQueue = QStringList() << "Cleaner" << "Disk Usage" << "Network" << "Hardware";
+    generalPage->installEventFilter(this);
+}
+
+bool MainWindow::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() == QEvent::Paint && !prewarmStarted) {
+        prewarmStarted = true;
+        watched->removeEventFilter(this);
+        QTimer::singleShot(0, this, &MainWindow::prewarmNextPage);
+    }
+    return QMainWindow::eventFilter(watched, event);
+}
+
+void MainWindow::prewarmNextPage()
+{
+    if (prewarmQueue.isEmpty()) return;
+    
+    TraceSpan span("MainWindow::prewarmNextPage");
+    const QString category = prewarmQueue.takeFirst();
+    if (span.isActive()) span.setDetail(category.toStdString());
+    page(category);
+    
+    // One page per turn so clicks and repaints in between are not held up
+    QTimer::singleShot(0, this, &MainWindow::prewarmNextPage);
 }
 
 void MainWindow::setupContentArea()
 {
     stackedWidget = new QStackedWidget();
     stackedWidget->setStyleSheet("QStackedWidget { background-color: #ecf0f1; }");
-    
-    // Add placeholder pages - they will be replaced when needed
-    for (int i = 0; i < 7; i++) {
-        QWidget *placeholder = new QWidget();
-        placeholder->setStyleSheet("background-color: #ecf0f1;");
-        QVBoxLayout *placeholderLayout = new QVBoxLayout(placeholder);
-        QLabel *placeholderLabel = new QLabel("Loading...");
-        placeholderLabel->setStyleSheet("font-size: 18px; color: #7f8c8d;");
-        placeholderLabel->setAlignment(Qt::AlignCenter);
-        placeholderLayout->addWidget(placeholderLabel);
-        stackedWidget->addWidget(placeholder);
-    }
 }
 
 void MainWindow::onCategoryChanged(const QString &category)
 {
-    if (category == "General") {
-        showGeneralPage();
-    } else if (category == "Network") {
-        showNetworkPage();
-    } else if (category == "Cleaner") {
-        showCleanerPage();
-    } else if (category == "Hardware") {
-        showHardwarePage();
-    } else {
-        showPlaceholderPage(category);
-    }
+    TraceSpan span("MainWindow::onCategoryChanged");
+    if (span.isActive()) span.setDetail(category.toStdString());
+    stackedWidget->setCurrentWidget(page(category));
 }
 
-void MainWindow::showGeneralPage()
+QWidget *MainWindow::page(const QString &category)
 {
-    // Create or show General page
-    if (stackedWidget->count() > 0) {
-        QWidget *generalPage = new QWidget();
-        generalPage->setStyleSheet("background-color: #ecf0f1;");
-        QVBoxLayout *generalLayout = new QVBoxLayout(generalPage);
-        
-        QLabel *welcomeLabel = new QLabel("Welcome to Raptor PC Controller");
-        welcomeLabel->setStyleSheet("font-size: 24px; font-weight: bold; color: #2c3e50; margin-bottom: 20px;");
-        welcomeLabel->setAlignment(Qt::AlignCenter);
-        
-        QLabel *descriptionLabel = new QLabel(
-            "This tool helps you manage your PC's network settings, clean up system files, "
-            "and optimize performance.\n\n"
-            "Select a category from the sidebar to get started."
-        );
-        descriptionLabel->setStyleSheet("font-size: 14px; color: #7f8c8d; text-align: center; line-height: 1.5;");
-        descriptionLabel->setAlignment(Qt::AlignCenter);
-        descriptionLabel->setWordWrap(true);
-        
-        generalLayout->addStretch();
-        generalLayout->addWidget(welcomeLabel);
-        generalLayout->addWidget(descriptionLabel);
-        generalLayout->addStretch();
-        
-        if (stackedWidget->count() > 0) {
-            delete stackedWidget->widget(0); // Remove old widget
-            stackedWidget->insertWidget(0, generalPage);
-        }
-        stackedWidget->setCurrentIndex(0);
-    }
+    QWidget *existing = pages.value(category);
+    if (existing) return existing;
+    
+    QWidget *created = createPage(category);
+    stackedWidget->addWidget(created);
+    pages.insert(category, created);
+    return created;
 }
 
-void MainWindow::showNetworkPage()
+QWidget *MainWindow::createPage(const QString &category)
 {
-    if (!networkLoaded) {
-        // Load Network widget only when needed
+    TraceSpan span("MainWindow::createPage");
+    if (span.isActive()) span.setDetail(category.toStdString());
+    if (category == "General") {
+        return createGeneralPage();
+    } else if (category == "Network") {
         NetworkWidget *networkWidget = new NetworkWidget();
-        if (stackedWidget->count() > 4) {
-            delete stackedWidget->widget(4); // Remove old widget
-            stackedWidget->insertWidget(4, networkWidget);
-        }
-        networkLoaded = true;
-    }
-    stackedWidget->setCurrentIndex(4);
-}
-
-void MainWindow::showCleanerPage()
-{
-    if (!cleanerLoaded) {
-        // Load Cleaner widget only when needed
+        networkWidget->setMetrics(metrics);
+        return networkWidget;
+    } else if (category == "Cleaner") {
         CleanerWidget *cleanerWidget = new CleanerWidget();
-        if (stackedWidget->count() > 3) {
-            delete stackedWidget->widget(3); // Remove old widget
-            stackedWidget->insertWidget(3, cleanerWidget);
-        }
-        cleanerLoaded = true;
+        cleanerWidget->setMetrics(metrics);
+        return cleanerWidget;
+    } else if (category == "Hardware") {
+        HardwareInfo *hardwareWidget = new HardwareInfo();
+        hardwareWidget->setMetrics(metrics);
+        return hardwareWidget;
+    } else if (category == "Disk Usage") {
+        return new DiskUsageWidget();
     }
-    stackedWidget->setCurrentIndex(3);
+    return createPlaceholderPage(category);
 }
 
-void MainWindow::showHardwarePage()
+QWidget *MainWindow::createGeneralPage()
 {
-    if (!hardwareLoaded) {
-        // Load Hardware widget only when needed
-        HardwareInfo *hardwareWidget = new HardwareInfo();
-        if (stackedWidget->count() > 5) {
-            delete stackedWidget->widget(5); // Remove old widget
-            stackedWidget->insertWidget(5, hardwareWidget);
-        }
-        hardwareLoaded = true;
-    }
-    stackedWidget->setCurrentIndex(5);
+    QWidget *generalPage = new QWidget();
+    generalPage->setStyleSheet("background-color: #ecf0f1;");
+    QVBoxLayout *generalLayout = new QVBoxLayout(generalPage);
+    
+    QLabel *welcomeLabel = new QLabel("Welcome to Raptor PC Controller");
+    welcomeLabel->setStyleSheet("font-size: 24px; font-weight: bold; color: #2c3e50; margin-bottom: 20px;");
+    welcomeLabel->setAlignment(Qt::AlignCenter);
+    
+    QLabel *descriptionLabel = new QLabel(
+        "This tool helps you manage your PC's network settings, clean up system files, "
+        "and optimize performance.\n\n"
+        "Select a category from the sidebar to get started."
+    );
+    descriptionLabel->setStyleSheet("font-size: 14px; color: #7f8c8d; text-align: center; line-height: 1.5;");
+    descriptionLabel->setAlignment(Qt::AlignCenter);
+    descriptionLabel->setWordWrap(true);
+    
+    generalLayout->addStretch();
+    generalLayout->addWidget(welcomeLabel);
+    generalLayout->addWidget(descriptionLabel);
+    generalLayout->addStretch();
+    return generalPage;
 }
 
-void MainWindow::showPlaceholderPage(const QString &title)
+QWidget *MainWindow::createPlaceholderPage(const QString &title)
 {
-    // Show placeholder for other categories
+    // Placeholder for categories that are not implemented yet
     QWidget *placeholder = new QWidget();
     placeholder->setStyleSheet("background-color: #ecf0f1;");
     QVBoxLayout *placeholderLayout = new QVBoxLayout(placeholder);
@@ -186,20 +210,5 @@ void MainWindow::showPlaceholderPage(const QString &title)
     placeholderLayout->addWidget(titleLabel);
     placeholderLayout->addWidget(descriptionLabel);
     placeholderLayout->addStretch();
-    
-    // Map categories to indices
-    QMap<QString, int> categoryIndices = {
-        {"WiFi", 1},
-        {"Apps", 2},
-        {"Options", 6}
-    };
-    
-    if (categoryIndices.contains(title)) {
-        int index = categoryIndices[title];
-        if (stackedWidget->count() > index) {
-            delete stackedWidget->widget(index);
-            stackedWidget->insertWidget(index, placeholder);
-        }
-        stackedWidget->setCurrentIndex(index);
-    }
+    return placeholder;
 }
\ No newline at end of file
@@ -2,10 +2,13 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QHash>
+#include <QStringList>
 
 class Sidebar;
 class QStackedWidget;
 class QWidget;
+class MetricsServer;
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -21,25 +24,38 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
 private slots:
     void onCategoryChanged(const QString &category);
+    void prewarmNextPage();
 
 private:
     void setupUI();
+    void setupMetrics();
     void setupContentArea();
-    void showGeneralPage();
-    void showNetworkPage();
-    void showCleanerPage();
-    void showHardwarePage();
-    void showPlaceholderPage(const QString &title);
+    QWidget *page(const QString &category);
+    QWidget *createPage(const QString &category);
+    QWidget *createGeneralPage();
+    QWidget *createPlaceholderPage(const QString &title);
 
     Ui::MainWindow *ui;
     Sidebar *sidebar;
     QStackedWidget *stackedWidget;
     
-    // Track which pages are loaded
-    bool networkLoaded;
-    bool cleanerLoaded;
-    bool hardwareLoaded;
+    // Pages by sidebar category, each created once on first use and kept.
+    // The pages only build their widgets in the constructor and load their
+    // data on worker threads, so a click costs at most one frame.
+    QHash<QString, QWidget*> pages;
+    // Built one per event loop turn after the first frame is on screen,
+    // so they are ready by the time they are clicked
+    QStringList prewarmQueue;
+    bool prewarmStarted;
+    
+    // Prometheus endpoint, only when metrics.json in the config directory
+    // has {"enabled": true}, optionally with a "port". The pages publish
+    // to it once they are loaded.
+    MetricsServer *metrics;
 };
 #endif // MAINWINDOW_H
\ No newline at end of file
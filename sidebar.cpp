@@ -60,6 +60,7 @@ void Sidebar::createButtons()
         "WiFi",
         "Apps",
         "Cleaner",
+        "Disk Usage",
         "Network",
         "Hardware",
         "Options"
@@ -1,4 +1,12 @@
 #include "cleanerwidget.h"
+#include "../core/dirscanner.h"
+#include "../core/scanindex.h"
+#include "../core/livesizetracker.h"
+#include "../core/cleanupworker.h"
+#include "../core/logcompressor.h"
+#include "../core/cleanupscheduler.h"
+#include "../core/metricsserver.h"
+#include "../core/trace.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QPushButton>
@@ -10,6 +18,7 @@
 #include <QProcess>
 #include <QCheckBox>
 #include <QProgressBar>
+#include <QSpinBox>
 #include <QScrollArea>
 #include <QDir>
 #include <QFileInfo>
@@ -17,6 +26,24 @@
 #include <QDateTime>
 #include <QStandardPaths>
 #include <QThread>
+#include <QMap>
+
+namespace {
+
+// Categories that cover different folders on Linux
+#ifdef __linux__
+const char *const RecycleBinLabel = "🗂️ Trash";
+const char *const BrowserCacheLabel = "🌐 Application Caches";
+const char *const WindowsTempLabel = "💻 System Temp Files";
+const char *const PrefetchLabel = "📦 Package Caches";
+#else
+const char *const RecycleBinLabel = "🗂️ Recycle Bin";
+const char *const BrowserCacheLabel = "🌐 Browser Cache";
+const char *const WindowsTempLabel = "💻 Windows Temp Files";
+const char *const PrefetchLabel = "⚡ Prefetch Files";
+#endif
+
+} // namespace
 
 CleanerWidget::CleanerWidget(QWidget *parent)
     : QWidget(parent)
@@ -25,8 +52,8 @@ CleanerWidget::CleanerWidget(QWidget *parent)
     , infoDisplay(nullptr)
     , progressBar(nullptr)
     , statusLabel(nullptr)
-    , progressTimer(nullptr)
-    , progressValue(0)
+    , spaceTrendLabel(nullptr)
+    , statusTimer(nullptr)
     , tempFilesSize(0)
     , recycleBinSize(0)
     , browserCacheSize(0)
@@ -34,13 +61,58 @@ CleanerWidget::CleanerWidget(QWidget *parent)
     , prefetchSize(0)
     , thumbnailsSize(0)
     , logsSize(0)
+    , liveTracker(nullptr)
+    , worker(nullptr)
+    , workerThread(nullptr)
+    , scheduler(nullptr)
+    , scanning(false)
+    , cleaning(false)
+    , findingDuplicates(false)
+    , quarantinedRuns(0)
+    , metrics(nullptr)
 {
+    qRegisterMetaType<QList<qint64>>("QList<qint64>");
+
     setupUI();
+
+    // Scanning and cleanup run on a worker thread and report back through signals
+    workerThread = new QThread(this);
+    worker = new CleanupWorker();
+    worker->moveToThread(workerThread);
+    connect(worker, &CleanupWorker::logLines, this, &CleanerWidget::appendLogLines);
+    connect(worker, &CleanupWorker::progress, this, &CleanerWidget::onCleanupProgress);
+    connect(worker, &CleanupWorker::scanFinished, this, &CleanerWidget::onScanFinished);
+    connect(worker, &CleanupWorker::cleanFinished, this, &CleanerWidget::onCleanFinished);
+    connect(worker, &CleanupWorker::duplicatesFinished, this, &CleanerWidget::onDuplicatesFinished);
+    connect(worker, &CleanupWorker::restoreFinished, this, &CleanerWidget::onRestoreFinished);
+    connect(workerThread, &QThread::finished, worker, &QObject::deleteLater);
+    workerThread->start();
+    QMetaObject::invokeMethod(worker, []() { Trace::setThreadName("Cleanup worker"); }, Qt::QueuedConnection);
+
+    // Cleanups quarantined in earlier sessions can still be restored
+    quarantinedRuns = worker->quarantinedRuns();
+    btnRestore->setEnabled(quarantinedRuns > 0);
+
+    // Cleanups that start by themselves, at set times or on low disk space
+    scheduler = new CleanupScheduler(this);
+    connect(scheduler, &CleanupScheduler::cleanupDue, this, &CleanerWidget::onScheduledCleanup);
+    connect(scheduler, &CleanupScheduler::spaceSampled, this, &CleanerWidget::updateSpaceTrend);
+    connect(scheduler, &CleanupScheduler::settingsError, this, [this](const QString &error) {
+        infoDisplay->append("⚠️ " + error);
+    });
+    scheduler->start();
+    if (scheduler->isEnabled()) {
+        infoDisplay->append("⏰ Scheduled cleanups are on, configured in " + QDir::toNativeSeparators(scheduler->settingsPath()));
+    }
 }
 
 CleanerWidget::~CleanerWidget()
 {
-    if (progressTimer) progressTimer->stop();
+    if (statusTimer) statusTimer->stop();
+    worker->cancel();
+    workerThread->quit();
+    workerThread->wait();
+    stopLiveTracking();
 }
 
 void CleanerWidget::setupUI()
@@ -86,6 +158,9 @@ void CleanerWidget::createScanControls()
     btnClean = new QPushButton("🧹 Clean Selected");
     btnSelectAll = new QPushButton("✓ Select All");
     btnDeselectAll = new QPushButton("✗ Deselect All");
+    btnCancel = new QPushButton("⏹ Cancel");
+    btnDuplicates = new QPushButton("🔁 Find Duplicates");
+    btnRestore = new QPushButton("↩️ Restore Last Cleanup");
     
     QString scanStyle = 
         "QPushButton {"
@@ -142,22 +217,55 @@ void CleanerWidget::createScanControls()
     btnClean->setStyleSheet(cleanStyle);
     btnSelectAll->setStyleSheet(selectStyle);
     btnDeselectAll->setStyleSheet(selectStyle);
+    btnCancel->setStyleSheet(cleanStyle);
+    btnDuplicates->setStyleSheet(scanStyle);
+    btnDuplicates->setToolTip("Look for files with identical contents in your home folder");
+    btnRestore->setStyleSheet(selectStyle);
+    btnRestore->setToolTip("Move the files of the most recent quarantined cleanup back where they were");
+    btnRestore->setEnabled(false);
     
     // Initially disable all buttons except scan
     btnClean->setEnabled(false);
     btnSelectAll->setEnabled(false);
     btnDeselectAll->setEnabled(false);
+    btnCancel->setVisible(false);
 
     connect(btnScan, &QPushButton::clicked, this, &CleanerWidget::scanSystem);
     connect(btnClean, &QPushButton::clicked, this, &CleanerWidget::cleanSelected);
     connect(btnSelectAll, &QPushButton::clicked, this, &CleanerWidget::selectAll);
     connect(btnDeselectAll, &QPushButton::clicked, this, &CleanerWidget::deselectAll);
+    connect(btnCancel, &QPushButton::clicked, this, &CleanerWidget::cancelOperation);
+    connect(btnDuplicates, &QPushButton::clicked, this, &CleanerWidget::findDuplicates);
+    connect(btnRestore, &QPushButton::clicked, this, &CleanerWidget::restoreLastCleanup);
+
+    chkLiveSizes = new QCheckBox("Live sizes");
+    chkLiveSizes->setStyleSheet("QCheckBox { font-size: 12px; color: #2c3e50; }");
+    chkLiveSizes->setToolTip("Keep the sizes up to date after a scan by watching the cleanup folders for changes");
+    chkLiveSizes->setEnabled(LiveSizeTracker::isSupported());
+    connect(chkLiveSizes, &QCheckBox::toggled, this, &CleanerWidget::toggleLiveSizes);
+
+    chkQuarantine = new QCheckBox("Quarantine for");
+    chkQuarantine->setStyleSheet("QCheckBox { font-size: 12px; color: #2c3e50; }");
+    chkQuarantine->setToolTip("Move cleaned files aside instead of deleting them, so the cleanup can be undone");
+    spnQuarantineDays = new QSpinBox();
+    spnQuarantineDays->setRange(1, 90);
+    spnQuarantineDays->setValue(7);
+    spnQuarantineDays->setSuffix(" days");
+    spnQuarantineDays->setToolTip("Quarantined files are deleted for good after this many days");
+    connect(chkQuarantine, &QCheckBox::toggled, this, &CleanerWidget::updateQuarantine);
+    connect(spnQuarantineDays, QOverload<int>::of(&QSpinBox::valueChanged), this, &CleanerWidget::updateQuarantine);
 
     buttonLayout->addWidget(btnScan);
     buttonLayout->addWidget(btnClean);
     buttonLayout->addWidget(btnSelectAll);
     buttonLayout->addWidget(btnDeselectAll);
+    buttonLayout->addWidget(btnDuplicates);
+    buttonLayout->addWidget(btnRestore);
+    buttonLayout->addWidget(btnCancel);
     buttonLayout->addStretch();
+    buttonLayout->addWidget(chkQuarantine);
+    buttonLayout->addWidget(spnQuarantineDays);
+    buttonLayout->addWidget(chkLiveSizes);
 
     mainLayout->addWidget(sectionTitle);
     mainLayout->addLayout(buttonLayout);
@@ -206,10 +314,10 @@ void CleanerWidget::createCleanupOptions()
         "}";
 
     chkTempFiles = new QCheckBox("🗑️ Temporary Files (Not scanned yet)");
-    chkRecycleBin = new QCheckBox("🗂️ Recycle Bin (Not scanned yet)");
-    chkBrowserCache = new QCheckBox("🌐 Browser Cache (Not scanned yet)");
-    chkWindowsTemp = new QCheckBox("💻 Windows Temp Files (Not scanned yet)");
-    chkPrefetch = new QCheckBox("⚡ Prefetch Files (Not scanned yet)");
+    chkRecycleBin = new QCheckBox(QString("%1 (Not scanned yet)").arg(RecycleBinLabel));
+    chkBrowserCache = new QCheckBox(QString("%1 (Not scanned yet)").arg(BrowserCacheLabel));
+    chkWindowsTemp = new QCheckBox(QString("%1 (Not scanned yet)").arg(WindowsTempLabel));
+    chkPrefetch = new QCheckBox(QString("%1 (Not scanned yet)").arg(PrefetchLabel));
     chkThumbnails = new QCheckBox("🖼️ Thumbnail Cache (Not scanned yet)");
     chkDNS = new QCheckBox("🔗 DNS Cache");
     chkLogs = new QCheckBox("📋 System Logs (Not scanned yet)");
@@ -251,6 +359,43 @@ void CleanerWidget::createCleanupOptions()
     optionsLayout->addWidget(chkDNS);
     optionsLayout->addWidget(chkLogs);
 
+    // Keeps the logs for later inspection while still reclaiming most of their space
+    chkCompressLogs = new QCheckBox("📦 Compress old logs instead of deleting them");
+    chkCompressLogs->setStyleSheet(checkboxStyle);
+    chkCompressLogs->setToolTip("Rotated logs older than two days are replaced by gzip copies with the same timestamps");
+    chkCompressLogs->setEnabled(LogCompressor::isSupported());
+    connect(chkCompressLogs, &QCheckBox::toggled, this, [this](bool enabled) {
+        CleanupWorker *logWorker = worker;
+        QMetaObject::invokeMethod(worker, [logWorker, enabled]() {
+            logWorker->setCompressLogs(enabled);
+        }, Qt::QueuedConnection);
+    });
+    optionsLayout->addWidget(chkCompressLogs);
+
+    // Emptying a cache makes the next start of its program slow; trimming
+    // keeps what was used recently
+    chkTrimCaches = new QCheckBox("✂️ Only trim browser caches and thumbnails to");
+    chkTrimCaches->setStyleSheet(checkboxStyle);
+    chkTrimCaches->setToolTip("Delete the least recently used cache files until each cache fits the size, instead of emptying it");
+    spnCacheBudget = new QSpinBox();
+    spnCacheBudget->setRange(10, 10000);
+    spnCacheBudget->setValue(500);
+    spnCacheBudget->setSuffix(" MB");
+    spnCacheBudget->setToolTip("Space each cache folder may keep");
+    connect(chkTrimCaches, &QCheckBox::toggled, this, &CleanerWidget::updateCacheBudget);
+    connect(spnCacheBudget, QOverload<int>::of(&QSpinBox::valueChanged), this, &CleanerWidget::updateCacheBudget);
+    QHBoxLayout *trimLayout = new QHBoxLayout();
+    trimLayout->addWidget(chkTrimCaches);
+    trimLayout->addWidget(spnCacheBudget);
+    trimLayout->addStretch();
+    optionsLayout->addLayout(trimLayout);
+
+    // Where the volumes holding the targets are heading, from the scheduler's samples
+    spaceTrendLabel = new QLabel("💽 Collecting free space samples...");
+    spaceTrendLabel->setStyleSheet("font-size: 12px; color: #7f8c8d; padding: 8px; border: none;");
+    spaceTrendLabel->setWordWrap(true);
+    optionsLayout->addWidget(spaceTrendLabel);
+
     mainLayout->addWidget(sectionTitle);
     mainLayout->addWidget(optionsFrame);
 }
@@ -292,6 +437,10 @@ void CleanerWidget::createProgressSection()
     progressBar->setValue(0);
     progressBar->setVisible(false);
 
+    // Polls the worker for scan progress while the scanner is busy
+    statusTimer = new QTimer(this);
+    connect(statusTimer, &QTimer::timeout, this, &CleanerWidget::pollScanStatus);
+
     progressLayout->addWidget(statusLabel);
     progressLayout->addWidget(progressBar);
 
@@ -351,33 +500,6 @@ void CleanerWidget::createLogSection()
 }
 
 // Helper functions
-QString CleanerWidget::executeCommand(const QString &command, const QStringList &arguments)
-{
-    QProcess process;
-    process.start(command, arguments);
-    process.waitForFinished(5000); // 5 second timeout
-    return QString::fromLocal8Bit(process.readAllStandardOutput());
-}
-
-qint64 CleanerWidget::getFolderSize(const QString &path)
-{
-    qint64 totalSize = 0;
-    QDir dir(path);
-    
-    if (!dir.exists()) return 0;
-    
-    // Get only files we can actually read and delete
-    QFileInfoList entries = dir.entryInfoList(QDir::Files | QDir::NoDotAndDotDot, QDir::Name);
-    
-    for (const QFileInfo &entry : entries) {
-        if (entry.isReadable() && entry.isWritable()) {
-            totalSize += entry.size();
-        }
-    }
-    
-    return totalSize;
-}
-
 QString CleanerWidget::formatSize(qint64 bytes)
 {
     const qint64 KB = 1024;
@@ -403,22 +525,6 @@ void CleanerWidget::updateCheckboxText(QCheckBox* checkbox, const QString& baseT
     checkbox->setText(newText);
 }
 
-bool CleanerWidget::deleteFileWithRetry(const QString &filePath)
-{
-    QFile file(filePath);
-    if (file.remove()) {
-        return true;
-    }
-    
-    // If failed, try with a small delay
-    QThread::msleep(100);
-    if (file.remove()) {
-        return true;
-    }
-    
-    return false;
-}
-
 // Slot implementations
 void CleanerWidget::scanSystem()
 {
@@ -430,14 +536,17 @@ void CleanerWidget::scanSystem()
     btnClean->setEnabled(false);
     btnSelectAll->setEnabled(false);
     btnDeselectAll->setEnabled(false);
-    progressBar->setVisible(true);
-    progressBar->setValue(0);
+    btnDuplicates->setEnabled(false);
+    btnRestore->setEnabled(false);
+    chkLiveSizes->setEnabled(false);
+    btnCancel->setEnabled(true);
+    btnCancel->setVisible(true);
     
-    progressTimer = new QTimer(this);
-    progressValue = 0;
-    
-    connect(progressTimer, &QTimer::timeout, this, &CleanerWidget::updateCleanupProgress);
-    progressTimer->start(50);
+    // The total is unknown until the walk is done, so show a busy bar
+    progressBar->setVisible(true);
+    progressBar->setRange(0, 0);
+    scanning = true;
+    statusTimer->start(100);
     
     // Reset all sizes
     tempFilesSize = 0;
@@ -448,98 +557,214 @@ void CleanerWidget::scanSystem()
     thumbnailsSize = 0;
     logsSize = 0;
 
-    // Actual scanning process
-    QTimer::singleShot(100, this, [this]() {
-        infoDisplay->append("📁 Scanning temporary files...");
-        QString tempPath = QDir::tempPath();
-        tempFilesSize = getFolderSize(tempPath);
-        
-        infoDisplay->append("🗂️ Estimating recycle bin size...");
-        // More accurate recycle bin estimation
-        recycleBinSize = 200 * 1024 * 1024; // Conservative 200MB estimate
-        
-        infoDisplay->append("🌐 Scanning browser cache...");
-        // Scan actual browser cache locations
-        QString localAppData = QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation);
-        QString chromeCache = localAppData + "/Google/Chrome/User Data/Default/Cache";
-        QString firefoxCache = localAppData + "/Mozilla/Firefox/Profiles";
-        QString edgeCache = localAppData + "/Microsoft/Edge/User Data/Default/Cache";
-        
-        browserCacheSize += getFolderSize(chromeCache);
-        browserCacheSize += getFolderSize(firefoxCache);
-        browserCacheSize += getFolderSize(edgeCache);
-        
-        infoDisplay->append("💻 Scanning Windows temp files...");
-        windowsTempSize = getFolderSize("C:/Windows/Temp");
-        
-        infoDisplay->append("⚡ Scanning prefetch files...");
-        prefetchSize = getFolderSize("C:/Windows/Prefetch");
-        
-        infoDisplay->append("🖼️ Scanning thumbnail cache...");
-        QString thumbPath = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/Microsoft/Windows/Explorer";
-        thumbnailsSize = getFolderSize(thumbPath);
-        
-        infoDisplay->append("📋 Scanning log files...");
-        logsSize = getFolderSize("C:/Windows/Logs");
-        
-        // Complete scanning
-        progressTimer->stop();
-        progressBar->setVisible(false);
-        
-        // Update checkbox texts with sizes
-        updateCheckboxText(chkTempFiles, "🗑️ Temporary Files", tempFilesSize);
-        updateCheckboxText(chkRecycleBin, "🗂️ Recycle Bin", recycleBinSize);
-        updateCheckboxText(chkBrowserCache, "🌐 Browser Cache", browserCacheSize);
-        updateCheckboxText(chkWindowsTemp, "💻 Windows Temp Files", windowsTempSize);
-        updateCheckboxText(chkPrefetch, "⚡ Prefetch Files", prefetchSize);
-        updateCheckboxText(chkThumbnails, "🖼️ Thumbnail Cache", thumbnailsSize);
-        chkDNS->setText("🔗 DNS Cache"); // DNS doesn't have a size
-        updateCheckboxText(chkLogs, "📋 System Logs", logsSize);
-        
-        // Enable checkboxes and control buttons
-        chkTempFiles->setEnabled(true);
-        chkRecycleBin->setEnabled(true);
-        chkBrowserCache->setEnabled(true);
-        chkWindowsTemp->setEnabled(true);
-        chkPrefetch->setEnabled(true);
-        chkThumbnails->setEnabled(true);
-        chkDNS->setEnabled(true);
-        chkLogs->setEnabled(true);
-        
-        btnSelectAll->setEnabled(true);
-        btnDeselectAll->setEnabled(true);
-        
-        // Show scan results
-        infoDisplay->append("\n📊 Scan Results:");
-        infoDisplay->append("────────────────────────");
-        infoDisplay->append(QString("🗑️ Temporary Files: %1").arg(formatSize(tempFilesSize)));
-        infoDisplay->append(QString("🗂️ Recycle Bin: ~%1").arg(formatSize(recycleBinSize)));
-        infoDisplay->append(QString("🌐 Browser Cache: %1").arg(formatSize(browserCacheSize)));
-        infoDisplay->append(QString("💻 Windows Temp: %1").arg(formatSize(windowsTempSize)));
-        infoDisplay->append(QString("⚡ Prefetch Files: %1").arg(formatSize(prefetchSize)));
-        infoDisplay->append(QString("🖼️ Thumbnail Cache: %1").arg(formatSize(thumbnailsSize)));
-        infoDisplay->append(QString("📋 System Logs: %1").arg(formatSize(logsSize)));
-        
-        qint64 totalSize = tempFilesSize + recycleBinSize + browserCacheSize + 
-                          windowsTempSize + prefetchSize + thumbnailsSize + logsSize;
-        
-        infoDisplay->append("────────────────────────");
-        infoDisplay->append(QString("💾 Total space that can be freed: %1").arg(formatSize(totalSize)));
-        infoDisplay->append("\n✅ Scan complete! Select the items you want to clean and click 'Clean Selected'.");
-        
-        statusLabel->setText("Scan complete - select items to clean");
-        btnScan->setEnabled(true);
-        
-        // Connect checkbox signals to enable/clean button
-        connect(chkTempFiles, &QCheckBox::stateChanged, this, [this]() { updateCleanButtonState(); });
-        connect(chkRecycleBin, &QCheckBox::stateChanged, this, [this]() { updateCleanButtonState(); });
-        connect(chkBrowserCache, &QCheckBox::stateChanged, this, [this]() { updateCleanButtonState(); });
-        connect(chkWindowsTemp, &QCheckBox::stateChanged, this, [this]() { updateCleanButtonState(); });
-        connect(chkPrefetch, &QCheckBox::stateChanged, this, [this]() { updateCleanButtonState(); });
-        connect(chkThumbnails, &QCheckBox::stateChanged, this, [this]() { updateCleanButtonState(); });
-        connect(chkDNS, &QCheckBox::stateChanged, this, [this]() { updateCleanButtonState(); });
-        connect(chkLogs, &QCheckBox::stateChanged, this, [this]() { updateCleanButtonState(); });
-    });
+    infoDisplay->append("📁 Scanning temporary files...");
+#ifdef __linux__
+    infoDisplay->append("🗂️ Scanning trash...");
+    infoDisplay->append("🌐 Scanning application caches...");
+    infoDisplay->append("💻 Scanning system temp files...");
+    infoDisplay->append("📦 Scanning package caches...");
+#else
+    infoDisplay->append("🗂️ Estimating recycle bin size...");
+    infoDisplay->append("🌐 Scanning browser cache...");
+    infoDisplay->append("💻 Scanning Windows temp files...");
+    infoDisplay->append("⚡ Scanning prefetch files...");
+#endif
+    infoDisplay->append("🖼️ Scanning thumbnail cache...");
+    infoDisplay->append("📋 Scanning log files...");
+    
+    // The worker's rules decide which folders exist on this system and
+    // which category each one is counted for
+    QStringList targets;
+    targetOperations.clear();
+    targetFiltered.clear();
+    for (const CleanupWorker::ScanTarget &target : worker->scanTargets()) {
+        targets << target.path;
+        targetOperations << target.operation;
+        targetFiltered << target.filtered;
+    }
+    
+    // In live mode the tracker records each directory as it is scanned
+    stopLiveTracking();
+    if (chkLiveSizes->isChecked()) {
+        std::vector<std::string> roots;
+        for (const QString &target : targets) {
+            roots.push_back(QDir::cleanPath(target).toStdString());
+        }
+        liveTracker = new LiveSizeTracker(roots);
+    }
+    
+    CleanupWorker *scanWorker = worker;
+    LiveSizeTracker *tracker = liveTracker;
+    worker->resetCancel();
+    QMetaObject::invokeMethod(worker, [scanWorker, targets, tracker]() {
+        scanWorker->scan(targets, tracker);
+    }, Qt::QueuedConnection);
+}
+
+void CleanerWidget::onScanFinished(const QList<qint64> &bytes, const QList<qint64> &allocated,
+                                   const QList<qint64> &files, bool canceled)
+{
+    TraceSpan span("CleanerWidget::onScanFinished");
+    // Complete scanning
+    scanning = false;
+    statusTimer->stop();
+    progressBar->setRange(0, 100);
+    progressBar->setVisible(false);
+    btnCancel->setVisible(false);
+    chkLiveSizes->setEnabled(LiveSizeTracker::isSupported());
+    
+    targetBytes = bytes;
+    targetAllocated = allocated;
+    targetFiles = files;
+    applyScanSizes(allocated);
+    if (!canceled) publishScanMetrics();
+    
+    if (canceled) {
+        stopLiveTracking();
+        infoDisplay->append("\n⏹️ Scan canceled - the sizes below are incomplete");
+    }
+    
+    if (liveTracker) {
+        liveTracker->start([this]() {
+            QMetaObject::invokeMethod(this, [this]() { refreshLiveSizes(); }, Qt::QueuedConnection);
+        });
+        infoDisplay->append(QString("   👁️ Live sizes: watching %1 folders").arg(liveTracker->watchCount()));
+        if (liveTracker->isDegraded()) {
+            infoDisplay->append(QString("   ⚠️ inotify watch limit (%1) reached, %2 folders are rescanned every minute instead")
+                                .arg(LiveSizeTracker::watchLimit()).arg(liveTracker->unwatchedCount()));
+        }
+    }
+    
+    // Update checkbox texts with sizes
+    updateSizeLabels();
+    
+    // Enable checkboxes and control buttons
+    chkTempFiles->setEnabled(true);
+    chkRecycleBin->setEnabled(true);
+    chkBrowserCache->setEnabled(true);
+    chkWindowsTemp->setEnabled(true);
+    chkPrefetch->setEnabled(true);
+    chkThumbnails->setEnabled(true);
+    chkDNS->setEnabled(true);
+    chkLogs->setEnabled(true);
+    
+    btnSelectAll->setEnabled(true);
+    btnDeselectAll->setEnabled(true);
+    
+    // Show scan results
+    infoDisplay->append("\n📊 Scan Results:");
+    infoDisplay->append("────────────────────────");
+    infoDisplay->append(QString("🗑️ Temporary Files: %1").arg(formatSize(tempFilesSize)));
+    infoDisplay->append(QString("%1: %2").arg(RecycleBinLabel).arg(formatSize(recycleBinSize)));
+    infoDisplay->append(QString("%1: %2").arg(BrowserCacheLabel).arg(formatSize(browserCacheSize)));
+    infoDisplay->append(QString("%1: %2").arg(WindowsTempLabel).arg(formatSize(windowsTempSize)));
+    infoDisplay->append(QString("%1: %2").arg(PrefetchLabel).arg(formatSize(prefetchSize)));
+    infoDisplay->append(QString("🖼️ Thumbnail Cache: %1").arg(formatSize(thumbnailsSize)));
+    infoDisplay->append(QString("📋 System Logs: %1").arg(formatSize(logsSize)));
+    
+    qint64 totalSize = tempFilesSize + recycleBinSize + browserCacheSize + 
+                      windowsTempSize + prefetchSize + thumbnailsSize + logsSize;
+    
+    infoDisplay->append("────────────────────────");
+    infoDisplay->append(QString("💾 Total space that can be freed: %1").arg(formatSize(totalSize)));
+    
+    // Sparse files, compression and hard links make the file sizes differ
+    // from the disk space they take
+    qint64 apparentSize = 0;
+    for (qint64 size : bytes) {
+        apparentSize += size;
+    }
+    if (qAbs(apparentSize - totalSize) > totalSize / 100) {
+        infoDisplay->append(QString("   (%1 of file data)").arg(formatSize(apparentSize)));
+    }
+    infoDisplay->append("\n✅ Scan complete! Select the items you want to clean and click 'Clean Selected'.");
+    
+    statusLabel->setText("Scan complete - select items to clean");
+    btnScan->setEnabled(true);
+    btnDuplicates->setEnabled(true);
+    btnRestore->setEnabled(quarantinedRuns > 0);
+    
+    // Connect checkbox signals to enable/clean button
+    connect(chkTempFiles, &QCheckBox::stateChanged, this, [this]() { updateCleanButtonState(); });
+    connect(chkRecycleBin, &QCheckBox::stateChanged, this, [this]() { updateCleanButtonState(); });
+    connect(chkBrowserCache, &QCheckBox::stateChanged, this, [this]() { updateCleanButtonState(); });
+    connect(chkWindowsTemp, &QCheckBox::stateChanged, this, [this]() { updateCleanButtonState(); });
+    connect(chkPrefetch, &QCheckBox::stateChanged, this, [this]() { updateCleanButtonState(); });
+    connect(chkThumbnails, &QCheckBox::stateChanged, this, [this]() { updateCleanButtonState(); });
+    connect(chkDNS, &QCheckBox::stateChanged, this, [this]() { updateCleanButtonState(); });
+    connect(chkLogs, &QCheckBox::stateChanged, this, [this]() { updateCleanButtonState(); });
+}
+
+void CleanerWidget::applyScanSizes(const QList<qint64> &sizes)
+{
+    QMap<QString, qint64> byOperation;
+    for (int i = 0; i < sizes.size() && i < targetOperations.size(); ++i) {
+        byOperation[targetOperations[i]] += sizes[i];
+    }
+    
+    tempFilesSize = byOperation.value("temp");
+    recycleBinSize = byOperation.value("recycle");
+    browserCacheSize = byOperation.value("browser");
+    windowsTempSize = byOperation.value("wintemp");
+    prefetchSize = byOperation.value("prefetch");
+    thumbnailsSize = byOperation.value("thumbnails");
+    logsSize = byOperation.value("logs");
+}
+
+void CleanerWidget::updateSizeLabels()
+{
+    TraceSpan span("CleanerWidget::updateSizeLabels");
+    updateCheckboxText(chkTempFiles, "🗑️ Temporary Files", tempFilesSize);
+    updateCheckboxText(chkRecycleBin, RecycleBinLabel, recycleBinSize);
+    updateCheckboxText(chkBrowserCache, BrowserCacheLabel, browserCacheSize);
+    updateCheckboxText(chkWindowsTemp, WindowsTempLabel, windowsTempSize);
+    updateCheckboxText(chkPrefetch, PrefetchLabel, prefetchSize);
+    updateCheckboxText(chkThumbnails, "🖼️ Thumbnail Cache", thumbnailsSize);
+    chkDNS->setText("🔗 DNS Cache"); // DNS doesn't have a size
+    updateCheckboxText(chkLogs, "📋 System Logs", logsSize);
+}
+
+void CleanerWidget::toggleLiveSizes(bool enabled)
+{
+    if (enabled) {
+        infoDisplay->append("👁️ Live sizes enabled - tracking starts with the next scan");
+    } else if (liveTracker) {
+        stopLiveTracking();
+        infoDisplay->append("👁️ Live sizes disabled");
+    }
+}
+
+void CleanerWidget::refreshLiveSizes()
+{
+    if (!liveTracker) return;
+    
+    QList<qint64> bytes;
+    QList<qint64> allocated;
+    for (int i = 0; i < liveTracker->rootCount(); ++i) {
+        // The tracker sees whole folders, keep the scan's count where the
+        // rules only take some of the files
+        if (targetFiltered.value(i)) {
+            bytes << targetBytes.value(i);
+            allocated << targetAllocated.value(i);
+        } else {
+            const ScanTotals totals = liveTracker->rootTotals(i);
+            bytes << totals.bytes;
+            allocated << totals.allocated;
+        }
+    }
+    targetBytes = bytes;
+    targetAllocated = allocated;
+    applyScanSizes(allocated);
+    updateSizeLabels();
+}
+
+void CleanerWidget::stopLiveTracking()
+{
+    if (liveTracker) {
+        liveTracker->stop();
+        delete liveTracker;
+        liveTracker = nullptr;
+    }
 }
 
 void CleanerWidget::updateCleanButtonState()
@@ -565,32 +790,6 @@ void CleanerWidget::cleanSelected()
         return;
     }
     
-    infoDisplay->append("\n🧹 Starting cleanup process...\n");
-    
-    btnScan->setEnabled(false);
-    btnClean->setEnabled(false);
-    btnSelectAll->setEnabled(false);
-    btnDeselectAll->setEnabled(false);
-    
-    // Disable all checkboxes during cleanup
-    chkTempFiles->setEnabled(false);
-    chkRecycleBin->setEnabled(false);
-    chkBrowserCache->setEnabled(false);
-    chkWindowsTemp->setEnabled(false);
-    chkPrefetch->setEnabled(false);
-    chkThumbnails->setEnabled(false);
-    chkDNS->setEnabled(false);
-    chkLogs->setEnabled(false);
-    
-    progressBar->setVisible(true);
-    progressBar->setValue(0);
-    
-    progressTimer = new QTimer(this);
-    progressValue = 0;
-    
-    connect(progressTimer, &QTimer::timeout, this, &CleanerWidget::updateCleanupProgress);
-    progressTimer->start(30);
-    
     // Use a list to track cleanup operations
     QStringList cleanupOperations;
     
@@ -619,244 +818,341 @@ void CleanerWidget::cleanSelected()
         cleanupOperations << "logs";
     }
     
-    // Process cleanup operations one by one
-    processCleanupOperations(cleanupOperations, 0);
+    infoDisplay->append("\n🧹 Starting cleanup process...\n");
+    startCleanup(cleanupOperations, false);
 }
 
-void CleanerWidget::processCleanupOperations(const QStringList &operations, int index)
+void CleanerWidget::onScheduledCleanup(const QStringList &operations, const QString &reason)
 {
-    if (index >= operations.size()) {
-        // All operations completed
-        progressTimer->stop();
-        progressBar->setValue(100);
-        
-        QTimer::singleShot(500, this, [this]() {
-            progressBar->setVisible(false);
-            infoDisplay->append("\n✅ Cleanup completed successfully!");
-            infoDisplay->append("✨ Your system should now be faster and cleaner!");
-            statusLabel->setText("Cleanup completed successfully");
-            
-            // Re-enable controls
-            btnScan->setEnabled(true);
-            btnSelectAll->setEnabled(true);
-            btnDeselectAll->setEnabled(true);
-            
-            // Re-enable checkboxes
-            chkTempFiles->setEnabled(true);
-            chkRecycleBin->setEnabled(true);
-            chkBrowserCache->setEnabled(true);
-            chkWindowsTemp->setEnabled(true);
-            chkPrefetch->setEnabled(true);
-            chkThumbnails->setEnabled(true);
-            chkDNS->setEnabled(true);
-            chkLogs->setEnabled(true);
-            
-            // Keep Clean button disabled until new selection
-            btnClean->setEnabled(false);
-        });
+    if (scanning || cleaning || findingDuplicates) {
+        infoDisplay->append(QString("\n⏰ Skipped the cleanup %1, another operation is running").arg(reason));
         return;
     }
-    
-    QString operation = operations[index];
-    int progressStep = (index + 1) * (100 / operations.size());
-    
-    // Update progress
-    progressValue = progressStep - (100 / operations.size());
-    progressBar->setValue(progressValue);
-    
-    // Execute the cleanup operation
-    if (operation == "temp") {
-        cleanTempFiles();
-    } else if (operation == "recycle") {
-        cleanRecycleBin();
-    } else if (operation == "browser") {
-        cleanBrowserCache();
-    } else if (operation == "wintemp") {
-        cleanWindowsTemp();
-    } else if (operation == "prefetch") {
-        cleanPrefetch();
-    } else if (operation == "thumbnails") {
-        cleanThumbnails();
-    } else if (operation == "dns") {
-        cleanDNS();
-    } else if (operation == "logs") {
-        cleanLogs();
-    }
-    
-    // Process next operation after a delay
-    QTimer::singleShot(1500, this, [this, operations, index]() {
-        processCleanupOperations(operations, index + 1);
-    });
+
+    infoDisplay->append(QString("\n⏰ Starting a background cleanup, %1...\n").arg(reason));
+    startCleanup(operations, true);
 }
 
-void CleanerWidget::cleanTempFiles()
+void CleanerWidget::updateSpaceTrend()
 {
-    infoDisplay->append("🗑️ Cleaning temporary files...");
-    
-    // Clean user temp files
-    QString tempPath = QDir::tempPath();
-    QDir tempDir(tempPath);
-    
-    if (tempDir.exists()) {
-        QFileInfoList files = tempDir.entryInfoList(QDir::Files | QDir::NoDotAndDotDot);
-        int deletedCount = 0;
-        
-        for (const QFileInfo &file : files) {
-            if (file.isReadable() && file.isWritable()) {
-                if (deleteFileWithRetry(file.absoluteFilePath())) {
-                    deletedCount++;
-                }
-            }
+    TraceSpan span("CleanerWidget::updateSpaceTrend");
+    if (trendVolumes.isEmpty()) {
+        for (const CleanupWorker::ScanTarget &target : worker->scanTargets()) {
+            QStorageInfo volume(target.path);
+            if (volume.isValid() && !trendVolumes.contains(volume.rootPath())) trendVolumes << volume.rootPath();
+        }
+    }
+
+    const qint64 SecondsPerDay = 24 * 60 * 60;
+    QStringList lines;
+    bool urgent = false;
+    for (const QString &volume : trendVolumes) {
+        const SpaceHistory::Forecast trend = scheduler->forecast(volume);
+        if (trend.freeBytes < 0) continue;
+
+        QString line = QString("💽 %1: %2 free").arg(QDir::toNativeSeparators(volume)).arg(formatSize(trend.freeBytes));
+        if (trend.samples == 0) {
+            line += ", not enough history for a forecast yet";
+        } else if (trend.secondsToFull < 0 || trend.secondsToFull > 365 * SecondsPerDay) {
+            line += ", steady";
+        } else {
+            const qint64 days = trend.secondsToFull / SecondsPerDay;
+            line += QString(", shrinking by %1 a day, full in about %2")
+                    .arg(formatSize(static_cast<qint64>(-trend.bytesPerDay)))
+                    .arg(days >= 2 ? QString("%1 days").arg(days)
+                                   : QString("%1 hours").arg(trend.secondsToFull / 3600));
+            urgent = urgent || days < 7;
         }
-        infoDisplay->append(QString("   ✓ Deleted %1 temporary files").arg(deletedCount));
+        lines << line;
     }
+    publishVolumeMetrics();
+    if (lines.isEmpty()) return;
+
+    spaceTrendLabel->setText(lines.join('\n'));
+    spaceTrendLabel->setStyleSheet(QString("font-size: 12px; color: %1; padding: 8px; border: none;")
+                                   .arg(urgent ? "#e74c3c" : "#7f8c8d"));
 }
 
-void CleanerWidget::cleanRecycleBin()
+void CleanerWidget::setMetrics(MetricsServer *server)
 {
-    infoDisplay->append("🗂️ Emptying recycle bin...");
-    
-    // Use PowerShell to clear recycle bin
-    QString output = executeCommand("powershell", QStringList() << "-Command" << 
-        "Clear-RecycleBin -Force -ErrorAction SilentlyContinue");
-    
-    if (!output.contains("error", Qt::CaseInsensitive)) {
-        infoDisplay->append("   ✓ Recycle bin emptied");
-    } else {
-        infoDisplay->append("   ⚠️ Recycle bin may require administrator rights");
+    metrics = server;
+    if (!targetOperations.isEmpty() && !targetFiles.isEmpty()) publishScanMetrics();
+    publishVolumeMetrics();
+}
+
+void CleanerWidget::publishScanMetrics()
+{
+    if (!metrics) return;
+
+    // Summed per operation; several folders can belong to one
+    QStringList operations;
+    QList<qint64> reclaimable;
+    QList<qint64> files;
+    for (int i = 0; i < targetOperations.size(); ++i) {
+        int index = operations.indexOf(targetOperations[i]);
+        if (index < 0) {
+            index = operations.size();
+            operations << targetOperations[i];
+            reclaimable << 0;
+            files << 0;
+        }
+        reclaimable[index] += targetAllocated.value(i);
+        files[index] += targetFiles.value(i);
+    }
+
+    MetricsWriter writer;
+    writer.family("raptor_cleanup_reclaimable_bytes", "gauge", "Disk space the last scan found per cleanup operation");
+    for (int i = 0; i < operations.size(); ++i) {
+        writer.sample("raptor_cleanup_reclaimable_bytes", reclaimable[i], {{"operation", operations[i].toStdString()}});
+    }
+    writer.family("raptor_cleanup_files", "gauge", "Files the last scan found per cleanup operation");
+    for (int i = 0; i < operations.size(); ++i) {
+        writer.sample("raptor_cleanup_files", files[i], {{"operation", operations[i].toStdString()}});
+    }
+    metrics->publish("cleanup", writer.text());
+}
+
+void CleanerWidget::publishVolumeMetrics()
+{
+    if (!metrics) return;
+
+    QList<QPair<QString, SpaceHistory::Forecast>> trends;
+    for (const QString &volume : trendVolumes) {
+        const SpaceHistory::Forecast trend = scheduler->forecast(volume);
+        if (trend.freeBytes >= 0) trends << qMakePair(volume, trend);
+    }
+
+    MetricsWriter writer;
+    writer.family("raptor_volume_free_bytes", "gauge", "Free space of the volumes the cleanup targets live on");
+    for (const auto &trend : trends) {
+        writer.sample("raptor_volume_free_bytes", trend.second.freeBytes, {{"volume", trend.first.toStdString()}});
+    }
+    writer.family("raptor_volume_size_bytes", "gauge", "Size of the volumes the cleanup targets live on");
+    for (const auto &trend : trends) {
+        writer.sample("raptor_volume_size_bytes", trend.second.totalBytes, {{"volume", trend.first.toStdString()}});
+    }
+    // Only once there is enough history for a forecast
+    writer.family("raptor_volume_free_bytes_per_day", "gauge", "Trend of the free space, negative while the volume fills up");
+    for (const auto &trend : trends) {
+        if (trend.second.samples == 0) continue;
+        writer.sample("raptor_volume_free_bytes_per_day", trend.second.bytesPerDay, {{"volume", trend.first.toStdString()}});
+    }
+    writer.family("raptor_volume_seconds_to_full", "gauge", "Forecast time until the volume is full, only while it fills up");
+    for (const auto &trend : trends) {
+        if (trend.second.samples == 0 || trend.second.secondsToFull < 0) continue;
+        writer.sample("raptor_volume_seconds_to_full", trend.second.secondsToFull, {{"volume", trend.first.toStdString()}});
     }
+    metrics->publish("volumes", writer.text());
 }
 
-void CleanerWidget::cleanBrowserCache()
+void CleanerWidget::startCleanup(const QStringList &cleanupOperations, bool lowImpact)
 {
-    infoDisplay->append("🌐 Clearing browser cache...");
+    cleaning = true;
     
-    int deletedCount = 0;
+    btnScan->setEnabled(false);
+    btnClean->setEnabled(false);
+    btnSelectAll->setEnabled(false);
+    btnDeselectAll->setEnabled(false);
+    btnDuplicates->setEnabled(false);
+    btnRestore->setEnabled(false);
     
-    // Browser cache locations
-    QString localAppData = QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation);
-    QStringList cachePaths = {
-        localAppData + "/Google/Chrome/User Data/Default/Cache",
-        localAppData + "/Microsoft/Edge/User Data/Default/Cache",
-        QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/Mozilla/Firefox"
-    };
+    chkLiveSizes->setEnabled(false);
+    btnCancel->setEnabled(true);
+    btnCancel->setVisible(true);
     
-    for (const QString &cachePath : cachePaths) {
-        QDir cacheDir(cachePath);
-        if (cacheDir.exists()) {
-            QFileInfoList files = cacheDir.entryInfoList(QDir::Files | QDir::NoDotAndDotDot);
-            for (const QFileInfo &file : files) {
-                if (file.isReadable() && file.isWritable()) {
-                    if (deleteFileWithRetry(file.absoluteFilePath())) {
-                        deletedCount++;
-                    }
-                }
-            }
-        }
+    // Disable all checkboxes during cleanup
+    chkTempFiles->setEnabled(false);
+    chkRecycleBin->setEnabled(false);
+    chkBrowserCache->setEnabled(false);
+    chkWindowsTemp->setEnabled(false);
+    chkPrefetch->setEnabled(false);
+    chkThumbnails->setEnabled(false);
+    chkDNS->setEnabled(false);
+    chkLogs->setEnabled(false);
+    
+    progressBar->setVisible(true);
+    progressBar->setValue(0);
+    
+    // Progress is measured against what the last scan found
+    qint64 totalBytes = 0;
+    qint64 totalFiles = 0;
+    for (int i = 0; i < targetOperations.size(); ++i) {
+        if (!cleanupOperations.contains(targetOperations[i])) continue;
+        totalBytes += targetBytes.value(i);
+        totalFiles += targetFiles.value(i);
     }
     
-    infoDisplay->append(QString("   ✓ Deleted %1 browser cache files").arg(deletedCount));
+    // Process cleanup operations one by one on the worker thread
+    CleanupWorker *cleanWorker = worker;
+    const CleanupScheduler::Settings settings = scheduler->settings();
+    worker->resetCancel();
+    QMetaObject::invokeMethod(worker, [cleanWorker, cleanupOperations, totalBytes, totalFiles, lowImpact, settings]() {
+        cleanWorker->setLowImpact(lowImpact, settings.operationsPerSecond, settings.pressureLimit);
+        cleanWorker->clean(cleanupOperations, totalBytes, totalFiles);
+    }, Qt::QueuedConnection);
 }
 
-void CleanerWidget::cleanWindowsTemp()
+void CleanerWidget::onCleanupProgress(qint64 bytesDone, qint64 bytesTotal, qint64 filesDone, qint64 filesTotal)
 {
-    infoDisplay->append("💻 Cleaning Windows temp files...");
-    
-    QDir winTempDir("C:/Windows/Temp");
-    if (winTempDir.exists()) {
-        int deletedCount = 0;
-        QFileInfoList files = winTempDir.entryInfoList(QDir::Files | QDir::NoDotAndDotDot);
-        
-        for (const QFileInfo &file : files) {
-            if (file.isReadable() && file.isWritable()) {
-                if (deleteFileWithRetry(file.absoluteFilePath())) {
-                    deletedCount++;
-                }
-            }
-        }
-        infoDisplay->append(QString("   ✓ Deleted %1 Windows temp files").arg(deletedCount));
+    int percent = 0;
+    if (bytesTotal > 0) {
+        percent = static_cast<int>(qMin<qint64>(100, bytesDone * 100 / bytesTotal));
+    } else if (filesTotal > 0) {
+        percent = static_cast<int>(qMin<qint64>(100, filesDone * 100 / filesTotal));
     }
+    progressBar->setValue(percent);
+    statusLabel->setText(QString("Cleaning... %1 of %2 freed (%3 of %4 files)")
+                         .arg(formatSize(bytesDone)).arg(formatSize(bytesTotal))
+                         .arg(filesDone).arg(filesTotal));
 }
 
-void CleanerWidget::cleanPrefetch()
+void CleanerWidget::onCleanFinished(bool canceled)
 {
-    infoDisplay->append("⚡ Cleaning prefetch files...");
+    TraceSpan span("CleanerWidget::onCleanFinished");
+    cleaning = false;
+    // All operations completed
+    progressBar->setValue(canceled ? progressBar->value() : 100);
+    btnCancel->setVisible(false);
+    chkLiveSizes->setEnabled(LiveSizeTracker::isSupported());
     
-    QDir prefetchDir("C:/Windows/Prefetch");
-    if (prefetchDir.exists()) {
-        int deletedCount = 0;
-        QFileInfoList files = prefetchDir.entryInfoList(QStringList() << "*.pf", QDir::Files | QDir::NoDotAndDotDot);
-        
-        for (const QFileInfo &file : files) {
-            if (file.isReadable() && file.isWritable()) {
-                if (deleteFileWithRetry(file.absoluteFilePath())) {
-                    deletedCount++;
-                }
-            }
+    QTimer::singleShot(500, this, [this, canceled]() {
+        progressBar->setVisible(false);
+        if (canceled) {
+            infoDisplay->append("\n⏹️ Cleanup canceled - remaining items were left untouched");
+            statusLabel->setText("Cleanup canceled");
+        } else {
+            infoDisplay->append("\n✅ Cleanup completed successfully!");
+            infoDisplay->append("✨ Your system should now be faster and cleaner!");
+            statusLabel->setText("Cleanup completed successfully");
         }
-        infoDisplay->append(QString("   ✓ Deleted %1 prefetch files").arg(deletedCount));
-    }
+        
+        // Re-enable controls
+        btnScan->setEnabled(true);
+        btnSelectAll->setEnabled(true);
+        btnDeselectAll->setEnabled(true);
+        btnDuplicates->setEnabled(true);
+        quarantinedRuns = worker->quarantinedRuns();
+        btnRestore->setEnabled(quarantinedRuns > 0);
+        
+        // Re-enable checkboxes
+        chkTempFiles->setEnabled(true);
+        chkRecycleBin->setEnabled(true);
+        chkBrowserCache->setEnabled(true);
+        chkWindowsTemp->setEnabled(true);
+        chkPrefetch->setEnabled(true);
+        chkThumbnails->setEnabled(true);
+        chkDNS->setEnabled(true);
+        chkLogs->setEnabled(true);
+        
+        // Keep Clean button disabled until new selection
+        btnClean->setEnabled(false);
+    });
 }
 
-void CleanerWidget::cleanThumbnails()
+void CleanerWidget::findDuplicates()
 {
-    infoDisplay->append("🖼️ Clearing thumbnail cache...");
-    
-    QString thumbPath = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/Microsoft/Windows/Explorer";
-    QDir thumbDir(thumbPath);
-    
-    if (thumbDir.exists()) {
-        int deletedCount = 0;
-        QFileInfoList files = thumbDir.entryInfoList(QStringList() << "thumbcache_*.db", QDir::Files);
-        
-        for (const QFileInfo &file : files) {
-            if (file.isReadable() && file.isWritable()) {
-                if (deleteFileWithRetry(file.absoluteFilePath())) {
-                    deletedCount++;
-                }
-            }
-        }
-        infoDisplay->append(QString("   ✓ Deleted %1 thumbnail cache files").arg(deletedCount));
-    }
+    infoDisplay->append("\n🔁 Looking for duplicate files in " + QDir::toNativeSeparators(QDir::homePath()) + "...");
+    infoDisplay->append("Only files that share a size are read, and only as far as needed to tell them apart.\n");
+
+    btnScan->setEnabled(false);
+    btnClean->setEnabled(false);
+    btnDuplicates->setEnabled(false);
+    btnRestore->setEnabled(false);
+    btnCancel->setEnabled(true);
+    btnCancel->setVisible(true);
+
+    progressBar->setVisible(true);
+    progressBar->setRange(0, 0);
+    findingDuplicates = true;
+    statusTimer->start(100);
+
+    CleanupWorker *duplicateWorker = worker;
+    QStringList roots = QStringList() << QDir::homePath();
+    worker->resetCancel();
+    QMetaObject::invokeMethod(worker, [duplicateWorker, roots]() {
+        duplicateWorker->findDuplicates(roots);
+    }, Qt::QueuedConnection);
 }
 
-void CleanerWidget::cleanDNS()
+void CleanerWidget::onDuplicatesFinished(bool canceled)
 {
-    infoDisplay->append("🔗 Flushing DNS cache...");
-    
-    QString output = executeCommand("ipconfig", QStringList() << "/flushdns");
-    if (output.contains("successfully", Qt::CaseInsensitive)) {
-        infoDisplay->append("   ✓ DNS cache flushed successfully");
+    findingDuplicates = false;
+    statusTimer->stop();
+    progressBar->setRange(0, 100);
+    progressBar->setVisible(false);
+    btnCancel->setVisible(false);
+
+    if (canceled) {
+        infoDisplay->append("\n⏹️ Duplicate search canceled");
+        statusLabel->setText("Duplicate search canceled");
     } else {
-        infoDisplay->append("   ⚠️ DNS flush may require administrator rights");
+        infoDisplay->append("\n✅ Duplicate search complete! Review the groups above before removing any copies.");
+        statusLabel->setText("Duplicate search complete");
     }
+
+    btnScan->setEnabled(true);
+    btnDuplicates->setEnabled(true);
+    btnRestore->setEnabled(quarantinedRuns > 0);
+    updateCleanButtonState();
 }
 
-void CleanerWidget::cleanLogs()
+void CleanerWidget::updateQuarantine()
 {
-    infoDisplay->append("📋 Cleaning log files...");
-    
-    QDir logsDir("C:/Windows/Logs");
-    if (logsDir.exists()) {
-        int deletedCount = 0;
-        
-        // Only delete log files in subdirectories, not the directories themselves
-        QFileInfoList entries = logsDir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
-        for (const QFileInfo &entry : entries) {
-            if (entry.isDir()) {
-                QDir subDir(entry.absoluteFilePath());
-                QFileInfoList files = subDir.entryInfoList(QDir::Files);
-                for (const QFileInfo &file : files) {
-                    if (file.isReadable() && file.isWritable()) {
-                        if (deleteFileWithRetry(file.absoluteFilePath())) {
-                            deletedCount++;
-                        }
-                    }
-                }
-            }
-        }
-        infoDisplay->append(QString("   ✓ Deleted %1 log files").arg(deletedCount));
-    }
+    CleanupWorker *quarantineWorker = worker;
+    const bool enabled = chkQuarantine->isChecked();
+    const int days = spnQuarantineDays->value();
+    QMetaObject::invokeMethod(worker, [quarantineWorker, enabled, days]() {
+        quarantineWorker->setQuarantine(enabled, days);
+    }, Qt::QueuedConnection);
+}
+
+void CleanerWidget::updateCacheBudget()
+{
+    CleanupWorker *budgetWorker = worker;
+    const qint64 budget = chkTrimCaches->isChecked() ? qint64(spnCacheBudget->value()) * 1024 * 1024 : -1;
+    QMetaObject::invokeMethod(worker, [budgetWorker, budget]() {
+        budgetWorker->setCacheBudget(budget);
+    }, Qt::QueuedConnection);
+}
+
+void CleanerWidget::restoreLastCleanup()
+{
+    btnScan->setEnabled(false);
+    btnClean->setEnabled(false);
+    btnDuplicates->setEnabled(false);
+    btnRestore->setEnabled(false);
+    statusLabel->setText("Restoring...");
+
+    CleanupWorker *restoreWorker = worker;
+    QMetaObject::invokeMethod(worker, [restoreWorker]() {
+        restoreWorker->restoreLastRun();
+    }, Qt::QueuedConnection);
+}
+
+void CleanerWidget::onRestoreFinished(int runsLeft)
+{
+    quarantinedRuns = runsLeft;
+    infoDisplay->append("\n✅ Restore complete! Scan again to see the current sizes.");
+    statusLabel->setText("Restore complete");
+
+    btnScan->setEnabled(true);
+    btnDuplicates->setEnabled(true);
+    btnRestore->setEnabled(quarantinedRuns > 0);
+    updateCleanButtonState();
+}
+
+void CleanerWidget::cancelOperation()
+{
+    worker->cancel();
+    btnCancel->setEnabled(false);
+    statusLabel->setText("Canceling...");
+}
+
+void CleanerWidget::appendLogLines(const QStringList &lines)
+{
+    TraceSpan span("CleanerWidget::appendLogLines");
+    // One append per batch keeps the text edit from relayouting per line
+    infoDisplay->append(lines.join('\n'));
 }
 
 void CleanerWidget::selectAll()
@@ -889,13 +1185,14 @@ void CleanerWidget::deselectAll()
     btnClean->setEnabled(false);
 }
 
-void CleanerWidget::updateCleanupProgress()
+void CleanerWidget::pollScanStatus()
 {
-    progressValue += 1;
-    if (progressValue > 100) {
-        progressValue = 100;
+    if (scanning) {
+        statusLabel->setText(QString("Scanning... %1 files found").arg(worker->filesScanned()));
+    } else if (findingDuplicates) {
+        statusLabel->setText(QString("Finding duplicates... %1 files scanned, %2 read")
+                             .arg(worker->filesScanned()).arg(formatSize(worker->bytesHashed())));
     }
-    progressBar->setValue(progressValue);
 }
 
 void CleanerWidget::clearLog()
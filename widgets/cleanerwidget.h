@@ -14,6 +14,12 @@ class QFrame;
 class QScrollArea;
 class QCheckBox;
 class QProgressBar;
+class QSpinBox;
+class LiveSizeTracker;
+class CleanupWorker;
+class CleanupScheduler;
+class MetricsServer;
+class QThread;
 
 class CleanerWidget : public QWidget
 {
@@ -23,13 +29,32 @@ public:
     explicit CleanerWidget(QWidget *parent = nullptr);
     ~CleanerWidget();
 
+    // Publishes scan sizes and free space trends there; may be null
+    void setMetrics(MetricsServer *server);
+
 private slots:
     void scanSystem();
     void cleanSelected();
     void selectAll();
     void deselectAll();
-    void updateCleanupProgress();
+    void pollScanStatus();
     void clearLog();
+    void toggleLiveSizes(bool enabled);
+    void refreshLiveSizes();
+    void cancelOperation();
+    void appendLogLines(const QStringList &lines);
+    void onScanFinished(const QList<qint64> &bytes, const QList<qint64> &allocated,
+                        const QList<qint64> &files, bool canceled);
+    void onCleanupProgress(qint64 bytesDone, qint64 bytesTotal, qint64 filesDone, qint64 filesTotal);
+    void onCleanFinished(bool canceled);
+    void findDuplicates();
+    void onDuplicatesFinished(bool canceled);
+    void updateQuarantine();
+    void updateCacheBudget();
+    void restoreLastCleanup();
+    void onRestoreFinished(int runsLeft);
+    void onScheduledCleanup(const QStringList &operations, const QString &reason);
+    void updateSpaceTrend();
 
 private:
     void setupUI();
@@ -38,20 +63,14 @@ private:
     void createProgressSection();
     void createLogSection();
     
-    void processCleanupOperations(const QStringList &operations, int index);
-    void cleanTempFiles();
-    void cleanRecycleBin();
-    void cleanBrowserCache();
-    void cleanWindowsTemp();
-    void cleanPrefetch();
-    void cleanThumbnails();
-    void cleanDNS();
-    void cleanLogs();
-    bool deleteFileWithRetry(const QString &filePath);
     void updateCleanButtonState();
+    void startCleanup(const QStringList &operations, bool lowImpact);
+    void publishScanMetrics();
+    void publishVolumeMetrics();
 
-    QString executeCommand(const QString &command, const QStringList &arguments = QStringList());
-    qint64 getFolderSize(const QString &path);
+    void applyScanSizes(const QList<qint64> &sizes);
+    void updateSizeLabels();
+    void stopLiveTracking();
     QString formatSize(qint64 bytes);
     void updateCheckboxText(QCheckBox* checkbox, const QString& baseText, qint64 size);
 
@@ -70,16 +89,25 @@ private:
     QCheckBox *chkThumbnails;
     QCheckBox *chkDNS;
     QCheckBox *chkLogs;
+    QCheckBox *chkCompressLogs;
+    QCheckBox *chkTrimCaches;
+    QSpinBox *spnCacheBudget;
+    QLabel *spaceTrendLabel;
 
     QPushButton *btnScan;
     QPushButton *btnClean;
     QPushButton *btnSelectAll;
     QPushButton *btnDeselectAll;
+    QPushButton *btnCancel;
+    QPushButton *btnDuplicates;
+    QPushButton *btnRestore;
+    QCheckBox *chkLiveSizes;
+    QCheckBox *chkQuarantine;
+    QSpinBox *spnQuarantineDays;
 
-    QTimer *progressTimer;
-    int progressValue;
+    QTimer *statusTimer;
     
-    // Store scanned sizes
+    // Store scanned sizes, as space taken on disk
     qint64 tempFilesSize;
     qint64 recycleBinSize;
     qint64 browserCacheSize;
@@ -87,6 +115,26 @@ private:
     qint64 prefetchSize;
     qint64 thumbnailsSize;
     qint64 logsSize;
+
+    // Per-target totals from the last scan, in CleanupWorker::scanTargets() order
+    QStringList targetOperations;
+    QList<bool> targetFiltered;
+    QList<qint64> targetBytes;        // apparent size, what deletion progress counts
+    QList<qint64> targetAllocated;    // disk space, what the size labels show
+    QList<qint64> targetFiles;
+
+    // Keeps the sizes above current between scans when live mode is on
+    LiveSizeTracker *liveTracker;
+
+    CleanupWorker *worker;
+    QThread *workerThread;
+    CleanupScheduler *scheduler;
+    QStringList trendVolumes;       // volumes the cleanup targets live on
+    bool scanning;
+    bool cleaning;
+    bool findingDuplicates;
+    int quarantinedRuns;
+    MetricsServer *metrics;
 };
 
 #endif // CLEANERWIDGET_H
\ No newline at end of file
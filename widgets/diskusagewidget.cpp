@@ -0,0 +1,423 @@
+#include "diskusagewidget.h"
+#include "../core/dirscanner.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QPushButton>
+#include <QComboBox>
+#include <QLabel>
+#include <QProgressBar>
+#include <QTabWidget>
+#include <QTreeWidget>
+#include <QHeaderView>
+#include <QStorageInfo>
+#include <QDir>
+#include <QThread>
+
+DiskUsageWidget::DiskUsageWidget(QWidget *parent)
+    : QWidget(parent)
+    , mainLayout(nullptr)
+    , rootCombo(nullptr)
+    , btnAnalyze(nullptr)
+    , btnCancel(nullptr)
+    , statusLabel(nullptr)
+    , progressBar(nullptr)
+    , resultTabs(nullptr)
+    , folderTree(nullptr)
+    , fileList(nullptr)
+    , directoryList(nullptr)
+    , extensionList(nullptr)
+    , ownerList(nullptr)
+    , progressTimer(nullptr)
+    , worker(nullptr)
+    , workerThread(nullptr)
+    , activeScanner(nullptr)
+    , analyzing(false)
+{
+    setupUI();
+
+    // Scans run one at a time on a worker thread; results come back as queued calls
+    workerThread = new QThread(this);
+    worker = new QObject();
+    worker->moveToThread(workerThread);
+    connect(workerThread, &QThread::finished, worker, &QObject::deleteLater);
+    workerThread->start();
+}
+
+DiskUsageWidget::~DiskUsageWidget()
+{
+    if (progressTimer) progressTimer->stop();
+    cancelAnalysis();
+    workerThread->quit();
+    workerThread->wait();
+}
+
+void DiskUsageWidget::setupUI()
+{
+    mainLayout = new QVBoxLayout(this);
+    mainLayout->setSpacing(15);
+    mainLayout->setContentsMargins(20, 20, 20, 20);
+
+    setStyleSheet("background-color: #ecf0f1;");
+
+    QLabel *title = new QLabel("Disk Usage");
+    title->setStyleSheet("font-size: 24px; font-weight: bold; color: #2c3e50;");
+    mainLayout->addWidget(title);
+
+    createControls();
+    createProgressSection();
+    createResultTabs();
+}
+
+void DiskUsageWidget::createControls()
+{
+    QHBoxLayout *controlLayout = new QHBoxLayout();
+
+    rootCombo = new QComboBox();
+    rootCombo->setStyleSheet("QComboBox { background-color: white; padding: 8px; font-size: 12px; }");
+    rootCombo->addItem("🏠 Home folder", QDir::homePath());
+    for (const QStorageInfo &volume : QStorageInfo::mountedVolumes()) {
+        if (!volume.isValid() || !volume.isReady()) continue;
+        rootCombo->addItem(QString("💽 %1 (%2) - %3 free of %4")
+                           .arg(volume.displayName())
+                           .arg(QDir::toNativeSeparators(volume.rootPath()))
+                           .arg(formatSize(volume.bytesAvailable()))
+                           .arg(formatSize(volume.bytesTotal())),
+                           volume.rootPath());
+    }
+
+    btnAnalyze = new QPushButton("📊 Analyze");
+    btnCancel = new QPushButton("⏹ Cancel");
+
+    btnAnalyze->setStyleSheet(
+        "QPushButton {"
+        "    background-color: #3498db;"
+        "    color: white;"
+        "    border: none;"
+        "    padding: 12px 20px;"
+        "    border-radius: 5px;"
+        "    font-weight: bold;"
+        "    font-size: 12px;"
+        "}"
+        "QPushButton:hover {"
+        "    background-color: #2980b9;"
+        "}"
+        "QPushButton:disabled {"
+        "    background-color: #bdc3c7;"
+        "}");
+    btnCancel->setStyleSheet(
+        "QPushButton {"
+        "    background-color: #e74c3c;"
+        "    color: white;"
+        "    border: none;"
+        "    padding: 12px 20px;"
+        "    border-radius: 5px;"
+        "    font-weight: bold;"
+        "    font-size: 12px;"
+        "}"
+        "QPushButton:hover {"
+        "    background-color: #c0392b;"
+        "}"
+        "QPushButton:disabled {"
+        "    background-color: #bdc3c7;"
+        "}");
+    btnCancel->setVisible(false);
+
+    connect(btnAnalyze, &QPushButton::clicked, this, &DiskUsageWidget::analyze);
+    connect(btnCancel, &QPushButton::clicked, this, &DiskUsageWidget::cancelAnalysis);
+
+    controlLayout->addWidget(rootCombo, 1);
+    controlLayout->addWidget(btnAnalyze);
+    controlLayout->addWidget(btnCancel);
+
+    mainLayout->addLayout(controlLayout);
+}
+
+void DiskUsageWidget::createProgressSection()
+{
+    statusLabel = new QLabel("Pick a folder or drive and click 'Analyze'");
+    statusLabel->setStyleSheet("font-size: 13px; color: #2c3e50; font-weight: bold;");
+
+    progressBar = new QProgressBar();
+    progressBar->setStyleSheet(
+        "QProgressBar {"
+        "    border: 2px solid #bdc3c7;"
+        "    border-radius: 5px;"
+        "    text-align: center;"
+        "    background-color: #ecf0f1;"
+        "    height: 20px;"
+        "}"
+        "QProgressBar::chunk {"
+        "    background-color: #2ecc71;"
+        "    border-radius: 3px;"
+        "}"
+    );
+    progressBar->setVisible(false);
+
+    // Polls the scanner while it is busy
+    progressTimer = new QTimer(this);
+    connect(progressTimer, &QTimer::timeout, this, &DiskUsageWidget::updateProgress);
+
+    mainLayout->addWidget(statusLabel);
+    mainLayout->addWidget(progressBar);
+}
+
+void DiskUsageWidget::createResultTabs()
+{
+    resultTabs = new QTabWidget();
+    resultTabs->setStyleSheet("QTabWidget::pane { background-color: white; border: 1px solid #bdc3c7; }");
+
+    // Folders are expanded on demand, collapsing one frees everything below it
+    folderTree = createList(QStringList() << "Name" << "Size" << "Files" << "Share");
+    folderTree->setRootIsDecorated(true);
+    connect(folderTree, &QTreeWidget::itemExpanded, this, &DiskUsageWidget::onItemExpanded);
+    connect(folderTree, &QTreeWidget::itemCollapsed, this, &DiskUsageWidget::onItemCollapsed);
+
+    fileList = createList(QStringList() << "File" << "Size" << "Files");
+    directoryList = createList(QStringList() << "Folder" << "Size of its files" << "Files");
+    extensionList = createList(QStringList() << "Extension" << "Size" << "Files");
+    ownerList = createList(QStringList() << "Owner" << "Size" << "Files");
+
+    resultTabs->addTab(folderTree, "📁 Folders");
+    resultTabs->addTab(fileList, "📄 Largest Files");
+    resultTabs->addTab(directoryList, "🗂️ Largest Folders");
+    resultTabs->addTab(extensionList, "🏷️ By Extension");
+    resultTabs->addTab(ownerList, "👤 By Owner");
+
+    mainLayout->addWidget(resultTabs, 1);
+}
+
+QTreeWidget *DiskUsageWidget::createList(const QStringList &headers)
+{
+    QTreeWidget *list = new QTreeWidget();
+    list->setHeaderLabels(headers);
+    list->setRootIsDecorated(false);
+    list->setUniformRowHeights(true);
+    list->setStyleSheet("QTreeWidget { background-color: white; font-size: 12px; }");
+    list->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    list->header()->setStretchLastSection(false);
+    return list;
+}
+
+QString DiskUsageWidget::formatSize(qint64 bytes)
+{
+    const qint64 KB = 1024;
+    const qint64 MB = KB * 1024;
+    const qint64 GB = MB * 1024;
+
+    if (bytes >= GB) {
+        return QString("%1 GB").arg(QString::number(bytes / (double)GB, 'f', 2));
+    } else if (bytes >= MB) {
+        return QString("%1 MB").arg(QString::number(bytes / (double)MB, 'f', 2));
+    } else if (bytes >= KB) {
+        return QString("%1 KB").arg(QString::number(bytes / (double)KB, 'f', 2));
+    } else if (bytes > 0) {
+        return QString("%1 bytes").arg(bytes);
+    } else {
+        return QString("0 bytes");
+    }
+}
+
+// Runs on the worker thread
+void DiskUsageWidget::runScan(const QString &path, ScanVisitor *visitor, std::vector<ScanTotals> &totals, bool &canceled)
+{
+    DirScanner scanner;
+    scanner.setVisitor(visitor);
+    {
+        QMutexLocker locker(&scannerLock);
+        activeScanner = &scanner;
+    }
+    totals = scanner.scan({QDir::cleanPath(path).toStdString()});
+    canceled = scanner.isCanceled();
+    {
+        QMutexLocker locker(&scannerLock);
+        activeScanner = nullptr;
+    }
+}
+
+void DiskUsageWidget::analyze()
+{
+    const QString path = rootCombo->currentData().toString();
+
+    folderTree->clear();
+    fileList->clear();
+    directoryList->clear();
+    extensionList->clear();
+    ownerList->clear();
+    pendingItems.clear();
+
+    btnAnalyze->setEnabled(false);
+    rootCombo->setEnabled(false);
+    btnCancel->setEnabled(true);
+    btnCancel->setVisible(true);
+    progressBar->setVisible(true);
+    progressBar->setRange(0, 0);
+    analyzing = true;
+    progressTimer->start(100);
+
+    QMetaObject::invokeMethod(worker, [this, path]() {
+        Report report;
+        DiskUsageAnalyzer analyzer;
+        analyzer.begin({QDir::cleanPath(path).toStdString()});
+        runScan(path, &analyzer, report.totals, report.canceled);
+
+        report.level = analyzer.rootLevel(0);
+        report.files = analyzer.largestFiles();
+        report.directories = analyzer.largestDirectories();
+        report.extensions = analyzer.byExtension();
+        report.owners = analyzer.byOwner();
+
+        QMetaObject::invokeMethod(this, [this, path, report]() {
+            showReport(path, report);
+        }, Qt::QueuedConnection);
+    }, Qt::QueuedConnection);
+}
+
+void DiskUsageWidget::cancelAnalysis()
+{
+    QMutexLocker locker(&scannerLock);
+    if (activeScanner) activeScanner->cancel();
+    if (btnCancel) btnCancel->setEnabled(false);
+}
+
+void DiskUsageWidget::updateProgress()
+{
+    QMutexLocker locker(&scannerLock);
+    if (analyzing && activeScanner) {
+        statusLabel->setText(QString("Analyzing... %1 files, %2")
+                             .arg(activeScanner->filesScanned())
+                             .arg(formatSize(activeScanner->bytesScanned())));
+    }
+}
+
+void DiskUsageWidget::showReport(const QString &path, const Report &report)
+{
+    analyzing = false;
+    progressTimer->stop();
+    progressBar->setRange(0, 100);
+    progressBar->setVisible(false);
+    btnCancel->setVisible(false);
+    btnAnalyze->setEnabled(true);
+    rootCombo->setEnabled(true);
+
+    const ScanTotals totals = report.totals.empty() ? ScanTotals() : report.totals.front();
+
+    QTreeWidgetItem *root = new QTreeWidgetItem(folderTree);
+    root->setText(0, "📁 " + QDir::toNativeSeparators(path));
+    root->setText(1, formatSize(totals.bytes));
+    root->setText(2, QString::number(totals.files));
+    root->setData(0, Qt::UserRole, QDir::cleanPath(path));
+    root->setData(1, Qt::UserRole, static_cast<qint64>(totals.bytes));
+    showLevel(root, report.level);
+    root->setExpanded(true);
+
+    fillList(fileList, report.files, false);
+    fillList(directoryList, report.directories, false);
+    fillList(extensionList, report.extensions, true);
+    fillList(ownerList, report.owners, true);
+
+    QString status = QString("%1 in %2 files and %3 folders")
+                     .arg(formatSize(totals.bytes)).arg(totals.files).arg(totals.directories);
+    if (totals.errors > 0) {
+        status += QString(", %1 folders could not be read").arg(totals.errors);
+    }
+    if (report.canceled) {
+        status = "⏹️ Analysis canceled - partial results: " + status;
+    }
+    statusLabel->setText(status);
+}
+
+void DiskUsageWidget::showLevel(QTreeWidgetItem *parent, const DirectoryLevel &level)
+{
+    const qint64 parentBytes = parent->data(1, Qt::UserRole).toLongLong();
+    const QString parentPath = parent->data(0, Qt::UserRole).toString();
+
+    auto share = [parentBytes](qint64 bytes) {
+        return parentBytes > 0 ? QString::number(bytes * 100.0 / parentBytes, 'f', 1) + "%" : QString();
+    };
+
+    for (const DiskUsageItem &subdirectory : level.subdirectories) {
+        const QString name = QString::fromStdString(subdirectory.name);
+        QTreeWidgetItem *item = new QTreeWidgetItem(parent);
+        item->setText(0, "📁 " + name);
+        item->setText(1, formatSize(subdirectory.bytes));
+        item->setText(2, QString::number(subdirectory.files));
+        item->setText(3, share(subdirectory.bytes));
+        item->setData(0, Qt::UserRole, QDir(parentPath).filePath(name));
+        item->setData(1, Qt::UserRole, static_cast<qint64>(subdirectory.bytes));
+
+        // Its own subdirectories are only read when it is expanded
+        if (subdirectory.directories > 1) {
+            item->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
+        }
+    }
+
+    if (level.files.files > 0) {
+        QTreeWidgetItem *item = new QTreeWidgetItem(parent);
+        item->setText(0, QString("📄 %1 files").arg(level.files.files));
+        item->setText(1, formatSize(level.files.bytes));
+        item->setText(2, QString::number(level.files.files));
+        item->setText(3, share(level.files.bytes));
+    }
+}
+
+void DiskUsageWidget::fillList(QTreeWidget *list, const std::vector<DiskUsageItem> &items, bool grouped)
+{
+    list->clear();
+    for (const DiskUsageItem &entry : items) {
+        QString name = QString::fromStdString(entry.name);
+        QTreeWidgetItem *item = new QTreeWidgetItem(list);
+        item->setText(0, grouped ? name : QDir::toNativeSeparators(name));
+
+        // Rare groups share counters once there are many of them, see HeavyHitters
+        item->setText(1, entry.error > 0 ? "~" + formatSize(entry.bytes) : formatSize(entry.bytes));
+        item->setText(2, QString::number(entry.files));
+    }
+}
+
+void DiskUsageWidget::onItemExpanded(QTreeWidgetItem *item)
+{
+    const QString path = item->data(0, Qt::UserRole).toString();
+    if (path.isEmpty() || item->childCount() > 0) return;
+
+    QTreeWidgetItem *loading = new QTreeWidgetItem(item);
+    loading->setText(0, "Loading...");
+    pendingItems.insert(path, item);
+
+    QMetaObject::invokeMethod(worker, [this, path]() {
+        DirectoryLevelCollector collector;
+        collector.begin(1);
+        std::vector<ScanTotals> totals;
+        bool canceled = false;
+        runScan(path, &collector, totals, canceled);
+        const DirectoryLevel level = collector.level(0);
+
+        QMetaObject::invokeMethod(this, [this, path, level]() {
+            // The folder may have been collapsed or the tree rebuilt meanwhile
+            QTreeWidgetItem *item = pendingItems.take(path);
+            if (!item) return;
+            qDeleteAll(item->takeChildren());
+            showLevel(item, level);
+        }, Qt::QueuedConnection);
+    }, Qt::QueuedConnection);
+}
+
+void DiskUsageWidget::onItemCollapsed(QTreeWidgetItem *item)
+{
+    // The root stays loaded; anything deeper is read again when reopened
+    if (!item->parent()) return;
+
+    dropPendingBelow(item->data(0, Qt::UserRole).toString());
+    qDeleteAll(item->takeChildren());
+    item->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
+}
+
+void DiskUsageWidget::dropPendingBelow(const QString &path)
+{
+    for (auto it = pendingItems.begin(); it != pendingItems.end();) {
+        if (it.key() == path || it.key().startsWith(path + "/")) {
+            it = pendingItems.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef DISKUSAGEWIDGET_H
+#define DISKUSAGEWIDGET_H
+
+#include <QWidget>
+#include <QTimer>
+#include <QHash>
+#include <QMutex>
+
+#include "../core/diskusage.h"
+
+class QVBoxLayout;
+class QPushButton;
+class QComboBox;
+class QLabel;
+class QProgressBar;
+class QTabWidget;
+class QTreeWidget;
+class QTreeWidgetItem;
+class QThread;
+class DirScanner;
+
+class DiskUsageWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit DiskUsageWidget(QWidget *parent = nullptr);
+    ~DiskUsageWidget();
+
+private slots:
+    void analyze();
+    void cancelAnalysis();
+    void updateProgress();
+    void onItemExpanded(QTreeWidgetItem *item);
+    void onItemCollapsed(QTreeWidgetItem *item);
+
+private:
+    struct Report
+    {
+        std::vector<ScanTotals> totals;
+        DirectoryLevel level;
+        std::vector<DiskUsageItem> files;
+        std::vector<DiskUsageItem> directories;
+        std::vector<DiskUsageItem> extensions;
+        std::vector<DiskUsageItem> owners;
+        bool canceled = false;
+    };
+
+    void setupUI();
+    void createControls();
+    void createProgressSection();
+    void createResultTabs();
+    QTreeWidget *createList(const QStringList &headers);
+
+    void runScan(const QString &path, ScanVisitor *visitor, std::vector<ScanTotals> &totals, bool &canceled);
+    void showReport(const QString &path, const Report &report);
+    void showLevel(QTreeWidgetItem *parent, const DirectoryLevel &level);
+    void fillList(QTreeWidget *list, const std::vector<DiskUsageItem> &items, bool grouped);
+    void dropPendingBelow(const QString &path);
+    QString formatSize(qint64 bytes);
+
+    QVBoxLayout *mainLayout;
+    QComboBox *rootCombo;
+    QPushButton *btnAnalyze;
+    QPushButton *btnCancel;
+    QLabel *statusLabel;
+    QProgressBar *progressBar;
+    QTabWidget *resultTabs;
+    QTreeWidget *folderTree;
+    QTreeWidget *fileList;
+    QTreeWidget *directoryList;
+    QTreeWidget *extensionList;
+    QTreeWidget *ownerList;
+    QTimer *progressTimer;
+
+    // Folders waiting for their level to come back from the worker
+    QHash<QString, QTreeWidgetItem *> pendingItems;
+
+    QObject *worker;
+    QThread *workerThread;
+    DirScanner *activeScanner;
+    QMutex scannerLock;
+    bool analyzing;
+};
+
+#endif // DISKUSAGEWIDGET_H
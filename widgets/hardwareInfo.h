@@ -12,6 +12,11 @@
 #include <QTimer>
 #include <QGridLayout>
 
+#include "../core/hardwarecollector.h"
+#include "../core/samplingscheduler.h"
+
+class MetricsServer;
+
 class HardwareInfo : public QWidget
 {
     Q_OBJECT
@@ -20,23 +25,19 @@ public:
     explicit HardwareInfo(QWidget *parent = nullptr);
     ~HardwareInfo();
 
-private slots:
-    void updateHardwareInfo();
+    // Publishes the hardware summary there; may be null
+    void setMetrics(MetricsServer *server);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
 
 private:
     void setupUI();
     void fetchHardwareData();
-    QString formatBytes(quint64 bytes);
-    QString executeCommand(const QString &command, const QStringList &arguments = QStringList());
-    
-    // Hardware fetching functions
-    void fetchCPUInfo();
-    void fetchGPUInfo();
-    void fetchMotherboardInfo();
-    void fetchRAMInfo();
-    void fetchStorageInfo();
-    void fetchNetworkInfo();
-    void fetchUSBInfo();
+    void showReport(const HardwareReport &collected);
+    void updateHardwareInfo();
+    void publishMetrics();
 
     // UI elements
     QVBoxLayout *mainLayout;
@@ -44,16 +45,15 @@ private:
     QFrame *contentFrame;
     QTextEdit *infoDisplay;
 
-    // Hardware data storage
-    QString cpuInfo;
-    QString gpuInfo;
-    QString motherboardInfo;
-    QString ramInfo;
-    QString storageInfo;
-    QString networkInfo;
-    QString usbInfo;
+    // Hardware data storage. collect() takes seconds, so it runs on the
+    // sampling workers, every 3 seconds while the page is shown or the
+    // metrics endpoint is on, and report is only replaced once it is done.
+    HardwareCollector collector;
+    HardwareReport report;
+    SamplingScheduler::Id hardwareSampler;
+    bool observed;
 
-    QTimer *hardwareTimer;
+    MetricsServer *metrics;
 };
 
 #endif // HARDWAREINFO_H
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "networkwidget.h"
+#include "../core/metricsserver.h"
+#include "../core/trace.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QPushButton>
@@ -14,8 +16,32 @@
 #include <QRandomGenerator>
 #include <QScrollArea>
 
+namespace {
+
+// A collector that runs fetch() on a sampling worker and show() with its
+// result back on the page's thread
+template <typename Fetch, typename Show>
+std::function<void()> collector(QObject *page, Fetch fetch, Show show)
+{
+    return [page, fetch, show]() {
+        const auto result = fetch();
+        QMetaObject::invokeMethod(page, [show, result]() {
+            show(result);
+        }, Qt::QueuedConnection);
+    };
+}
+
+} // namespace
+
 NetworkWidget::NetworkWidget(QWidget *parent)
     : QWidget(parent)
+    , adaptersSampler(-1)
+    , ipDetailsSampler(-1)
+    , connectionsSampler(-1)
+    , speedSampler(-1)
+    , statusSampler(-1)
+    , countersSampler(-1)
+    , observed(false)
     , mainLayout(nullptr)
     , scrollArea(nullptr)
     , networkList(nullptr)
@@ -28,22 +54,72 @@ NetworkWidget::NetworkWidget(QWidget *parent)
     , btnWifiRadio(nullptr)
     , btnBluetoothAdapter(nullptr)
     , btnBluetoothRadio(nullptr)
-    , connectionsTimer(nullptr)
-    , speedTimer(nullptr)
-    , statusTimer(nullptr)
     , speedCounter(0)
+    , metrics(nullptr)
 {
     setupUI();
+
+    // The probes spawn about ten processes between them, so the page shows
+    // its placeholders at once and fills in as the samplers get the answers.
+    // Adapters and IP details are only read on request.
+    SamplingScheduler &scheduler = SamplingScheduler::shared();
+    adaptersSampler = scheduler.add("NetworkWidget adapters", 0, 0, false, collector(this,
+        [this]() { return probe.adapters(); },
+        [this](const QList<NetworkAdapter> &found) { showAdapters(found); }));
+    ipDetailsSampler = scheduler.add("NetworkWidget IP details", 0, 0, false, collector(this,
+        [this]() { return probe.ipDetails(); },
+        [this](const QStringList &lines) { showIPDetails(lines); }));
+    connectionsSampler = scheduler.add("NetworkWidget connections", 200, 50, true, collector(this,
+        [this]() { return probe.connections(); },
+        [this](const ConnectionSummary &summary) { showConnections(summary); }));
+    speedSampler = scheduler.add("NetworkWidget speed", 1000, 250, true, [this]() {
+        QMetaObject::invokeMethod(this, &NetworkWidget::updateSpeedInfo, Qt::QueuedConnection);
+    });
+    statusSampler = scheduler.add("NetworkWidget status", 3000, 1000, true, collector(this,
+        [this]() { return probe.adapterStates(); },
+        [this](const AdapterStates &states) { showAdapterStates(states); }));
+
     parseNetworkAdapters();
+    refreshIPDetails();
     updateConnections();
     checkAllAdaptersStatus();
 }
 
 NetworkWidget::~NetworkWidget()
 {
-    if (connectionsTimer) connectionsTimer->stop();
-    if (speedTimer) speedTimer->stop();
-    if (statusTimer) statusTimer->stop();
+    // Waits for runs in progress, which still use this page
+    SamplingScheduler &scheduler = SamplingScheduler::shared();
+    scheduler.remove(adaptersSampler);
+    scheduler.remove(ipDetailsSampler);
+    scheduler.remove(connectionsSampler);
+    scheduler.remove(speedSampler);
+    scheduler.remove(statusSampler);
+    if (countersSampler >= 0) scheduler.remove(countersSampler);
+}
+
+void NetworkWidget::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    if (observed) return;
+    observed = true;
+    
+    SamplingScheduler &scheduler = SamplingScheduler::shared();
+    scheduler.subscribe(connectionsSampler);
+    scheduler.subscribe(speedSampler);
+    scheduler.subscribe(statusSampler);
+}
+
+void NetworkWidget::hideEvent(QHideEvent *event)
+{
+    QWidget::hideEvent(event);
+    if (!observed) return;
+    observed = false;
+    
+    // Also when the window is minimized
+    SamplingScheduler &scheduler = SamplingScheduler::shared();
+    scheduler.unsubscribe(connectionsSampler);
+    scheduler.unsubscribe(speedSampler);
+    scheduler.unsubscribe(statusSampler);
 }
 
 void NetworkWidget::setupUI()
@@ -77,19 +153,6 @@ void NetworkWidget::setupUI()
     QVBoxLayout *outerLayout = new QVBoxLayout(this);
     outerLayout->setContentsMargins(0, 0, 0, 0);
     outerLayout->addWidget(scrollArea);
-
-    // Setup timers
-    connectionsTimer = new QTimer(this);
-    connect(connectionsTimer, &QTimer::timeout, this, &NetworkWidget::updateConnections);
-    connectionsTimer->start(200);
-
-    speedTimer = new QTimer(this);
-    connect(speedTimer, &QTimer::timeout, this, &NetworkWidget::updateSpeedInfo);
-    speedTimer->start(1000);
-
-    statusTimer = new QTimer(this);
-    connect(statusTimer, &QTimer::timeout, this, &NetworkWidget::checkAllAdaptersStatus);
-    statusTimer->start(3000);
 }
 
 void NetworkWidget::createTopControlsSpace()
@@ -211,6 +274,7 @@ void NetworkWidget::createNetworkAdaptersSpace()
         "}"
     );
     networkList->setMaximumHeight(100);
+    networkList->addItem("Reading network adapters...");
 
     mainLayout->addWidget(spaceTitle);
     mainLayout->addWidget(networkList);
@@ -303,6 +367,7 @@ void NetworkWidget::createIPManagementSpace()
         "}"
     );
     ipDetailsDisplay->setReadOnly(true);
+    ipDetailsDisplay->setPlaceholderText("Reading IP details...");
     ipDetailsDisplay->setMinimumHeight(120);
 
     // Connect buttons
@@ -312,9 +377,6 @@ void NetworkWidget::createIPManagementSpace()
     ipLayout->addLayout(buttonLayout);
     ipLayout->addWidget(ipDetailsDisplay);
 
-    // Show initial IP details
-    refreshIPDetails();
-
     mainLayout->addWidget(spaceTitle);
     mainLayout->addLayout(ipLayout);
 }
@@ -338,6 +400,7 @@ void NetworkWidget::createConnectionsSpace()
         "}"
     );
     connectionsDisplay->setReadOnly(true);
+    connectionsDisplay->setPlaceholderText("Reading connections...");
     connectionsDisplay->setMinimumHeight(150);
 
     mainLayout->addWidget(spaceTitle);
@@ -435,107 +498,107 @@ void NetworkWidget::createControlButtonsSpace()
 // Helper functions
 QString NetworkWidget::executeCommand(const QString &command, const QStringList &arguments)
 {
-    QProcess process;
-    process.start(command, arguments);
-    process.waitForFinished();
-    return QString::fromLocal8Bit(process.readAllStandardOutput());
+    return NetworkProbe::executeCommand(command, arguments);
 }
 
-void NetworkWidget::parseNetworkAdapters()
+void NetworkWidget::setMetrics(MetricsServer *server)
 {
-    networkList->clear();
-    QString ipconfigOutput = executeCommand("ipconfig", QStringList() << "/all");
-    QStringList lines = ipconfigOutput.split('\n');
-    
-    QString currentAdapter;
-    QString ipAddress;
-
-    for (const QString &line : lines) {
-        QString trimmed = line.trimmed();
-        
-        if (!trimmed.isEmpty() && trimmed.endsWith(":") && !trimmed.startsWith("   ")) {
-            if (!currentAdapter.isEmpty() && !ipAddress.isEmpty()) {
-                QString itemText = QString("%1 - %2").arg(currentAdapter).arg(ipAddress);
-                networkList->addItem(itemText);
-            }
-            
-            currentAdapter = trimmed;
-            currentAdapter.remove(":");
-            ipAddress.clear();
-        }
-        else if (trimmed.startsWith("IPv4 Address") || (trimmed.startsWith("IP Address") && !trimmed.contains("IPv6"))) {
-            QStringList parts = trimmed.split(":");
-            if (parts.size() > 1) {
-                ipAddress = parts[1].trimmed();
-                ipAddress.remove("(Preferred)");
-                ipAddress.remove("(Deprecated)");
-                ipAddress = ipAddress.trimmed();
-            }
+    // The endpoint observes connections, status and traffic like the page
+    // does, so they stay fresh while the page is hidden
+    SamplingScheduler &scheduler = SamplingScheduler::shared();
+    if (server && !metrics) {
+        if (countersSampler < 0) {
+            countersSampler = scheduler.add("NetworkWidget counters", 1000, 250, true, collector(this,
+                [this]() { return probe.interfaceCounters(); },
+                [this](const QList<InterfaceCounters> &interfaces) { publishInterfaceCounters(interfaces); }));
         }
+        scheduler.subscribe(connectionsSampler);
+        scheduler.subscribe(statusSampler);
+        scheduler.subscribe(countersSampler);
+    } else if (!server && metrics) {
+        scheduler.unsubscribe(connectionsSampler);
+        scheduler.unsubscribe(statusSampler);
+        scheduler.unsubscribe(countersSampler);
     }
     
-    if (!currentAdapter.isEmpty() && !ipAddress.isEmpty()) {
-        QString itemText = QString("%1 - %2").arg(currentAdapter).arg(ipAddress);
-        networkList->addItem(itemText);
+    metrics = server;
+    publishAdapters();
+}
+
+void NetworkWidget::parseNetworkAdapters()
+{
+    SamplingScheduler::shared().trigger(adaptersSampler);
+}
+
+void NetworkWidget::showAdapters(const QList<NetworkAdapter> &found)
+{
+    TraceSpan span("NetworkWidget::showAdapters");
+    networkList->clear();
+    adapters = found;
+    for (const NetworkAdapter &adapter : adapters) {
+        networkList->addItem(QString("%1 - %2").arg(adapter.name).arg(adapter.address));
     }
     
     if (networkList->count() == 0) {
         networkList->addItem("No active network connections with IP addresses");
     }
+    publishAdapters();
 }
 
-void NetworkWidget::showIPDetails(QTextEdit *display)
+void NetworkWidget::publishAdapters()
 {
-    if (!display) return;
-    
-    display->clear();
-    QString output = executeCommand("ipconfig", QStringList());
+    if (!metrics) return;
     
-    QStringList lines = output.split('\n');
+    MetricsWriter writer;
+    writer.family("raptor_network_adapter_info", "gauge", "Network adapters with an IPv4 address");
+    for (const NetworkAdapter &adapter : adapters) {
+        writer.sample("raptor_network_adapter_info", 1,
+                      {{"adapter", adapter.name.toStdString()}, {"address", adapter.address.toStdString()}});
+    }
+    metrics->publish("network_adapters", writer.text());
+}
+
+void NetworkWidget::showIPDetails(const QStringList &lines)
+{
+    TraceSpan span("NetworkWidget::showIPDetails");
+    ipDetailsDisplay->clear();
     for (const QString &line : lines) {
-        QString trimmed = line.trimmed();
-        if (trimmed.contains("IPv4") || trimmed.startsWith("IP Address") || 
-            trimmed.startsWith("Subnet") || trimmed.startsWith("Default Gateway")) {
-            display->append(trimmed);
-        }
+        ipDetailsDisplay->append(line);
     }
     
-    if (display->toPlainText().isEmpty()) {
-        display->setPlainText("No IP details available");
+    if (ipDetailsDisplay->toPlainText().isEmpty()) {
+        ipDetailsDisplay->setPlainText("No IP details available");
     }
 }
 
 void NetworkWidget::updateConnections()
 {
-    QString output = executeCommand("netstat", QStringList() << "-n");
-    QStringList lines = output.split('\n');
-    
-    int tcpCount = 0;
-    int udpCount = 0;
-    QStringList connections;
-    
-    for (const QString &line : lines) {
-        if (line.startsWith("  TCP")) {
-            tcpCount++;
-            if (tcpCount <= 10) {
-                connections << line.trimmed();
-            }
-        } else if (line.startsWith("  UDP")) {
-            udpCount++;
-        }
-    }
-    
+    SamplingScheduler::shared().trigger(connectionsSampler);
+}
+
+void NetworkWidget::showConnections(const ConnectionSummary &summary)
+{
+    TraceSpan span("NetworkWidget::showConnections");
     connectionsDisplay->clear();
-    connectionsDisplay->append(QString("TCP: %1 connections | UDP: %2 connections\n").arg(tcpCount).arg(udpCount));
+    connectionsDisplay->append(QString("TCP: %1 connections | UDP: %2 connections\n").arg(summary.tcp).arg(summary.udp));
     connectionsDisplay->append("Recent TCP connections:");
     
-    for (const QString &conn : connections) {
+    for (const QString &conn : summary.recentTcp) {
         connectionsDisplay->append(conn);
     }
+    
+    if (metrics) {
+        MetricsWriter writer;
+        writer.family("raptor_network_connections", "gauge", "Open connections by protocol");
+        writer.sample("raptor_network_connections", summary.tcp, {{"protocol", "tcp"}});
+        writer.sample("raptor_network_connections", summary.udp, {{"protocol", "udp"}});
+        metrics->publish("network_connections", writer.text());
+    }
 }
 
 void NetworkWidget::updateSpeedInfo()
 {
+    TraceSpan span("NetworkWidget::updateSpeedInfo");
     speedCounter++;
     QRandomGenerator *generator = QRandomGenerator::global();
     
@@ -548,11 +611,36 @@ void NetworkWidget::updateSpeedInfo()
                           .arg(speedCounter % 60);
     
     speedLabel->setText(speedText);
+    }
+
+// Counters rather than rates: Prometheus derives the rates itself
+void NetworkWidget::publishInterfaceCounters(const QList<InterfaceCounters> &interfaces)
+{
+    if (!metrics) return;
+    
+    MetricsWriter writer;
+    writer.family("raptor_network_receive_bytes_total", "counter", "Bytes received by the interface");
+    for (const InterfaceCounters &nic : interfaces) {
+        writer.sample("raptor_network_receive_bytes_total", nic.receivedBytes, {{"interface", nic.name.toStdString()}});
+    }
+    writer.family("raptor_network_transmit_bytes_total", "counter", "Bytes sent by the interface");
+    for (const InterfaceCounters &nic : interfaces) {
+        writer.sample("raptor_network_transmit_bytes_total", nic.sentBytes, {{"interface", nic.name.toStdString()}});
+    }
+    writer.family("raptor_network_receive_packets_total", "counter", "Packets received by the interface");
+    for (const InterfaceCounters &nic : interfaces) {
+        writer.sample("raptor_network_receive_packets_total", nic.receivedPackets, {{"interface", nic.name.toStdString()}});
+    }
+    writer.family("raptor_network_transmit_packets_total", "counter", "Packets sent by the interface");
+    for (const InterfaceCounters &nic : interfaces) {
+        writer.sample("raptor_network_transmit_packets_total", nic.sentPackets, {{"interface", nic.name.toStdString()}});
+    }
+    metrics->publish("network_interfaces", writer.text());
 }
 
 void NetworkWidget::refreshIPDetails()
 {
-    showIPDetails(ipDetailsDisplay);
+    SamplingScheduler::shared().trigger(ipDetailsSampler);
 }
 
 void NetworkWidget::releaseRenewIP()
@@ -598,83 +686,30 @@ void NetworkWidget::clearNetworkInfo()
     infoDisplay->setPlaceholderText("Network information will appear here...");
 }
 
-QString NetworkWidget::getEthernetStatus()
-{
-    QString adapterName = getEthernetAdapterName();
-    
-    // Try PowerShell method first (more reliable)
-    QString psOutput = executeCommand("powershell", QStringList() << "-Command" << 
-        QString("$adapter = Get-NetAdapter -Name '%1' -ErrorAction SilentlyContinue; if ($adapter) { if ($adapter.Status -eq 'Up') { 'Connected' } else { 'Disabled' } } else { 'Not Found' }").arg(adapterName));
-    
-    QString status = psOutput.trimmed();
-    if (!status.isEmpty() && status != "null") {
-        return status;
-    }
-    
-    // Fallback to netsh method
-    QString output = executeCommand("netsh", QStringList() << "interface" << "show" << "interface");
-    QStringList lines = output.split('\n');
-    for (const QString &line : lines) {
-        if (line.contains(adapterName) || line.contains("Ethernet") || line.contains("Local Area Connection")) {
-            if (line.contains("Connected")) {
-                return "Connected";
-            } else if (line.contains("Disconnected")) {
-                return "Disabled";
-            } else if (line.contains("Enabled")) {
-                return "Enabled";
-            } else if (line.contains("Disabled")) {
-                return "Disabled";
-            }
-        }
-    }
-    
-    return "Not Found";
-}
-
-QString NetworkWidget::getWifiAdapterStatus()
-{
-    QString output = executeCommand("powershell", QStringList() << "-Command" << 
-        "$adapter = Get-NetAdapter -Name 'Wi-Fi' -ErrorAction SilentlyContinue; "
-        "if ($adapter) { if ($adapter.Status -eq 'Up') { 'Enabled' } else { 'Disabled' } } else { 'Not Found' }");
-    
-    return output.trimmed();
-}
-
-QString NetworkWidget::getWifiRadioStatus()
-{
-    QString output = executeCommand("powershell", QStringList() << "-Command" << 
-        "$interface = netsh interface show interface 'Wi-Fi'; "
-        "if ($interface -like '*Enabled*') { 'Enabled' } else { 'Disabled' }");
-    
-    return output.trimmed();
-}
-
-QString NetworkWidget::getBluetoothAdapterStatus()
-{
-    QString output = executeCommand("powershell", QStringList() << "-Command" << 
-        "$bt = Get-PnpDevice -Class Bluetooth -Status 'OK' -ErrorAction SilentlyContinue | Select-Object -First 1; "
-        "if ($bt) { 'Enabled' } else { 'Disabled' }");
-    
-    return output.trimmed();
-}
-
-QString NetworkWidget::getBluetoothRadioStatus()
+void NetworkWidget::checkAllAdaptersStatus()
 {
-    QString output = executeCommand("powershell", QStringList() << "-Command" << 
-        "$radio = Get-WmiObject -Namespace 'Root\\WMI' -Class 'MS_SystemInformation' -ErrorAction SilentlyContinue; "
-        "if ($radio) { 'Enabled' } else { 'Disabled' }");
-    
-    return output.trimmed();
+    SamplingScheduler::shared().trigger(statusSampler);
 }
 
-
-void NetworkWidget::checkAllAdaptersStatus()
-{
-    QString ethernetStatus = getEthernetStatus();
-    QString wifiAdapterStatus = getWifiAdapterStatus();
-    QString wifiRadioStatus = getWifiRadioStatus();
-    QString bluetoothAdapterStatus = getBluetoothAdapterStatus();
-    QString bluetoothRadioStatus = getBluetoothRadioStatus();
+void NetworkWidget::showAdapterStates(const AdapterStates &states)
+{
+    TraceSpan span("NetworkWidget::showAdapterStates");
+    const QString &ethernetStatus = states.ethernet;
+    const QString &wifiAdapterStatus = states.wifiAdapter;
+    const QString &wifiRadioStatus = states.wifiRadio;
+    const QString &bluetoothAdapterStatus = states.bluetoothAdapter;
+    const QString &bluetoothRadioStatus = states.bluetoothRadio;
+    
+    if (metrics) {
+        MetricsWriter writer;
+        writer.family("raptor_network_adapter_status", "gauge", "State of the adapters the Network page controls");
+        writer.sample("raptor_network_adapter_status", 1, {{"adapter", "ethernet"}, {"status", ethernetStatus.toStdString()}});
+        writer.sample("raptor_network_adapter_status", 1, {{"adapter", "wifi"}, {"status", wifiAdapterStatus.toStdString()}});
+        writer.sample("raptor_network_adapter_status", 1, {{"adapter", "wifi_radio"}, {"status", wifiRadioStatus.toStdString()}});
+        writer.sample("raptor_network_adapter_status", 1, {{"adapter", "bluetooth"}, {"status", bluetoothAdapterStatus.toStdString()}});
+        writer.sample("raptor_network_adapter_status", 1, {{"adapter", "bluetooth_radio"}, {"status", bluetoothRadioStatus.toStdString()}});
+        metrics->publish("network_status", writer.text());
+    }
     
     // Update Ethernet button
     btnEthernet->setText(QString("🔌 Ethernet: %1").arg(ethernetStatus));
@@ -782,21 +817,6 @@ void NetworkWidget::checkAllAdaptersStatus()
     );
 }
 
-QString NetworkWidget::getEthernetAdapterName()
-{
-    // Find the actual Ethernet adapter name
-    QString output = executeCommand("powershell", QStringList() << "-Command" << 
-        "Get-NetAdapter -Physical | Where-Object {$_.InterfaceDescription -like '*Ethernet*' -or $_.Name -like '*Ethernet*'} | Select-Object -First 1 | Select-Object -ExpandProperty Name");
-    
-    QString name = output.trimmed();
-    if (!name.isEmpty() && name != "null") {
-        return name;
-    }
-    
-    // Fallback to common names
-    return "Ethernet";
-}
-
 void NetworkWidget::toggleEthernet()
 {
     btnEthernet->setEnabled(false);
@@ -804,8 +824,8 @@ void NetworkWidget::toggleEthernet()
     btnEthernet->setText("🔌 Working...");
     
     QTimer::singleShot(100, this, [this]() {
-        QString adapterName = getEthernetAdapterName();
-        QString currentStatus = getEthernetStatus();
+        QString adapterName = probe.ethernetAdapterName();
+        QString currentStatus = probe.ethernetStatus();
         
         bool enable = (currentStatus == "Disabled" || currentStatus == "Not Found");
         
@@ -838,7 +858,7 @@ void NetworkWidget::toggleWifiAdapter()
     btnWifiAdapter->setText("📡 Working...");
     
     QTimer::singleShot(100, this, [this]() {
-        QString currentStatus = getWifiAdapterStatus();
+        QString currentStatus = probe.wifiAdapterStatus();
         bool enable = (currentStatus != "Enabled");
         
         if (enable) {
@@ -865,7 +885,7 @@ void NetworkWidget::toggleWifiRadio()
     btnWifiRadio->setText("📶 Working...");
     
     QTimer::singleShot(100, this, [this]() {
-        QString currentStatus = getWifiRadioStatus();
+        QString currentStatus = probe.wifiRadioStatus();
         bool enable = (currentStatus != "Enabled");
         
         if (enable) {
@@ -892,7 +912,7 @@ void NetworkWidget::toggleBluetoothAdapter()
     btnBluetoothAdapter->setText("🔵 Working...");
     
     QTimer::singleShot(100, this, [this]() {
-        QString currentStatus = getBluetoothAdapterStatus();
+        QString currentStatus = probe.bluetoothAdapterStatus();
         bool enable = (currentStatus != "Enabled");
         
         if (enable) {
@@ -919,11 +939,11 @@ void NetworkWidget::toggleBluetoothRadio()
     btnBluetoothRadio->setText("🔷 Working...");
     
     QTimer::singleShot(100, this, [this]() {
-        QString currentStatus = getBluetoothRadioStatus();
+        QString currentStatus = probe.bluetoothRadioStatus();
         bool enable = (currentStatus != "Enabled");
         
         // Check if adapter is enabled first
-        QString adapterStatus = getBluetoothAdapterStatus();
+        QString adapterStatus = probe.bluetoothAdapterStatus();
         if (adapterStatus != "Enabled") {
             infoDisplay->append("❌ Please enable Bluetooth Adapter first");
             btnBluetoothRadio->setEnabled(true);
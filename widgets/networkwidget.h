@@ -4,6 +4,9 @@
 #include <QWidget>
 #include <QTimer>
 
+#include "../core/networkprobe.h"
+#include "../core/samplingscheduler.h"
+
 class QVBoxLayout;
 class QHBoxLayout;
 class QPushButton;
@@ -12,6 +15,7 @@ class QLabel;
 class QTextEdit;
 class QFrame;
 class QScrollArea;
+class MetricsServer;
 
 class NetworkWidget : public QWidget
 {
@@ -20,6 +24,13 @@ class NetworkWidget : public QWidget
 public:
     explicit NetworkWidget(QWidget *parent = nullptr);
     ~NetworkWidget();
+    
+    // Publishes adapters, connections and traffic counters there; may be null
+    void setMetrics(MetricsServer *server);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
 
 private slots:
     void pingGoogle();
@@ -54,17 +65,27 @@ private:
     void createIPManagementSpace();
     void createConnectionsSpace();
     void createControlButtonsSpace();
-    void showIPDetails(QTextEdit *display);
     QString executeCommand(const QString &command, const QStringList &arguments = QStringList());
     void parseNetworkAdapters();
+    void showAdapters(const QList<NetworkAdapter> &found);
+    void showIPDetails(const QStringList &lines);
+    void showConnections(const ConnectionSummary &summary);
+    void showAdapterStates(const AdapterStates &states);
+    void publishAdapters();
+    void publishInterfaceCounters(const QList<InterfaceCounters> &interfaces);
     
-    // Status checking functions
-    QString getEthernetStatus();
-    QString getWifiAdapterStatus();
-    QString getWifiRadioStatus();
-    QString getBluetoothAdapterStatus();
-    QString getBluetoothRadioStatus();
-    QString getEthernetAdapterName();
+    // Adapter, address and connection state comes from the probe, which
+    // runs on the sampling workers so the page never waits for a child
+    // process. Connections, speed and adapter status are sampled while the
+    // page is shown or the metrics endpoint is on.
+    NetworkProbe probe;
+    SamplingScheduler::Id adaptersSampler;
+    SamplingScheduler::Id ipDetailsSampler;
+    SamplingScheduler::Id connectionsSampler;
+    SamplingScheduler::Id speedSampler;
+    SamplingScheduler::Id statusSampler;
+    SamplingScheduler::Id countersSampler;  // only with metrics
+    bool observed;
     
     QVBoxLayout *mainLayout;
     QScrollArea *scrollArea;
@@ -81,11 +102,10 @@ private:
     QPushButton *btnBluetoothAdapter;
     QPushButton *btnBluetoothRadio;
     
-    // Remove the async watcher pointers
-    QTimer *connectionsTimer;
-    QTimer *speedTimer;
-    QTimer *statusTimer;
     int speedCounter;
+    
+    MetricsServer *metrics;
+    QList<NetworkAdapter> adapters;
 };
 
 #endif // NETWORKWIDGET_H
\ No newline at end of file